@@ -25,7 +25,6 @@
 */
 #define FULL_DECIMATION		1
 
-
 #include <stdint.h>
 #include <ActiveSocket.h>
 
@@ -36,10 +35,25 @@
 #include <tchar.h>
 
 #include <new>
+#include <atomic>
 #include <stdio.h>
 
 #include "resource.h"
 #include "ExtIO_RTL.h"
+#include "convert.h"
+#include "decimator.h"
+#include "resampler.h"
+#include "cic.h"
+#include "blockring.h"
+#include "blockpool.h"
+#include "rechunker.h"
+#include "jitter.h"
+#include "pacer.h"
+#include "metrics.h"
+#include "scanner.h"
+#include "nco.h"
+#include "iqcorr.h"
+#include "kernelbench.h"
 
 #ifdef _MSC_VER
 	#pragma warning(disable : 4996)
@@ -49,7 +63,7 @@
 #if ALWAYS_PCMU8
 #define MAX_DECIMATIONS		1
 #else
-#define MAX_DECIMATIONS		8
+#define MAX_DECIMATIONS		12
 #endif
 
 
@@ -270,11 +284,13 @@ static const int * gains = 0;
 static int n_gains = 0;			// tuner_gains[]
 
 
-static union
+// commands of one update, transmitted with a single send()
+#define MAX_TCP_CMDS	32
+static struct
 {
-	uint8_t ac[8];			// write 0, 1, 2, [3]
-	uint32_t ui[2];			// write 0, [1]
-} rtl_tcp_cmd;
+	uint8_t ac[5 * MAX_TCP_CMDS];	// per command: id, value in network byte order
+	int len;
+} rtl_tcp_cmds;
 
 static volatile union
 {
@@ -291,17 +307,130 @@ static volatile bool GotTunerInfo = false;
 
 static int maxDecimation = 0;
 
+typedef struct
+{
+	int decimation;
+	int outputRate;		// > 0: resampled to this rate - decimation is then planned automatically
+} decimation_item_t;
+
+#define MAX_DECIMATION_ITEMS	24
+static decimation_item_t decimationItems[MAX_DECIMATION_ITEMS];
+static int n_decimationItems = 0;
+
+// halfband/FIR decimations below the CIC: powers of two times 1, 3 or 5 -
+// the odd FIR factors with specialized kernels
+static bool isFilterDecimation(int decimation)
+{
+	if (decimation < 1)
+		return false;
+	while ((decimation & 1) == 0)
+		decimation >>= 1;
+	return decimation == 1 || decimation == 3 || decimation == 5;
+}
+
+// output rates offered for resampling
+static const int resampleRates[] = { 44100, 48000, 96000, 192000 };
+static const int n_resampleRates = sizeof(resampleRates) / sizeof(resampleRates[0]);
+
 static bool SDRsupportsLogging = false;
 static bool SDRsupportsSamplePCMU8 = false;
 static bool SDRsupportsSampleFormats = false;
 
+// output sample size for the CIC path (decimation >= CIC_MIN_DECIMATION): 16 or 32
+static volatile int CicOutputBits = 32;
+
+// 1 == deliver float32 samples (exthwUSBfloat32) - with dynamic sample formats only
+static volatile int FloatOutput = 0;
+
+// samples received before a retune/samplerate change became effective
+#define RETUNE_PASS		0		// deliver unchanged
+#define RETUNE_BLANK	1		// replace with zero samples
+#define RETUNE_DROP		2		// drop complete blocks, blank the rest
+static volatile int RetuneFlushPolicy = RETUNE_BLANK;
+// settling after the command: PLL lock and data queued in rtl_tcp - beyond our socket buffer
+static volatile int RetuneSettleMillis = 20;
+
+// frequency sweep / power scan instead of streaming to the SDR program
+static volatile int ScanMode = 0;
+static char ScanSpec[256] = "88000000-108000000:2000000@50";	// see scan_parse_plan()
+static volatile int ScanFftSize = 1024;
+static char ScanFile[MAX_PATH] = "ExtIO_RTL_TCP_scan.bin";
+static volatile unsigned scanPlanChanged = 0;	// incremented on changed scan settings
+static volatile unsigned scanGeneration = 0;	// incremented on each (re)started scan
+static std::vector<scan_step_t> scanPlan;		// receive thread
+static PowerScan scanner;						// processing thread
+static unsigned scannerGeneration = 0;
+
+// the texts of the scan settings get written by the host and copied when a scan starts
+struct ScanLock
+{
+	CRITICAL_SECTION cs;
+	ScanLock() { InitializeCriticalSection(&cs); }
+	~ScanLock() { DeleteCriticalSection(&cs); }
+};
+static ScanLock scanLock;
+
+// a scan as the receive thread starts it: settings parsed once, then handed to the processing thread
+struct ScanSnapshot
+{
+	unsigned generation;
+	std::vector<scan_step_t> plan;
+	int fftSize;
+	int samplerate;
+	char file[MAX_PATH];
+};
+static std::atomic<ScanSnapshot *> pendingScan(0);	// receive thread -> processing thread
+static ScanSnapshot * activeScan = 0;				// processing thread
+
+// block tags in rcvRing: 0 == stream to SDR program, else a scan step
+#define SCAN_TAG(gen, sweep, step)	( 0x40000000 | (((gen) & 0x1FFFF) << 13) | (((sweep) & 1) << 12) | (step) )
+#define SCAN_TAG_GEN(tag)			( ((tag) >> 13) & 0x1FFFF )
+#define SCAN_TAG_SWEEP(tag)			( ((tag) >> 12) & 1 )
+#define SCAN_TAG_STEP(tag)			( (tag) & 0xFFF )
+
+// float32 samples have the level of the 16 bit samples, normalized to +/- 1.0
+#define FLOAT_OUTPUT_SCALE	( 1.0F / 32768.0F )
 
-#define MAX_BUFFER_LEN	(256*1024)
-#define NUM_BUFFERS_BEFORE_CALLBACK		( MAX_DECIMATIONS + 1 )
 
-static bool rcvBufsAllocated = false;
+#define MAX_BUFFER_LEN	(256*1024)
+// maximum wait for socket data - before checking terminateThread again
+#define SOCKET_WAIT_TIMEOUT_MS	100
+// WSAPoll() cannot wait for ctrlEvent: control changes get seen after this timeout
+#define SOCKET_POLL_TIMEOUT_MS	10
+
+// range of the configured I/Q pairs per callback
+#define MIN_CALLBACK_LEN	256
+#define MAX_CALLBACK_LEN	(MAX_BUFFER_LEN / 2)
+
+// output buffers are regions of bufPool - sized for the output of the processing chain from one
+// network block and the callback length promised in StartHW(). the processing thread resizes them
+// while running, when any of them changes
+static BlockPool bufPool;
+static volatile int pooledBlockLen = 0;	// block length the buffers are sized for - 0 before allocation
+static bool pooledLargePages = false;	// large pages were requested - maybe not granted
+static int pooledCallbackLen = 0;		// callback length the staging buffer is sized for
+static int pooledOutPairs = 0;			// output pairs per block the regions hold
+static int pooledUses = 0;				// regions with memory: BLOCKPOOL_USE_*
+static int pooledPairBytes = 0;			// output pair size the staging buffer is sized for
 static short * short_buf = 0;
-static uint8_t * rcvBuf[NUM_BUFFERS_BEFORE_CALLBACK + 1] = { 0 };
+static float * float_buf = 0;		// decimator/resampler output
+static Decimator decimator;
+static SumDecimator sumDecimator;	// integer sums: the sum filter without shift or correction
+static Resampler resampler;
+static int32_t * int_buf = 0;		// CIC output
+static CicDecimator cic;
+static Rechunker chunker;			// cuts the output into callbacks
+// network blocks from receive to processing thread
+// the network block size follows buffer_len live: the ring keeps room for 4 of the largest,
+// and grows with buffer_len while it is empty
+#define RCV_RING_BLOCKS		16
+#define MIN_RCV_RING_SIZE	(4 * MAX_BUFFER_LEN)
+static BlockRing rcvRing;
+#define DISCARD_LEN			16384
+static uint8_t discardBuf[DISCARD_LEN];		// receives blocks not fitting into rcvRing - overwritten
+static HANDLE rcvEvent = NULL;				// signals a committed block
+static HANDLE ctrlEvent = NULL;				// wakes the receive thread on control changes
+static volatile unsigned streamGeneration = 0;	// incremented on each connect
 
 static volatile int somewhat_changed = 0;	// 1 == freq
 											// 2 == srate
@@ -312,11 +441,49 @@ static volatile int somewhat_changed = 0;	// 1 == freq
 											// 64 == offset Tuning (E4000)
 											// 128 == freq corr ppm
 											// 256 == tuner bandwidth
-											// 512 == decimation
+											// 512 == decimation / resampling
+											// 1024 == software offset tuning
+
+// wake the receive thread - to transmit changes without waiting for data
+static void signalControl()
+{
+	if (ctrlEvent)
+		SetEvent(ctrlEvent);
+}
+
+static void setChanged(int flag)
+{
+	somewhat_changed |= flag;
+	signalControl();
+}
+
+// retune latency: SetHWLO() until the command is sent
+static volatile LONGLONG freqChangeTicks = 0;
+static LONGLONG retuneLatencyMin = 0;		// in QueryPerformanceCounter() ticks
+static LONGLONG retuneLatencyMax = 0;
+static LONGLONG retuneLatencySum = 0;
+static unsigned retuneLatencyCount = 0;
 
 static volatile long last_freq=100000000;
 static volatile long new_freq = 100000000;
 
+// digital fine tuning: LO moves within this percentage of the band around the
+// output bandwidth are shifted by the nco - without retuning the tuner. 0 == retune always
+static volatile int NcoWindowPercent = 80;
+static volatile long hw_freq = 100000000;		// frequency of the tuner
+static volatile long ncoOffset = 0;				// new_freq - hw_freq: shifted by the nco
+static long tunerOffset = 0;					// hw_freq - LO at the last retune
+
+// software offset tuning: tuner fs/4 above the LO, shifted back digitally.
+// keeps the DC spike out of the decimated band - for tuners without offset tuning
+static volatile int SoftwareOffsetTuning = 0;
+static volatile unsigned hwRetunes = 0;			// frequency commands: restart the nco
+static Nco nco;									// processing thread
+
+// DC offset and I/Q imbalance correction of the float/16 bit output: see IQCORR_*
+static volatile int DcIqCorrection = 0;
+static IqCorrector iqCorrector;					// processing thread
+
 static volatile int last_srate_idx = 18;
 static volatile int new_srate_idx = 18;		// default = 2.3 MSps
 
@@ -326,6 +493,8 @@ static volatile int new_TunerBW = 0;		// n_bandwidths = bandwidths[]; nearestBwI
 static volatile int last_Decimation = 0;
 static volatile int new_Decimation = 0;
 
+static volatile int new_OutputRate = 0;		// 0 == no resampling, else output samplerate in Hz
+
 static volatile int last_gain = 1;
 static volatile int new_gain = 1;
 
@@ -337,6 +506,43 @@ static volatile int new_RTLAGC = 0;
 
 static volatile int last_DirectSampling = 0;
 static volatile int new_DirectSampling = 0;
+// direct sampling pin I/Q: the channel's real samples to complex at half the samplerate
+static volatile int DirectSamplingReal = 1;
+
+// decimations below the CIC: 0 = halfband/FIR, 1 = the former sum of pairs - cheapest, but aliasing.
+// the sums stay the default: even vectorized, the halfband/FIR chain costs several times the sum loops
+static volatile int DecimationFilter = 1;
+
+// 1: log the kernel benchmarks after the next StartHW(), on the processing thread - then resets to 0
+static volatile int RunBenchmark = 0;
+
+// 1: sample buffers in large pages - needs the "Lock pages in memory" user right
+static volatile int LargePages = 0;
+
+// jitter buffer: blocks are held back by the measured arrival jitter, instead of
+// being processed on arrival. the delay lets no more than the drop target arrive late
+static volatile int JitterBufferMode = 0;
+static volatile int JitterDropPermille = 10;
+static JitterBuffer jitterBuf;
+// longest single wait for a held block, checking for a stop in between - in milliseconds
+#define JITTER_WAIT_SLICE_MS	10
+
+// paced delivery: callbacks on a clock from the output samplerate, instead of on arrival.
+// the receive ring absorbs the bursts - beyond half its size callbacks hurry
+static volatile int PacedDelivery = 0;
+static Pacer pacer;
+static char cadenceReport[256] = "";
+
+// throughput/health counters - also served as text on localhost:MetricsPort, 0 = off
+static StreamCounters counters;
+static MetricsServer metricsServer;
+static volatile int MetricsPort = 0;
+
+// kernel autotuner: measures the processing chain after StartHW(), on the processing thread.
+// the record in the settings skips it while CPU, block size, chain and sample format stay the same
+static volatile int KernelAutotune = 1;
+static char KernelTuneRecord[256] = "";
+static volatile unsigned kernelRequest = 0;		// StartHW(): processing thread selects the kernels
 
 static volatile int last_OffsetTuning = 0;
 static volatile int new_OffsetTuning = 0;
@@ -345,7 +551,11 @@ static volatile int last_FreqCorrPPM = 0;
 static volatile int new_FreqCorrPPM = 0;
 
 static volatile int bufferSizeIdx = 6;// 64 kBytes
-static volatile int buffer_len = buffer_sizes[bufferSizeIdx];
+static volatile int buffer_len = buffer_sizes[bufferSizeIdx] * 1024;	// bytes per network block
+static volatile int hostBlockLen = buffer_sizes[bufferSizeIdx] * 1024;	// the buffer size at StartHW(): default callback length
+// I/Q pairs per callback - 0: half the buffer size. for all outputs, raw, decimated or resampled
+static volatile int CallbackSize = 0;
+static volatile int hostCallbackLen = 0;		// I/Q pairs per callback returned by StartHW()
 
 
 static char RTL_TCP_IPAddr[32] = "127.0.0.1";
@@ -355,7 +565,7 @@ static volatile int AutoReConnect = 1;
 static volatile int PersistentConnection = 1;
 
 static int ASyncConnection = 1;
-static int SleepMillisWaitingForData = 1;
+static int SleepMillisWaitingForData = 1;	// deprecated: socket waits are event driven
 
 static int HDSDR_AGC=2;
 
@@ -372,20 +582,27 @@ volatile bool ThreadStreamToSDR = false;
 volatile bool commandEverything = true;
 static bool GUIDebugConnection = false;
 static volatile HANDLE worker_handle=INVALID_HANDLE_VALUE;
+volatile bool terminateProcessing = false;
 void ThreadProc(void * param);
+unsigned __stdcall ProcessThreadProc(void * param);
 
 
 int Start_Thread();
 int Stop_Thread();
+extern "C" long LIBRTL_API __stdcall GetHWSR();
 
 /* ExtIO Callback */
 void (* WinradCallBack)(int, int, float, void *) = NULL;
 #define WINRAD_SRCHANGE 100
 #define WINRAD_LOCHANGE 101
+#define WINRAD_START 107
+#define WINRAD_STOP 108
 #define WINRAD_ATTCHANGE 125
 #define WINRAD_SRATES_CHANGED	137
 #define HDSDR_SAMPLE_FMT_PCMU8	126
 #define HDSDR_SAMPLE_FMT_PCM16	127
+#define HDSDR_SAMPLE_FMT_PCM32	129
+#define HDSDR_SAMPLE_FMT_FLT32	130
 
 // error message, with "const char*" in IQdata,
 //   intended for a log file  AND  a message box
@@ -402,12 +619,242 @@ static INT_PTR CALLBACK MainDlgProc(HWND, UINT, WPARAM, LPARAM);
 static HWND h_dialog=NULL;
 
 
-static bool transmitTcpCmd(CActiveSocket &conn, uint8_t cmdId, uint32_t value)
+static void addRetuneLatency(LONGLONG ticks)
+{
+	if (!retuneLatencyCount || ticks < retuneLatencyMin)
+		retuneLatencyMin = ticks;
+	if (ticks > retuneLatencyMax)
+		retuneLatencyMax = ticks;
+	retuneLatencySum += ticks;
+	++retuneLatencyCount;
+}
+
+static void logRetuneLatency()
+{
+	if (!retuneLatencyCount)
+		return;
+	char acMsg[256];
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	const double msPerTick = 1000.0 / (double)freq.QuadPart;
+	snprintf(acMsg, 255, "retune latency of %u frequency changes: min %.3f ms, avg %.3f ms, max %.3f ms", retuneLatencyCount
+		, retuneLatencyMin * msPerTick, (retuneLatencySum * msPerTick) / retuneLatencyCount, retuneLatencyMax * msPerTick);
+	SDRLOG(MSG_DEBUG, acMsg);
+	retuneLatencyMin = retuneLatencyMax = retuneLatencySum = 0;
+	retuneLatencyCount = 0;
+}
+
+static int64_t ticksPerSecond()
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return freq.QuadPart;
+}
+
+// jitter buffer: holds the block ending at stream offset pos until it is due.
+// the delay is limited to half the ring - and half its block slots. waits on the
+// pacer's high resolution timer: in slices of JITTER_WAIT_SLICE_MS, so a stop is
+// not held up, the last one spun to the tick as the pacer does
+static void waitUntilDue(uint64_t pos, int blockBytes)
+{
+	const int byteRate = jitterBuf.byteRate();
+	if (byteRate <= 0)
+		return;
+	int maxBytes = rcvRing.size() / 2;
+	if ((BLOCKRING_MAX_BLOCKS / 2) * blockBytes < maxBytes)
+		maxBytes = (BLOCKRING_MAX_BLOCKS / 2) * blockBytes;
+	const int64_t freq = ticksPerSecond();
+	const int64_t maxDelay = (int64_t)maxBytes * freq / byteRate;
+	const int64_t due = jitterBuf.due(pos, maxDelay);
+	while (!terminateProcessing && ThreadStreamToSDR)
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		const int64_t wait = due - now.QuadPart;
+		if (wait <= 0 || wait > 2 * maxDelay)	// due - or the estimate was just reset
+			break;
+		const int64_t slice = freq * JITTER_WAIT_SLICE_MS / 1000;
+		if (wait > 2 * slice)
+			pacer.timerWait(slice);
+		else
+		{
+			pacer.sleepUntil(due);
+			break;
+		}
+	}
+}
+
+// metrics in the text exposition format of Prometheus
+static int metricsText(char * buf, int size)
+{
+	const double secPerTick = 1.0 / (double)ticksPerSecond();
+	const int64_t callbackTicks = counters.callbackTicks.load(std::memory_order_relaxed);
+	const int64_t paceTicks = counters.paceTicks.load(std::memory_order_relaxed);
+	const int64_t conversionTicks = counters.processTicks.load(std::memory_order_relaxed) - callbackTicks - paceTicks;
+	const int n = snprintf(buf, size,
+		"rtl_tcp_connected %d\n"
+		"rtl_tcp_bytes_received_total %llu\n"
+		"rtl_tcp_bytes_per_second %d\n"
+		"rtl_tcp_samplerate_nominal %d\n"
+		"rtl_tcp_samplerate_achieved %d\n"
+		"rtl_tcp_output_samplerate %ld\n"
+		"rtl_tcp_blocks_received_total %u\n"
+		"rtl_tcp_ring_overflows %u\n"
+		"rtl_tcp_reconnects_total %u\n"
+		"rtl_tcp_callbacks_total %u\n"
+		"rtl_tcp_leftover_copies_total %u\n"
+		"rtl_tcp_conversion_seconds_total %.3f\n"
+		"rtl_tcp_callback_seconds_total %.3f\n"
+		"rtl_tcp_wait_seconds_total %.3f\n"
+		"rtl_tcp_jitter_buffer_enabled %d\n"
+		"rtl_tcp_jitter_buffer_delay_seconds %.4f\n"
+		"rtl_tcp_jitter_buffer_depth_seconds %.4f\n"
+		"rtl_tcp_jitter_buffer_late_blocks_total %u\n"
+		"rtl_tcp_callback_interval_seconds %.6f\n"
+		"rtl_tcp_callback_jitter_seconds %.6f\n"
+		, GotTunerInfo ? 1 : 0
+		, (unsigned long long)counters.bytesReceived.load(std::memory_order_relaxed)
+		, counters.byteRate.load(std::memory_order_relaxed)
+		, samplerates[new_srate_idx].valueInt
+		, counters.byteRate.load(std::memory_order_relaxed) / 2
+		, GetHWSR()
+		, counters.blocksReceived.load(std::memory_order_relaxed)
+		, rcvRing.overflows()
+		, counters.reconnects.load(std::memory_order_relaxed)
+		, counters.callbacks.load(std::memory_order_relaxed)
+		, chunker.stagedChunks()
+		, conversionTicks * secPerTick, callbackTicks * secPerTick, paceTicks * secPerTick
+		, JitterBufferMode, jitterBuf.delay() * secPerTick
+		, (jitterBuf.byteRate() > 0) ? rcvRing.fill() / (double)jitterBuf.byteRate() : 0.0
+		, jitterBuf.lateBlocks()
+		, counters.intervalMicros.load(std::memory_order_relaxed) * 1E-6
+		, counters.cadenceJitterMicros.load(std::memory_order_relaxed) * 1E-6);
+	return (n < 0 || n >= size) ? size - 1 : n;
+}
+
+static void logBenchmarkLine(const char * line)
+{
+	SDRLOG(MSG_DEBUG, (void *)line);
+}
+
+static void queueTcpCmd(uint8_t cmdId, uint32_t value)
+{
+	if (rtl_tcp_cmds.len + 5 > (int)sizeof(rtl_tcp_cmds.ac))
+		return;
+	uint8_t * p = &rtl_tcp_cmds.ac[rtl_tcp_cmds.len];
+	p[0] = cmdId;
+	p[1] = (uint8_t)(value >> 24);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 8);
+	p[4] = (uint8_t)(value);
+	rtl_tcp_cmds.len += 5;
+}
+
+static bool transmitTcpCmds(CActiveSocket &conn)
+{
+	const int len = rtl_tcp_cmds.len;
+	rtl_tcp_cmds.len = 0;
+	if (!len)
+		return true;
+	int iSent = conn.Send(rtl_tcp_cmds.ac, len);
+	return (len == iSent);
+}
+
+// DECIM_INPUT_REAL_I/Q with the real path for direct sampling - DECIM_INPUT_IQ else.
+// not for the 8 bit output, which passes the samples unchanged
+static int realInput()
+{
+	if (!DirectSamplingReal || extHWtype == exthwUSBdataU8)
+		return DECIM_INPUT_IQ;
+	if (new_DirectSampling == 1)
+		return DECIM_INPUT_REAL_I;
+	if (new_DirectSampling == 2)
+		return DECIM_INPUT_REAL_Q;
+	return DECIM_INPUT_IQ;
+}
+
+// decimation to the SDR program: the real path halves the rate in front
+static int totalDecimation()
+{
+#if ( FULL_DECIMATION )
+	const int decimation = new_Decimation;
+#else
+	const int decimation = 1;		// the decimation only filters
+#endif
+	return (realInput() != DECIM_INPUT_IQ) ? 2 * decimation : decimation;
+}
+
+// filter of the decimations below the CIC - without FULL_DECIMATION always the moving sum
+static int decimationFilter()
+{
+#if ( FULL_DECIMATION )
+	return DecimationFilter ? DECIM_FILTER_SUM : DECIM_FILTER_HALFBAND;
+#else
+	return DECIM_FILTER_MOVING_SUM;
+#endif
+}
+
+// bandwidth after decimation/resampling - 0 when the full band goes to the SDR program
+static int outputBandwidth()
+{
+	const int srate = samplerates[new_srate_idx].valueInt;
+	int outBandwidth = 0;
+	if (new_OutputRate > 0)
+		outBandwidth = new_OutputRate;
+	else if (totalDecimation() > 1)
+		outBandwidth = srate / totalDecimation();
+	if (extHWtype == exthwUSBdataU8 || outBandwidth >= srate)
+		return 0;
+	return outBandwidth;
+}
+
+// tuner offset of the software offset tuning: fs/4 - or 0 when off.
+// the output band has to fit between the DC spike and the band edge
+static long softwareOffset()
+{
+	const int srate = samplerates[new_srate_idx].valueInt;
+	const int outBandwidth = outputBandwidth();
+	if (!SoftwareOffsetTuning || !outBandwidth || 2 * outBandwidth > srate || realInput() != DECIM_INPUT_IQ)
+		return 0;
+	return srate / 4;
+}
+
+// maximum LO move around the tuner's offset, which is shifted by the nco:
+// only the band beyond the decimated output bandwidth can be used - without the DC spike
+static long ncoMaxOffset()
+{
+	const int srate = samplerates[new_srate_idx].valueInt;
+	const int outBandwidth = outputBandwidth();
+	if (!outBandwidth || realInput() != DECIM_INPUT_IQ)
+		return 0;		// the real path has no fine tuning
+	const long swOffset = softwareOffset();
+	long room = (srate - outBandwidth) / 2 - swOffset;
+	if (swOffset && swOffset - outBandwidth / 2 < room)
+		room = swOffset - outBandwidth / 2;
+	if (room <= 0)
+		return 0;
+	return (long)(NcoWindowPercent * (double)room / 100.0);
+}
+
+// queues the frequency command for new_freq - with the software offset
+static void queueTunerFreq()
+{
+	tunerOffset = softwareOffset();
+	hw_freq = new_freq + tunerOffset;
+	ncoOffset = -tunerOffset;
+	++hwRetunes;
+	queueTcpCmd(0x01, hw_freq);
+}
+
+// stream offset, where a just transmitted retune is effective:
+// everything in our socket buffer is from before, then rtl_tcp's queue and PLL settling
+static uint64_t settledStreamOffset(CActiveSocket &conn, uint64_t streamBytes)
 {
-	rtl_tcp_cmd.ac[3] = cmdId;
-	rtl_tcp_cmd.ui[1] = htonl(value);
-	int iSent = conn.Send(&rtl_tcp_cmd.ac[3], 5);
-	return (5 == iSent);
+	u_long pendingBytes = 0;
+	if (ioctlsocket(conn.GetSocketDescriptor(), FIONREAD, &pendingBytes) != 0)
+		pendingBytes = 0;
+	const uint64_t settleBytes = (uint64_t)RetuneSettleMillis * samplerates[new_srate_idx].valueInt * 2 / 1000;
+	return (streamBytes + pendingBytes + settleBytes) & ~(uint64_t)1;	// keep I/Q order
 }
 
 static int nearestSrateIdx(int srate)
@@ -479,6 +926,105 @@ static int nearestGainIdx(int gain)
 	return nearest_idx;
 }
 
+/* plans resampling from srate to outRate:
+ * halfband decimation by a power of two, as long as 1.25 * outRate is kept,
+ * followed by the polyphase resampler for the remaining L / M
+ */
+static bool planResampling(int srate, int outRate, int * pDecimation, int * pL, int * pM)
+{
+	if (srate <= 0 || outRate <= 0 || 5 * (long long)outRate > 4 * (long long)srate)
+		return false;
+
+	int decimation = 1;
+	while ( (long long)srate * 4 >= (long long)outRate * 5 * decimation * 2 )
+		decimation *= 2;
+
+	// L / M = outRate / (srate / decimation)
+	const long long num = (long long)outRate * decimation;
+	long long a = num, b = srate;
+	while (b)
+	{
+		const long long t = a % b;
+		a = b;
+		b = t;
+	}
+	const long long L = num / a;
+	const long long M = srate / a;
+	if (L > RESAMPLER_MAX_L)
+		return false;
+
+	*pDecimation = decimation;
+	*pL = (int)L;
+	*pM = (int)M;
+	return true;
+}
+
+// sample type for the current decimation/resampling - with dynamic sample formats
+static extHWtypeT sampleTypeForDecimation()
+{
+	if (FloatOutput)
+		return exthwUSBfloat32;		// saves the conversion in the SDR program
+	if (DirectSamplingReal && (new_DirectSampling == 1 || new_DirectSampling == 2))
+		return exthwUSBdata16;		// real path for direct sampling
+	if (FULL_DECIMATION && new_Decimation >= CIC_MIN_DECIMATION && new_OutputRate == 0 && CicOutputBits == 32)
+		return exthwFullPCM32;		// keep the bit growth of the CIC
+	if (new_Decimation == 1 && new_OutputRate == 0 && SDRsupportsSamplePCMU8)
+		return exthwUSBdataU8;		// 8bit samples are sufficient when not using decimation
+	return exthwUSBdata16;			// with decimation 16-bit samples are necessary
+}
+
+static int sampleFormatMsg(extHWtypeT t)
+{
+	switch (t)
+	{
+	case exthwUSBdataU8:	return HDSDR_SAMPLE_FMT_PCMU8;
+	case exthwFullPCM32:	return HDSDR_SAMPLE_FMT_PCM32;
+	case exthwUSBfloat32:	return HDSDR_SAMPLE_FMT_FLT32;
+	default:				return HDSDR_SAMPLE_FMT_PCM16;
+	}
+}
+
+static int benchFormat(extHWtypeT t)
+{
+	switch (t)
+	{
+	case exthwUSBdataU8:	return BENCH_OUT_U8;
+	case exthwFullPCM32:	return BENCH_OUT_S32;
+	case exthwUSBfloat32:	return BENCH_OUT_FLOAT;
+	default:				return BENCH_OUT_S16;
+	}
+}
+
+// the processing chain of the current settings - as ProcessThreadProc picks it
+static void currentChain(bench_chain & c)
+{
+	const bool floatOutput = (extHWtype == exthwUSBfloat32);
+	const bool filtered = (extHWtype == exthwUSBdata16 || floatOutput);
+	const int srate = samplerates[new_srate_idx].valueInt;
+	c.input = realInput();
+	c.decimation = new_Decimation;
+	c.filter = decimationFilter();
+	c.L = c.M = 1;
+	c.format = benchFormat(extHWtype);
+	c.correction = DcIqCorrection;
+	c.shifted = (ncoOffset != 0);
+	if (new_OutputRate > 0 && filtered)
+	{
+		c.path = BENCH_CHAIN_RESAMPLE;
+		c.filter = DECIM_FILTER_HALFBAND;
+		const int inRate = (c.input != DECIM_INPUT_IQ) ? srate / 2 : srate;
+		if (!planResampling(inRate, new_OutputRate, &c.decimation, &c.L, &c.M))
+			c.decimation = 1;
+	}
+	else if (FULL_DECIMATION && new_Decimation >= CIC_MIN_DECIMATION && c.input == DECIM_INPUT_IQ)
+		c.path = BENCH_CHAIN_CIC;
+	else if ((new_Decimation > 1 || c.input != DECIM_INPUT_IQ) && filtered)
+		c.path = (c.filter != DECIM_FILTER_HALFBAND && c.input == DECIM_INPUT_IQ && !floatOutput
+			&& !c.shifted && c.correction == IQCORR_OFF) ? BENCH_CHAIN_SUM : BENCH_CHAIN_DECIMATE;
+	else
+		c.path = BENCH_CHAIN_RAW;
+}
+
 
 extern "C"
 bool  LIBRTL_API __stdcall InitHW(char *name, char *model, int& type)
@@ -495,23 +1041,21 @@ bool  LIBRTL_API __stdcall InitHW(char *name, char *model, int& type)
 
 	extHWtype = exthwUSBdata16;  /* 16-bit samples */
 
-	if (!SDRsupportsSamplePCMU8)
+	if (SDRsupportsSampleFormats)
+	{
+		// dynamic extSDR_supports_SampleFormats supported
+		// just depends on current decimation
+		extHWtype = sampleTypeForDecimation();
+	}
+	else if (!SDRsupportsSamplePCMU8)
 		extHWtype = exthwUSBdata16;  /* 16-bit samples */
+	else if (MAX_DECIMATIONS == 1)
+		extHWtype = exthwUSBdataU8;		// 8bit samples are sufficient when not using decimation
 	else
+		extHWtype = exthwUSBdata16;		// with decimation 16-bit samples are necessary
+
+	if (SDRsupportsSamplePCMU8)
 	{
-		if (MAX_DECIMATIONS == 1)
-			extHWtype = exthwUSBdataU8;		// 8bit samples are sufficient when not using decimation
-		else if (!SDRsupportsSampleFormats)
-			extHWtype = exthwUSBdata16;		// with decimation 16-bit samples are necessary
-		else
-		{
-			// dynamic extSDR_supports_SampleFormats and extSDR_supports_PCMU8 supported
-			// just depends on current decimation
-			if (new_Decimation == 1)
-				extHWtype = exthwUSBdataU8;		// 8bit samples are sufficient when not using decimation
-			else
-				extHWtype = exthwUSBdata16;		// with decimation 16-bit samples are necessary
-		}
 #if ALWAYS_PCMU8
 		extHWtype = exthwUSBdataU8;		// 8bit samples are sufficient when not using decimation
 #elif ALWAYS_PCM16
@@ -519,10 +1063,21 @@ bool  LIBRTL_API __stdcall InitHW(char *name, char *model, int& type)
 #endif
 	}
 
+	conv_init();
+	{
+		char acMsg[256];
+		snprintf(acMsg, 255, "InitHW(): using '%s' kernel for PCM16 conversion", conv_u8_to_s16_name);
+		SDRLOG(MSG_DEBUG, acMsg);
+	}
+
 	if (exthwUSBdata16 == extHWtype)
 		SDRLOG(MSG_DEBUG, "InitHW() with sample type PCM16");
 	else if (exthwUSBdataU8 == extHWtype)
 		SDRLOG(MSG_DEBUG, "InitHW() with sample type PCMU8");
+	else if (exthwFullPCM32 == extHWtype)
+		SDRLOG(MSG_DEBUG, "InitHW() with sample type PCM32");
+	else if (exthwUSBfloat32 == extHWtype)
+		SDRLOG(MSG_DEBUG, "InitHW() with sample type FLT32");
 
 	type = extHWtype;
 
@@ -532,8 +1087,8 @@ bool  LIBRTL_API __stdcall InitHW(char *name, char *model, int& type)
 extern "C"
 int LIBRTL_API __stdcall GetStatus()
 {
-	/* dummy function */
-    return 0;
+	// achieved samplerate over the last second - 0 when not receiving
+	return counters.byteRate.load(std::memory_order_relaxed) / 2;
 }
 
 extern "C"
@@ -545,6 +1100,13 @@ bool  LIBRTL_API __stdcall OpenHW()
 	if (h_dialog)
 		ShowWindow(h_dialog,SW_HIDE);
 
+	if (MetricsPort && !metricsServer.start(MetricsPort, metricsText))
+	{
+		char acMsg[256];
+		snprintf(acMsg, 255, "OpenHW(): could not serve metrics on port %d", (int)MetricsPort);
+		SDRLOG(MSG_ERROR, acMsg);
+	}
+
 	if (PersistentConnection)
 	{
 		SDRLOG(MSG_DEBUG, "OpenHW() starts thread (persistent connection)");
@@ -560,8 +1122,11 @@ bool  LIBRTL_API __stdcall OpenHW()
 extern "C"
 long LIBRTL_API __stdcall SetHWLO(long freq)
 {
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	freqChangeTicks = now.QuadPart;
 	new_freq = freq;
-	somewhat_changed |= 1;
+	setChanged(1);
 	return 0;
 }
 
@@ -580,13 +1145,22 @@ int LIBRTL_API __stdcall StartHW(long freq)
 		SDRLOG(MSG_DEBUG, "StartHW(): using sample type PCM16");
 	else if (exthwUSBdataU8 == extHWtype)
 		SDRLOG(MSG_DEBUG, "StartHW(): using sample type PCMU8");
+	else if (exthwFullPCM32 == extHWtype)
+		SDRLOG(MSG_DEBUG, "StartHW(): using sample type PCM32");
+	else if (exthwUSBfloat32 == extHWtype)
+		SDRLOG(MSG_DEBUG, "StartHW(): using sample type FLT32");
 	else
-		SDRLOG(MSG_DEBUG, "StartHW(): using 'other' sample type - NOT PCMU8 or PCM16!");
+		SDRLOG(MSG_DEBUG, "StartHW(): using 'other' sample type - NOT PCMU8, PCM16, PCM32 or FLT32!");
+
+	// kernels get selected - or autotuned - by the processing thread before its next block:
+	// the measurement stays out of this call, the ring holds the blocks meanwhile
+	++kernelRequest;
 
 	commandEverything = true;
 	ThreadStreamToSDR = true;
 	if ( Start_Thread() < 0 )
 		return -1;
+	signalControl();
 
     SetHWLO(freq);
 
@@ -598,7 +1172,9 @@ int LIBRTL_API __stdcall StartHW(long freq)
 
 	// blockSize is independent of decimation!
 	// else, we get just 64 = 512 / 8 I/Q Samples with 1 kB bufferSize!
-	int numIQpairs = buffer_len / 2;
+	hostBlockLen = buffer_len;
+	hostCallbackLen = CallbackSize ? CallbackSize : hostBlockLen / 2;
+	int numIQpairs = hostCallbackLen;
 
 	snprintf(acMsg, 255, "StartHW() = %d. Callback will deliver %d I/Q pairs per call", numIQpairs, numIQpairs);
 	SDRLOG(MSG_DEBUG, acMsg);
@@ -616,10 +1192,10 @@ long LIBRTL_API __stdcall GetHWLO()
 extern "C"
 long LIBRTL_API __stdcall GetHWSR()
 {
+	if (new_OutputRate > 0)
+		return new_OutputRate;
 	long sr = long(samplerates[new_srate_idx].valueInt);
-#if ( FULL_DECIMATION )
-	sr /= new_Decimation;
-#endif
+	sr /= totalDecimation();
 	return sr;
 }
 
@@ -628,11 +1204,10 @@ int LIBRTL_API __stdcall ExtIoGetSrates( int srate_idx, double * samplerate )
 {
 	if (srate_idx < n_srates)
 	{
-#if ( FULL_DECIMATION )
-		*samplerate = samplerates[srate_idx].value / new_Decimation;
-#else
-		*samplerate = samplerates[srate_idx].value;
-#endif
+		if (new_OutputRate > 0)
+			*samplerate = new_OutputRate;
+		else
+			*samplerate = samplerates[srate_idx].value / totalDecimation();
 		return 0;
 	}
 	return 1;	// ERROR
@@ -650,7 +1225,7 @@ int  LIBRTL_API __stdcall ExtIoSetSrate( int srate_idx )
 	if (srate_idx >= 0 && srate_idx < n_srates)
 	{
 		new_srate_idx = srate_idx;
-		somewhat_changed |= 2;
+		setChanged(2);
 		if (h_dialog)
 			ComboBox_SetCurSel(GetDlgItem(h_dialog,IDC_SAMPLERATE),srate_idx);
 		WinradCallBack(-1,WINRAD_SRCHANGE,0,NULL);// Signal application
@@ -697,7 +1272,7 @@ int  LIBRTL_API __stdcall SetAttenuator( int atten_idx )
 			_stprintf_s(str, 255, TEXT("%2.1f  dB"), (float)pos / 10);
 			Static_SetText(GetDlgItem(h_dialog, IDC_GAINVALUE), str);
 			new_gain = pos;
-			somewhat_changed |= 4;
+			setChanged(4);
 		}
 	}
 	new_gain=pos;
@@ -794,13 +1369,136 @@ int   LIBRTL_API __stdcall ExtIoGetSetting( int idx, char * description, char *
 		snprintf(value, 1024, "%d", ASyncConnection);
 		return 0;
 	case 14:
-		snprintf(description, 1024, "%s", "number of Milliseconds to Sleep before trying to receive new data");
+		snprintf(description, 1024, "%s", "deprecated - unused: waiting for data is event driven");
 		snprintf(value, 1024, "%d", SleepMillisWaitingForData);
 		return 0;
 	case 15:
 		snprintf(description, 1024, "%s", "Decimation Factor for Sample Rate");
 		snprintf(value, 1024, "%d", new_Decimation);
 		return 0;
+	case 16:
+		snprintf(description, 1024, "%s", "Decimation Filter below 16: 0 = halfband/FIR (alias free), 1 = sum of pairs (default: cheapest, aliasing)");
+		snprintf(value, 1024, "%d", DecimationFilter);
+		return 0;
+	case 17:
+		snprintf(description, 1024, "%s", "Resampled Output Rate in Hz - 0 for no resampling");
+		snprintf(value, 1024, "%d", new_OutputRate);
+		return 0;
+	case 18:
+		snprintf(description, 1024, "%s", "Output Bits 16 or 32 for CIC Decimation 16 and above");
+		snprintf(value, 1024, "%d", CicOutputBits);
+		return 0;
+	case 19:
+		snprintf(description, 1024, "%s", "Output Float32 Samples - if SDR program supports Sample Formats");
+		snprintf(value, 1024, "%d", FloatOutput);
+		return 0;
+	case 20:
+		snprintf(description, 1024, "%s", "Samples before Retune settled: 0 = pass, 1 = blank, 2 = drop");
+		snprintf(value, 1024, "%d", RetuneFlushPolicy);
+		return 0;
+	case 21:
+		snprintf(description, 1024, "%s", "Retune Settling Time in Milliseconds - after received data");
+		snprintf(value, 1024, "%d", RetuneSettleMillis);
+		return 0;
+	case 22:
+		snprintf(description, 1024, "%s", "Scan Mode: frequency sweep into file instead of streaming");
+		snprintf(value, 1024, "%d", ScanMode);
+		return 0;
+	case 23:
+		snprintf(description, 1024, "%s", "Scan Plan: start-stop:step@dwell_ms;freq@dwell_ms in Hz");
+		snprintf(value, 1024, "%s", ScanSpec);
+		return 0;
+	case 24:
+		snprintf(description, 1024, "%s", "Scan FFT Size");
+		snprintf(value, 1024, "%d", ScanFftSize);
+		return 0;
+	case 25:
+		snprintf(description, 1024, "%s", "Scan Result File");
+		snprintf(value, 1024, "%s", ScanFile);
+		return 0;
+	case 26:
+		snprintf(description, 1024, "%s", "Fine Tuning Window in Percent without Retune - 0 to retune always");
+		snprintf(value, 1024, "%d", NcoWindowPercent);
+		return 0;
+	case 27:
+		snprintf(description, 1024, "%s", "Software Offset Tuning: tuner fs/4 off, with decimation");
+		snprintf(value, 1024, "%d", SoftwareOffsetTuning);
+		return 0;
+	case 28:
+		snprintf(description, 1024, "%s", "DC/IQ Correction: 0 = off, 1 = DC, 2 = DC and I/Q imbalance");
+		snprintf(value, 1024, "%d", DcIqCorrection);
+		return 0;
+	case 29:
+		snprintf(description, 1024, "%s", "Direct Sampling pin I/Q: real samples to complex at half samplerate");
+		snprintf(value, 1024, "%d", DirectSamplingReal);
+		return 0;
+	case 30:
+		snprintf(description, 1024, "%s", "Benchmark: 1 = log conversion and decimation kernel timings after next start");
+		snprintf(value, 1024, "%d", RunBenchmark);
+		return 0;
+	case 31:
+		snprintf(description, 1024, "%s", "Kernel Autotune: 1 = pick fastest kernels at start, cached per CPU");
+		snprintf(value, 1024, "%d", KernelAutotune);
+		return 0;
+	case 32:
+		snprintf(description, 1024, "%s", "Kernel Tuning Record - written by the autotuner");
+		snprintf(value, 1024, "%s", KernelTuneRecord);
+		return 0;
+	case 33:
+		snprintf(description, 1024, "%s", "Status, read only: Active Kernels");
+		bench_kernel_choice(value, 1024);
+		return 0;
+	case 34:
+		snprintf(description, 1024, "%s", "Large Pages: 1 = sample buffers in large pages, if the user right is granted");
+		snprintf(value, 1024, "%d", LargePages);
+		return 0;
+	case 35:
+		snprintf(description, 1024, "%s", "Callback Size in I/Q Pairs for all Outputs - 0 for half the buffer size");
+		snprintf(value, 1024, "%d", CallbackSize);
+		return 0;
+	case 36:
+		snprintf(description, 1024, "%s", "Jitter Buffer: 1 = hold blocks by the measured network jitter, 0 = process on arrival");
+		snprintf(value, 1024, "%d", JitterBufferMode);
+		return 0;
+	case 37:
+		snprintf(description, 1024, "%s", "Jitter Buffer Drop Target in Per Mille of late blocks");
+		snprintf(value, 1024, "%d", JitterDropPermille);
+		return 0;
+	case 38:
+		snprintf(description, 1024, "%s", "Status, read only: Jitter Buffer Depth in Milliseconds");
+		snprintf(value, 1024, "%.1f", (jitterBuf.byteRate() > 0) ? rcvRing.fill() * 1000.0 / jitterBuf.byteRate() : 0.0);
+		return 0;
+	case 39:
+		snprintf(description, 1024, "%s", "Status, read only: Jitter Buffer Latency in Milliseconds and late Blocks");
+		snprintf(value, 1024, "%.1f ms, %u of %u late", jitterBuf.delay() * 1000.0 / ticksPerSecond()
+			, jitterBuf.lateBlocks(), jitterBuf.arrivals());
+		return 0;
+	case 40:
+		snprintf(description, 1024, "%s", "Paced Delivery: 1 = callbacks on a samplerate clock, 0 = on arrival");
+		snprintf(value, 1024, "%d", PacedDelivery);
+		return 0;
+	case 41:
+		snprintf(description, 1024, "%s", "Status, read only: Callback Cadence");
+		snprintf(value, 1024, "%s", cadenceReport);
+		return 0;
+	case 42:
+		snprintf(description, 1024, "%s", "Metrics Port on localhost - 0 = off");
+		snprintf(value, 1024, "%d", MetricsPort);
+		return 0;
+	case 43:
+		{
+			const double secPerTick = 1.0 / (double)ticksPerSecond();
+			const int64_t callbackTicks = counters.callbackTicks.load(std::memory_order_relaxed);
+			const int64_t paceTicks = counters.paceTicks.load(std::memory_order_relaxed);
+			snprintf(description, 1024, "%s", "Status, read only: Stream");
+			snprintf(value, 1024, "%d of %d Hz, %u reconnects, %u callbacks, %u leftover copies, conversion %.1f s, callback %.1f s"
+				, counters.byteRate.load(std::memory_order_relaxed) / 2, samplerates[new_srate_idx].valueInt
+				, counters.reconnects.load(std::memory_order_relaxed), counters.callbacks.load(std::memory_order_relaxed)
+				, chunker.stagedChunks()
+				, (counters.processTicks.load(std::memory_order_relaxed) - callbackTicks - paceTicks) * secPerTick
+				, callbackTicks * secPerTick);
+		}
+		return 0;
 	default:
 		return -1;	// ERROR
 	}
@@ -853,7 +1551,10 @@ void  LIBRTL_API __stdcall ExtIoSetSetting( int idx, const char * value )
 	case 10:
 		tempInt = atoi( value );
 		if (  tempInt>=0 && tempInt < (sizeof(buffer_sizes)/sizeof(buffer_sizes[0])) )
+		{
 			bufferSizeIdx = tempInt;
+			buffer_len = buffer_sizes[bufferSizeIdx] * 1024;
+		}
 		return;
 	case 11:
 		new_OffsetTuning = atoi(value) ? 1 : 0;
@@ -876,8 +1577,113 @@ void  LIBRTL_API __stdcall ExtIoSetSetting( int idx, const char * value )
 
 		if (new_Decimation < 1)
 			new_Decimation = 1;
-		else if (new_Decimation > 2)
+		else if (new_Decimation > CIC_MAX_DECIMATION)
+			new_Decimation = CIC_MAX_DECIMATION;
+		else if (new_Decimation >= CIC_MIN_DECIMATION)
 			new_Decimation = new_Decimation & (~1);
+		else
+		{
+			while (!isFilterDecimation(new_Decimation))
+				--new_Decimation;
+		}
+		break;
+	case 16:
+		DecimationFilter = atoi(value) ? 1 : 0;
+		break;
+	case 17:
+		tempInt = atoi(value);
+		new_OutputRate = (tempInt > 0) ? tempInt : 0;
+		break;
+	case 18:
+		CicOutputBits = (atoi(value) == 16) ? 16 : 32;
+		break;
+	case 19:
+		FloatOutput = atoi(value) ? 1 : 0;
+		break;
+	case 20:
+		tempInt = atoi(value);
+		RetuneFlushPolicy = (tempInt >= RETUNE_PASS && tempInt <= RETUNE_DROP) ? tempInt : RETUNE_BLANK;
+		break;
+	case 21:
+		tempInt = atoi(value);
+		RetuneSettleMillis = (tempInt < 0) ? 0 : (tempInt > 1000) ? 1000 : tempInt;
+		break;
+	case 22:
+		ScanMode = atoi(value) ? 1 : 0;
+		++scanPlanChanged;
+		signalControl();
+		break;
+	case 23:
+		EnterCriticalSection(&scanLock.cs);
+		snprintf(ScanSpec, sizeof(ScanSpec), "%s", value);
+		LeaveCriticalSection(&scanLock.cs);
+		++scanPlanChanged;
+		signalControl();
+		break;
+	case 24:
+		tempInt = atoi(value);
+		if (tempInt >= SCAN_MIN_FFT && tempInt <= SCAN_MAX_FFT && !(tempInt & (tempInt - 1)))
+			ScanFftSize = tempInt;
+		++scanPlanChanged;
+		break;
+	case 25:
+		EnterCriticalSection(&scanLock.cs);
+		snprintf(ScanFile, sizeof(ScanFile), "%s", value);
+		LeaveCriticalSection(&scanLock.cs);
+		++scanPlanChanged;
+		break;
+	case 26:
+		tempInt = atoi(value);
+		NcoWindowPercent = (tempInt < 0) ? 0 : (tempInt > 100) ? 100 : tempInt;
+		break;
+	case 27:
+		SoftwareOffsetTuning = atoi(value) ? 1 : 0;
+		setChanged(1024);
+		break;
+	case 28:
+		tempInt = atoi(value);
+		DcIqCorrection = (tempInt < IQCORR_OFF) ? IQCORR_OFF : (tempInt > IQCORR_DC_IQ) ? IQCORR_DC_IQ : tempInt;
+		break;
+	case 29:
+		DirectSamplingReal = atoi(value) ? 1 : 0;
+		break;
+	case 30:
+		RunBenchmark = atoi(value) ? 1 : 0;
+		break;
+	case 31:
+		KernelAutotune = atoi(value) ? 1 : 0;
+		break;
+	case 32:
+		snprintf(KernelTuneRecord, sizeof(KernelTuneRecord) - 1, "%s", value);
+		KernelTuneRecord[sizeof(KernelTuneRecord) - 1] = 0;
+		break;
+	case 33:
+	case 38:
+	case 39:
+	case 41:
+	case 43:
+		// status values: the host saves them with the settings and hands back stale ones
+		break;
+	case 34:
+		LargePages = atoi(value) ? 1 : 0;
+		break;
+	case 35:
+		tempInt = atoi(value);
+		CallbackSize = (tempInt <= 0) ? 0 : (tempInt < MIN_CALLBACK_LEN) ? MIN_CALLBACK_LEN : (tempInt > MAX_CALLBACK_LEN) ? MAX_CALLBACK_LEN : tempInt;
+		break;
+	case 36:
+		JitterBufferMode = atoi(value) ? 1 : 0;
+		break;
+	case 37:
+		tempInt = atoi(value);
+		JitterDropPermille = (tempInt < 1) ? 1 : (tempInt > 500) ? 500 : tempInt;
+		break;
+	case 40:
+		PacedDelivery = atoi(value) ? 1 : 0;
+		break;
+	case 42:
+		tempInt = atoi(value);
+		MetricsPort = (tempInt < 0 || tempInt > 65535) ? 0 : tempInt;
 		break;
 	}
 }
@@ -906,6 +1712,7 @@ void LIBRTL_API __stdcall CloseHW()
 
 	ThreadStreamToSDR = false;
 	Stop_Thread();
+	metricsServer.stop();
 
 	if (h_dialog)
 		DestroyWindow(h_dialog);
@@ -972,6 +1779,104 @@ void LIBRTL_API  __stdcall ExtIoSDRInfo( int extSDRInfo, int additionalValue, vo
 		SDRsupportsSampleFormats = true;
 }
 
+// callback length promised by StartHW() - the host expects exactly this count with every callback
+static int promisedChunkLen()
+{
+	return hostCallbackLen ? hostCallbackLen : hostBlockLen / 2;
+}
+
+// receive ring for buffer_len: RCV_RING_BLOCKS blocks, at least MIN_RCV_RING_SIZE
+static int rcvRingSize()
+{
+	return (RCV_RING_BLOCKS * buffer_len < MIN_RCV_RING_SIZE) ? MIN_RCV_RING_SIZE : RCV_RING_BLOCKS * buffer_len;
+}
+
+// network block length from buffer_len - the ring keeps room for at least 4 blocks
+static int networkBlockLen()
+{
+	const int len = buffer_len;
+	const int maxLen = rcvRing.size() / 4;
+	return (len > maxLen) ? maxLen : (len < 2) ? 2 : len;
+}
+
+// bytes per I/Q pair of the output format
+static int outputPairBytes()
+{
+	switch (extHWtype)
+	{
+	case exthwUSBdataU8:	return 2;
+	case exthwUSBdata16:	return 4;
+	default:				return 8;
+	}
+}
+
+// output of the current chain from a network block: I/Q pairs and the regions written
+static void chainOutput(int blockLen, int * outPairs, int * uses)
+{
+	bench_chain chain;
+	currentChain(chain);
+	bench_chain_output(chain, blockLen, outPairs, uses);
+}
+
+/* sizes the output buffers for blocks of blockLen bytes - at start or in the processing thread.
+ * short_buf, float_buf and int_buf take the output of the current chain from one block - only
+ * those it writes get memory -, at least outPairs in the regions of uses. the staging area takes
+ * a partial callback of the output format, which survives the resizing
+ */
+static bool allocateBuffers(int blockLen, int outPairs = 0, int uses = 0)
+{
+	blockLen = (blockLen < 2) ? 2 : (blockLen > MAX_BUFFER_LEN) ? MAX_BUFFER_LEN : blockLen;
+	int chainPairs, chainUses;
+	chainOutput(blockLen, &chainPairs, &chainUses);
+	outPairs = (outPairs > chainPairs) ? outPairs : chainPairs;
+	uses |= chainUses;
+	const bool wantLarge = (LargePages != 0);
+	const int cbLen = promisedChunkLen();
+	const int pairBytes = outputPairBytes();
+	if (blockLen == pooledBlockLen && wantLarge == pooledLargePages && cbLen == pooledCallbackLen
+		&& outPairs == pooledOutPairs && uses == pooledUses && pairBytes == pooledPairBytes)
+		return true;
+	// staging: a partial callback
+	const int stagePairs = (cbLen < MIN_CALLBACK_LEN) ? MIN_CALLBACK_LEN : cbLen;
+
+	size_t sizes[BLOCKPOOL_SAMPLE_REGIONS];
+	blockpool_sample_sizes(outPairs, uses, stagePairs * pairBytes, sizes);
+
+	pooledBlockLen = 0;
+	if (!bufPool.allocate(sizes, BLOCKPOOL_SAMPLE_REGIONS, wantLarge))
+		return false;
+	short_buf = (short *)bufPool.region(BLOCKPOOL_SHORT);
+	float_buf = (float *)bufPool.region(BLOCKPOOL_FLOAT);
+	int_buf = (int32_t *)bufPool.region(BLOCKPOOL_INT);
+	chunker.setStaging(bufPool.region(BLOCKPOOL_STAGE), (int)sizes[BLOCKPOOL_STAGE]);
+	pooledBlockLen = blockLen;
+	pooledCallbackLen = cbLen;
+	pooledLargePages = wantLarge;
+	pooledOutPairs = outPairs;
+	pooledUses = uses;
+	pooledPairBytes = pairBytes;
+
+	char acMsg[256];
+	snprintf(acMsg, 255, "output buffers for %d kByte blocks, %d output pairs: %d kBytes%s"
+		, blockLen / 1024, outPairs, (int)(bufPool.footprint() / 1024), bufPool.largePages() ? " in large pages" : "");
+	SDRLOG(MSG_DEBUG, acMsg);
+	if (wantLarge && !bufPool.largePages())
+		SDRLOG(MSG_DEBUG, "large pages not available - using normal pages");
+	return true;
+}
+
+// a path is about to write outPairs I/Q pairs per block slice to the regions of uses. the settings
+// may have changed since the check at the start of the block: grows the buffers when needed
+static bool reserveOutput(int outPairs, int uses)
+{
+	if (outPairs <= pooledOutPairs && (uses & ~pooledUses) == 0)
+		return true;
+	if (allocateBuffers(pooledBlockLen, outPairs, uses | pooledUses))
+		return true;
+	SDRLOG(MSG_ERROR, "Error: could not allocate the output buffers!");
+	return false;
+}
+
 int Start_Thread()
 {
 	//If already running, exit
@@ -981,24 +1886,18 @@ int Start_Thread()
 	terminateThread = false;
 	GotTunerInfo = false;
 
-	if (!rcvBufsAllocated)
+	if (rcvEvent == NULL)
+		rcvEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (ctrlEvent == NULL)
+		ctrlEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	// threads are stopped: the ring can be resized - also shrunk
+	const int ringSize = rcvRingSize();
+	if (rcvRing.size() < ringSize || rcvRing.size() > 2 * ringSize)
+		rcvRing.allocate(ringSize);
+	if (rcvEvent == NULL || ctrlEvent == NULL || rcvRing.size() < ringSize || !allocateBuffers(networkBlockLen()))
 	{
-		short_buf = new (std::nothrow) short[MAX_BUFFER_LEN + 1024];
-		if (short_buf == 0)
-		{
-			MessageBox(NULL, TEXT("Couldn't Allocate Sample Buffer!"), TEXT("Error!"), MB_OK | MB_ICONERROR);
-			return -1;
-		}
-		for (int k = 0; k <= NUM_BUFFERS_BEFORE_CALLBACK; ++k)
-		{
-			rcvBuf[k] = new (std::nothrow) uint8_t[MAX_BUFFER_LEN + 1024];
-			if (rcvBuf[k] == 0)
-			{
-				MessageBox(NULL, TEXT("Couldn't Allocate Sample Buffers!"), TEXT("Error!"), MB_OK | MB_ICONERROR);
-				return -1;
-			}
-		}
-		rcvBufsAllocated = true;
+		MessageBox(NULL, TEXT("Couldn't Allocate Sample Buffers!"), TEXT("Error!"), MB_OK | MB_ICONERROR);
+		return -1;
 	}
 
 	worker_handle = (HANDLE) _beginthread( ThreadProc, 0, NULL );
@@ -1015,14 +1914,492 @@ int Stop_Thread()
 		return 0;
 
 	terminateThread = true;
+	signalControl();
 	WaitForSingleObject(worker_handle,INFINITE);
 	GotTunerInfo = false;
 	return 0;
 }
 
 
+static void deliverChunk(int nPairs, void * samples)
+{
+	LARGE_INTEGER t0, t1, t2;
+	QueryPerformanceCounter(&t0);
+	if (PacedDelivery)
+		pacer.wait(nPairs, GetHWSR(), rcvRing.fill() > rcvRing.size() / 2);
+	else
+		pacer.passed();
+	QueryPerformanceCounter(&t1);
+	WinradCallBack(nPairs, 0, 0, samples);
+	QueryPerformanceCounter(&t2);
+	counters.add(counters.paceTicks, t1.QuadPart - t0.QuadPart);
+	counters.add(counters.callbackTicks, t2.QuadPart - t1.QuadPart);
+	counters.increment(counters.callbacks);
+
+	if (pacer.released.count() >= 4096)
+	{
+		const double msPerTick = 1000.0 / (double)pacer.tickFreq();
+		snprintf(cadenceReport, sizeof(cadenceReport) - 1, "interval %.2f ms, jitter %.3f ms unpaced / %.3f ms %s, max %.2f / %.2f ms, %u restarts, %u hurried"
+			, pacer.released.mean() * msPerTick, pacer.ready.deviation() * msPerTick, pacer.released.deviation() * msPerTick
+			, PacedDelivery ? "paced" : "delivered", pacer.ready.maximum() * msPerTick, pacer.released.maximum() * msPerTick
+			, pacer.reanchors(), pacer.hurried());
+		cadenceReport[sizeof(cadenceReport) - 1] = 0;
+		counters.intervalMicros.store((int)(pacer.released.mean() * msPerTick * 1000.0), std::memory_order_relaxed);
+		counters.cadenceJitterMicros.store((int)(pacer.released.deviation() * msPerTick * 1000.0), std::memory_order_relaxed);
+		char acMsg[320];
+		snprintf(acMsg, 319, "callback cadence: %s", cadenceReport);
+		SDRLOG(MSG_DEBUG, acMsg);
+		pacer.resetStatistics();
+	}
+}
+
+// deliver n I/Q pairs of pairBytes each through the re-chunker in callbacks of 'chunk' pairs
+static void deliverOutput(const void * samples, int n, int chunk, int pairBytes, bool & printCallbackLen, const char * what)
+{
+	if (!chunker.configure(chunk, pairBytes))
+	{
+		// never deliver another count than promised: drop the output instead
+		if (printCallbackLen)
+			SDRLOG(MSG_ERROR, "Error: callback size does not fit the staging buffer - output dropped!");
+		printCallbackLen = false;
+		return;
+	}
+	if (printCallbackLen)
+	{
+		char acMsg[256];
+		printCallbackLen = false;
+		snprintf(acMsg, 255, "Callback() with %d %s %s I/Q pairs", chunk, what
+			, (pairBytes == 2) ? "8 bit" : (pairBytes == 4) ? "16 bit" : (extHWtype == exthwUSBfloat32) ? "float" : "32 bit");
+		SDRLOG(MSG_DEBUG, acMsg);
+	}
+	chunker.push(samples, n, deliverChunk);
+}
+
+// deliver n I/Q pairs from float_buf - as float or 16 bit
+static void deliverFloatOutput(int n, int chunk, bool & printCallbackLen, const char * what)
+{
+	if (extHWtype == exthwUSBfloat32)
+		deliverOutput(float_buf, n, chunk, 2 * sizeof(float), printCallbackLen, what);
+	else
+	{
+		conv_f32_to_s16(float_buf, short_buf, 2 * n);
+		deliverOutput(short_buf, n, chunk, 2 * sizeof(short), printCallbackLen, what);
+	}
+}
+
+
+// receive thread: parses the scan settings into a snapshot for the processing thread.
+// returns false on an invalid plan
+static bool startScan(char * acMsg)
+{
+	ScanSnapshot * snap = new (std::nothrow) ScanSnapshot;
+	if (!snap)
+	{
+		snprintf(acMsg, 255, "scan: out of memory");
+		return false;
+	}
+	char spec[sizeof(ScanSpec)];
+	EnterCriticalSection(&scanLock.cs);
+	memcpy(spec, ScanSpec, sizeof(spec));
+	memcpy(snap->file, ScanFile, sizeof(snap->file));
+	LeaveCriticalSection(&scanLock.cs);
+	spec[sizeof(spec) - 1] = 0;
+	snap->file[sizeof(snap->file) - 1] = 0;
+	snap->fftSize = ScanFftSize;
+	snap->samplerate = samplerates[new_srate_idx].valueInt;
+
+	if (!scan_parse_plan(spec, snap->plan))
+	{
+		snprintf(acMsg, 255, "scan: invalid plan '%s'", spec);
+		delete snap;
+		return false;
+	}
+	scanPlan = snap->plan;
+	snap->generation = ++scanGeneration;
+	snprintf(acMsg, 255, "scan: %d steps into '%s'", (int)scanPlan.size(), snap->file);
+	// a snapshot the processing thread did not take yet is outdated
+	delete pendingScan.exchange(snap);
+	return true;
+}
+
+/* integrates a block of a scan step. the result file is (re)opened with each new scan,
+ * from the snapshot taken at its start. the FFT stays on this thread: while scanning it
+ * delivers no callbacks, it is the worker behind the receive ring
+ */
+static void processScanBlock(const uint8_t * rcvBuf, int len, int tag)
+{
+	const unsigned gen = SCAN_TAG_GEN(tag);
+	if (gen != scannerGeneration)
+	{
+		scannerGeneration = gen;
+		scanner.close();
+		ScanSnapshot * snap = pendingScan.exchange(0);
+		if (snap)
+		{
+			delete activeScan;
+			activeScan = snap;
+		}
+		// blocks of an older scan still in the ring have no snapshot any more: dropped
+		if (activeScan && SCAN_TAG_GEN(SCAN_TAG(activeScan->generation, 0, 0)) == gen
+			&& !scanner.open(activeScan->file, activeScan->plan, activeScan->fftSize, activeScan->samplerate))
+		{
+			char acMsg[256];
+			snprintf(acMsg, 255, "scan: could not create '%s'", activeScan->file);
+			SDRLOG(MSG_ERROR, acMsg);
+		}
+	}
+	if (scanner.isOpen())
+		scanner.process(SCAN_TAG_STEP(tag), SCAN_TAG_SWEEP(tag), rcvBuf, len / 2);
+}
+
+// benchmarks of setting 30: on the processing thread, as the autotune. the blocks arriving
+// meanwhile overflow the ring, which the receive thread counts
+static void runBenchmarks()
+{
+	RunBenchmark = 0;
+	bench_conversion(buffer_len / 2, logBenchmarkLine);
+	bench_decimation(buffer_len / 2, logBenchmarkLine);
+	bench_footprint(MAX_BUFFER_LEN, RCV_RING_BLOCKS, MIN_RCV_RING_SIZE, logBenchmarkLine);
+}
+
+// kernels of the processing chain: measured on this thread, which runs them - or the defaults
+static void selectKernels()
+{
+	if (!KernelAutotune)
+	{
+		conv_init();
+		decim_set_cpu_features(-1);
+		return;
+	}
+	bench_chain chain;
+	currentChain(chain);
+	char record[sizeof(KernelTuneRecord)];
+	memcpy(record, KernelTuneRecord, sizeof(record));
+	record[sizeof(record) - 1] = 0;
+	const bool measured = bench_autotune(record, sizeof(record), buffer_len / 2, chain);
+	if (measured)
+		memcpy(KernelTuneRecord, record, sizeof(record));
+
+	char choice[256];
+	char acMsg[384];
+	bench_kernel_choice(choice, sizeof(choice));
+	snprintf(acMsg, sizeof(acMsg) - 1, "%s kernels: %s", measured ? "autotuned" : "cached", choice);
+	acMsg[sizeof(acMsg) - 1] = 0;
+	SDRLOG(MSG_DEBUG, acMsg);
+}
+
+unsigned __stdcall ProcessThreadProc(void *p)
+{
+	char acMsg[256];
+	unsigned generation = streamGeneration - 1;
+	unsigned ncoEpoch = hwRetunes;
+	unsigned kernels = kernelRequest - 1;
+	int resampleSrate = 0;
+	int resampleRate = 0;
+	bool cicActive = false;			// CIC instead of halfband/FIR decimation
+	bool sumActive = false;			// integer sums instead of the decimator
+	bool printCallbackLen = true;
+	unsigned jitterBlocks = 0;
+
+	while (!terminateProcessing)
+	{
+		int blockBytes = 0;
+		int tag = 0;
+		uint64_t blockPos = 0;
+		const uint8_t * block = rcvRing.readBlock(&blockBytes, &tag, &blockPos);
+		if (!block)
+		{
+			WaitForSingleObject(rcvEvent, 100);
+			continue;
+		}
+		if (!ThreadStreamToSDR)
+		{
+			// stopped: no more callbacks
+			rcvRing.release();
+			continue;
+		}
+
+		if (generation != streamGeneration)
+		{
+			// new connection: restart filters
+			generation = streamGeneration;
+			chunker.reset();
+			pacer.reset();
+			resampleSrate = resampleRate = 0;
+			cicActive = sumActive = false;
+			printCallbackLen = true;
+			decimator.reset();
+			nco.reset();
+			iqCorrector.reset();
+		}
+		if (kernels != kernelRequest)
+		{
+			// started: kernels for the chain of this start, stages pick them again
+			kernels = kernelRequest;
+			if (RunBenchmark)
+				runBenchmarks();
+			selectKernels();
+			decimator.reset();
+		}
+
+		if (tag)
+		{
+			processScanBlock(block, blockBytes, tag);
+			rcvRing.release();
+			continue;
+		}
+		else if (scanner.isOpen())
+			scanner.close();
+
+		LARGE_INTEGER processStart;
+		QueryPerformanceCounter(&processStart);
+		if (JitterBufferMode)
+		{
+			waitUntilDue(blockPos, blockBytes);
+			LARGE_INTEGER due;
+			QueryPerformanceCounter(&due);
+			counters.add(counters.paceTicks, due.QuadPart - processStart.QuadPart);
+			if (++jitterBlocks % 4096 == 0)
+			{
+				snprintf(acMsg, 255, "jitter buffer: delay %.1f ms, %.1f ms queued, %u of %u blocks late"
+					, jitterBuf.delay() * 1000.0 / ticksPerSecond(), rcvRing.fill() * 1000.0 / jitterBuf.byteRate()
+					, jitterBuf.lateBlocks(), jitterBuf.arrivals());
+				SDRLOG(MSG_DEBUG, acMsg);
+			}
+		}
+
+		int chainPairs, chainUses;
+		chainOutput(networkBlockLen(), &chainPairs, &chainUses);
+		if (networkBlockLen() != pooledBlockLen || promisedChunkLen() != pooledCallbackLen || (LargePages != 0) != pooledLargePages
+			|| chainPairs != pooledOutPairs || chainUses != pooledUses || outputPairBytes() != pooledPairBytes)
+		{
+			// buffer size or chain changed while running: resized, staged output moves along.
+			// restarted with another callback size: staged output is lost
+			if (promisedChunkLen() != pooledCallbackLen)
+				printCallbackLen = true;
+			if (!allocateBuffers(networkBlockLen()))
+			{
+				SDRLOG(MSG_ERROR, "Error: could not allocate the output buffers!");
+				rcvRing.release();
+				continue;
+			}
+		}
+
+		if (ncoEpoch != hwRetunes)
+		{
+			// tuner got retuned: offset starts from zero phase
+			ncoEpoch = hwRetunes;
+			nco.reset();
+		}
+		nco.setFrequency((double)ncoOffset / samplerates[new_srate_idx].valueInt);
+		iqCorrector.setMode(DcIqCorrection);
+		if (iqCorrector.blocks() >= 1024)
+		{
+			snprintf(acMsg, 255, "DC/IQ correction: %.1f %% over plain conversion; DC %.2f / %.2f, gain %.4f, phase %.2f deg"
+				, iqCorrector.costPercent(), iqCorrector.dcI(), iqCorrector.dcQ()
+				, iqCorrector.gainRatio(), iqCorrector.phaseDegrees());
+			SDRLOG(MSG_DEBUG, acMsg);
+			iqCorrector.resetCost();
+		}
+		const bool floatOutput = (extHWtype == exthwUSBfloat32);
+		const float outScale = floatOutput ? FLOAT_OUTPUT_SCALE : 1.0F;
+		const int input = realInput();
+
+		// every block is processed on arrival: decimators keep their state between blocks.
+		// network blocks longer than the output buffers are processed in slices
+		for (int offset = 0; offset < blockBytes; offset += pooledBlockLen)
+		{
+			const uint8_t * rcvBuf = block + offset;
+			const int len = (blockBytes - offset < pooledBlockLen) ? blockBytes - offset : pooledBlockLen;
+			const int n_samples_per_block = len / 2;
+
+			if (new_OutputRate > 0 && (extHWtype == exthwUSBdata16 || floatOutput))
+			{
+				// resampling: callbacks of the size announced by StartHW()
+				const int srate = samplerates[new_srate_idx].valueInt;
+				if (resampleSrate != srate || resampleRate != new_OutputRate || cicActive || sumActive
+					|| decimator.input() != input || decimator.filter() != DECIM_FILTER_HALFBAND)
+				{
+					cicActive = sumActive = false;
+					int preDecimation, L, M;
+					resampleSrate = srate;
+					resampleRate = new_OutputRate;
+					chunker.reset();
+					// the real path delivers half the samplerate to the resampling
+					const int inRate = (input != DECIM_INPUT_IQ) ? srate / 2 : srate;
+					if (!planResampling(inRate, new_OutputRate, &preDecimation, &L, &M))
+					{
+						preDecimation = 1;
+						L = M = 1;
+						snprintf(acMsg, 255, "Error: cannot resample %d Hz to %d Hz!", srate, (int)new_OutputRate);
+						SDRLOG(MSG_ERROR, acMsg);
+					}
+					decimator.configure(preDecimation, input);
+					resampler.configure(L, M);
+					snprintf(acMsg, 255, "resampling %d Hz: decimation %d, then %d / %d", srate, decimator.factor(), L, M);
+					SDRLOG(MSG_DEBUG, acMsg);
+				}
+
+				decimator.setScale(outScale * (float)srate / (float)new_OutputRate);
+				float * rsIn = resampler.inputPtr(n_samples_per_block / decimator.factor() + 1);
+				const int n_decimated = decimator.process(rcvBuf, n_samples_per_block, rsIn, &nco, &iqCorrector);
+				if (!reserveOutput(resampler.maxOutput(n_decimated), BLOCKPOOL_USE_FLOAT | (floatOutput ? 0 : BLOCKPOOL_USE_SHORT)))
+					continue;
+				const int n_out = resampler.run(n_decimated, float_buf);
+
+				deliverFloatOutput(n_out, promisedChunkLen(), printCallbackLen, "resampled");
+			}
+			else if (FULL_DECIMATION && new_Decimation >= CIC_MIN_DECIMATION && input == DECIM_INPUT_IQ)
+			{
+				// CIC: memory does not grow with the decimation
+				if (!cicActive || cic.factor() != new_Decimation)
+				{
+					if (!cic.configure(new_Decimation))
+					{
+						snprintf(acMsg, 255, "Error: CIC decimation %d not supported!", (int)new_Decimation);
+						SDRLOG(MSG_ERROR, acMsg);
+					}
+					cicActive = true;
+					sumActive = false;
+					resampleRate = 0;
+					chunker.reset();
+				}
+				const int cicUses = floatOutput ? BLOCKPOOL_USE_FLOAT : (extHWtype != exthwFullPCM32) ? BLOCKPOOL_USE_SHORT : 0;
+				if (!reserveOutput(n_samples_per_block / cic.factor() + 1, BLOCKPOOL_USE_INT | cicUses))
+					continue;
+				const int n_out = cic.process(rcvBuf, n_samples_per_block, int_buf, &nco, &iqCorrector);
+
+				// fixed blocks of the promised length: buffer_len / 2 I/Q pairs
+				const int chunk = promisedChunkLen();
+				if (floatOutput)
+				{
+					// 16 bit level: 2^31 -> 2^15 -> 1.0
+					conv_s32_to_f32(int_buf, float_buf, 2 * n_out, 1.0F / 2147483648.0F);
+					deliverOutput(float_buf, n_out, chunk, 2 * sizeof(float), printCallbackLen, "CIC decimated");
+				}
+				else if (extHWtype != exthwFullPCM32)
+				{
+					conv_s32_to_s16(int_buf, short_buf, 2 * n_out);
+					deliverOutput(short_buf, n_out, chunk, 2 * sizeof(short), printCallbackLen, "CIC decimated");
+				}
+				else
+					deliverOutput(int_buf, n_out, chunk, 2 * sizeof(int32_t), printCallbackLen, "CIC decimated");
+			}
+			else if ((new_Decimation > 1 || input != DECIM_INPUT_IQ) && (extHWtype == exthwUSBdata16 || floatOutput))
+			{
+				const int filter = decimationFilter();
+				if (filter != DECIM_FILTER_HALFBAND && input == DECIM_INPUT_IQ && !floatOutput
+					&& !nco.active() && iqCorrector.mode() == IQCORR_OFF)
+				{
+					// the former sums in integer arithmetic: cheapest, nothing to shift or correct
+					const bool moving = (filter == DECIM_FILTER_MOVING_SUM);
+					if (!sumActive || sumDecimator.factor() != new_Decimation || sumDecimator.moving() != moving)
+					{
+						sumDecimator.configure(new_Decimation, moving);
+						sumActive = true;
+						resampleRate = 0;
+						cicActive = false;
+						chunker.reset();
+					}
+					if (!reserveOutput(moving ? n_samples_per_block : n_samples_per_block / new_Decimation + 1, BLOCKPOOL_USE_SHORT))
+						continue;
+					const int n_out = sumDecimator.process(rcvBuf, n_samples_per_block, short_buf);
+					deliverOutput(short_buf, n_out, promisedChunkLen(), 2 * sizeof(short), printCallbackLen
+						, moving ? "sum filtered" : "sum decimated");
+				}
+				else
+				{
+					// halfband/FIR or sum decimation - also the real path: output collects to the promised callback length
+					if (decimator.factor() != totalDecimation() || decimator.input() != input || decimator.filter() != filter
+						|| resampleRate || cicActive || sumActive)
+					{
+						decimator.configure(new_Decimation, input, filter);
+						resampleRate = 0;
+						cicActive = sumActive = false;
+						chunker.reset();
+					}
+					// the sums have the gain of the decimation: scale the halfband/FIR output to their level
+					decimator.setScale((filter == DECIM_FILTER_HALFBAND) ? outScale * (float)new_Decimation : outScale);
+
+					if (!reserveOutput(n_samples_per_block / decimator.factor() + 1, BLOCKPOOL_USE_FLOAT | (floatOutput ? 0 : BLOCKPOOL_USE_SHORT)))
+						continue;
+					const int n_out = decimator.process(rcvBuf, n_samples_per_block, float_buf, &nco, &iqCorrector);
+					deliverFloatOutput(n_out, promisedChunkLen()
+						, printCallbackLen, (input != DECIM_INPUT_IQ) ? "real to complex decimated" : "decimated");
+				}
+			}
+			else if (floatOutput)
+			{
+				// bias removal, correction and scaling in one pass
+				if (!reserveOutput(n_samples_per_block, BLOCKPOOL_USE_FLOAT))
+					continue;
+				iq_input(rcvBuf, float_buf, n_samples_per_block, FLOAT_OUTPUT_SCALE, &iqCorrector, 0);
+				deliverOutput(float_buf, n_samples_per_block, promisedChunkLen(), 2 * sizeof(float), printCallbackLen, "raw");
+			}
+			else if (extHWtype == exthwUSBdata16)
+			{
+				if (!reserveOutput(n_samples_per_block, BLOCKPOOL_USE_SHORT | ((iqCorrector.mode() != IQCORR_OFF) ? BLOCKPOOL_USE_FLOAT : 0)))
+					continue;
+				if (iqCorrector.mode() != IQCORR_OFF)
+				{
+					iq_input(rcvBuf, float_buf, n_samples_per_block, 1.0F, &iqCorrector, 0);
+					conv_f32_to_s16(float_buf, short_buf, len);
+				}
+				else
+					conv_u8_to_s16(rcvBuf, short_buf, len);
+				deliverOutput(short_buf, n_samples_per_block, promisedChunkLen(), 2 * sizeof(short), printCallbackLen, "raw");
+			}
+			else
+				deliverOutput(rcvBuf, n_samples_per_block, promisedChunkLen(), 2, printCallbackLen, "raw");
+		}
+
+		LARGE_INTEGER processEnd;
+		QueryPerformanceCounter(&processEnd);
+		counters.add(counters.processTicks, processEnd.QuadPart - processStart.QuadPart);
+		rcvRing.release();
+	}
+	scanner.close();
+	delete activeScan;
+	activeScan = 0;
+	return 0;
+}
+
+
+// waits until the socket has data, a control change is signalled - or the timeout elapses.
+// without the event of WSAEventSelect() WSAPoll() waits for the data alone
+static void waitForSocket(CActiveSocket &conn, WSAEVENT sockEvent)
+{
+	if (sockEvent == WSA_INVALID_EVENT)
+	{
+		WSAPOLLFD pfd;
+		pfd.fd = conn.GetSocketDescriptor();
+		pfd.events = POLLRDNORM;
+		pfd.revents = 0;
+		if (WSAPoll(&pfd, 1, SOCKET_POLL_TIMEOUT_MS) == SOCKET_ERROR)
+			::Sleep(1);
+		return;
+	}
+	HANDLE events[2] = { sockEvent, ctrlEvent };
+	WaitForMultipleObjects(2, events, FALSE, SOCKET_WAIT_TIMEOUT_MS);
+	// FD_READ gets re-enabled with the next Receive(): no data is missed
+	WSAResetEvent(sockEvent);
+}
+
+
 void ThreadProc(void *p)
 {
+	// network reception here, processing and callbacks in ProcessThreadProc
+	// network block length: follows buffer_len at block boundaries
+	int blockLen = 0;
+	terminateProcessing = false;
+	HANDLE process_handle = (HANDLE)_beginthreadex(NULL, 0, ProcessThreadProc, NULL, 0, NULL);
+	if (process_handle == 0)
+	{
+		SDRLOG(MSG_ERROR, "Error: could not start processing thread!");
+		worker_handle = INVALID_HANDLE_VALUE;
+		_endthread();
+	}
+
 	while (!terminateThread)
 	{
 		// E4000 = 1, FC0012 = 2, FC0013 = 3, FC2580 = 4, R820T = 5, R828D = 6
@@ -1034,6 +2411,10 @@ void ThreadProc(void *p)
 			PostMessage(h_dialog, WM_PRINT, (WPARAM)0, (LPARAM)PRF_CLIENT);
 
 		CActiveSocket conn;
+		WSAEVENT sockEvent = WSA_INVALID_EVENT;
+		unsigned staleBlocksDropped = 0;	// statistics of retune settling
+		unsigned staleBlocksBlanked = 0;
+		unsigned ncoRetunes = 0;			// LO moves done by the nco
 		const bool initOK = conn.Initialize();
 		const bool connOK = conn.Open(RTL_TCP_IPAddr, (uint16_t)RTL_TCP_PortNo);
 
@@ -1050,8 +2431,23 @@ void ThreadProc(void *p)
 			goto label_reConnect;
 		}
 
+		// commands are small: send them without Nagle's delay
+		if (!conn.DisableNagleAlgoritm())
+			SDRLOG(MSG_WARNING, "could not set TCP_NODELAY");
+
 		if (ASyncConnection)
+		{
 			conn.SetNonblocking();
+			// wait for data with an event - instead of polling with Sleep()
+			sockEvent = WSACreateEvent();
+			if (sockEvent != WSA_INVALID_EVENT
+				&& WSAEventSelect(conn.GetSocketDescriptor(), sockEvent, FD_READ | FD_CLOSE) == SOCKET_ERROR)
+			{
+				WSACloseEvent(sockEvent);
+				sockEvent = WSA_INVALID_EVENT;
+				SDRLOG(MSG_WARNING, "WSAEventSelect() failed: waiting with WSAPoll()");
+			}
+		}
 		else
 			conn.SetBlocking();
 
@@ -1100,8 +2496,8 @@ void ThreadProc(void *p)
 					hdrOK = false;
 					break;
 				}
-				else if (CSimpleSocket::SocketEwouldblock == err && SleepMillisWaitingForData >= 0)
-					::Sleep(SleepMillisWaitingForData);
+				else if (CSimpleSocket::SocketEwouldblock == err)
+					waitForSocket(conn, sockEvent);
 			}
 		}
 		if (!hdrOK)
@@ -1138,46 +2534,97 @@ void ThreadProc(void *p)
 		}
 
 		char acMsg[256];
-		int prevBufferIdx = NUM_BUFFERS_BEFORE_CALLBACK - 1;
-		int receiveBufferIdx = 0;
 		int receivedLen = 0;
-		int receiveOffset = 2 * MAX_DECIMATIONS;
+		int receiveOffset = 0;
 		unsigned receivedBlocks = 0;
 		int initialSrate = 1;
 		int receivedSamples = 0;
-		bool printCallbackLen = true;
+		int loggedHighWater = 0;
+		bool inOverflow = false;
+		int ringFailed = 0;			// ring size without memory - not tried again
+		uint8_t * rcvBuf = discardBuf;	// block being received: in rcvRing or discardBuf
+		uint64_t streamBytes = 0;		// received since connect
+		int jitterRate = 0;				// byte rate the jitter buffer measures against
+		const int64_t tickFreq = ticksPerSecond();
+		int64_t rateTicks = 0;			// start of the byte rate measurement
+		uint64_t rateBytes = 0;
+		uint64_t settleByte = 0;		// stream offset, where the last retune is effective
+		int scanStep = -1;				// current step of scanPlan, -1 when not scanning
+		int scanSweep = 0;
+		bool scanRetune = false;		// scanStep needs its frequency command
+		uint64_t scanStepEnd = 0;		// stream offset, where the dwell time of scanStep ends
+		unsigned scanPlanSeen = scanPlanChanged - 1;
 		commandEverything = true;
-		memset(&rcvBuf[prevBufferIdx][0], 0, MAX_BUFFER_LEN + 2 * MAX_DECIMATIONS);
+		++streamGeneration;				// processing thread restarts its filters
+		rcvRing.resetStatistics();
 
 		while (!terminateThread)
 		{
+			const bool scanWanted = ThreadStreamToSDR && ScanMode;
+			if (scanWanted && (scanStep < 0 || scanPlanSeen != scanPlanChanged))
+			{
+				// (re)start the scan
+				scanPlanSeen = scanPlanChanged;
+				if (startScan(acMsg))
+				{
+					scanStep = 0;
+					scanSweep = 0;
+					scanRetune = true;
+					SDRLOG(MSG_DEBUG, acMsg);
+				}
+				else
+				{
+					ScanMode = 0;
+					SDRLOG(MSG_ERROR, acMsg);
+				}
+			}
+			else if (!scanWanted && scanStep >= 0)
+			{
+				scanStep = -1;
+				commandEverything = true;	// back to the frequency of the SDR program
+			}
+
 			if (ThreadStreamToSDR && (somewhat_changed || commandEverything))
 			{
+				LONGLONG retuneTicks = 0;
+				bool retuned = false;
+				rtl_tcp_cmds.len = 0;
 				if (last_DirectSampling != new_DirectSampling || commandEverything)
 				{
-					if (!transmitTcpCmd(conn, 0x09, new_DirectSampling))
-						break;
+					queueTcpCmd(0x09, new_DirectSampling);
 					last_DirectSampling = new_DirectSampling;
 					somewhat_changed &= ~(32);
 				}
 				if (last_OffsetTuning != new_OffsetTuning || commandEverything)
 				{
-					if (!transmitTcpCmd(conn, 0x0A, new_OffsetTuning))
-						break;
+					queueTcpCmd(0x0A, new_OffsetTuning);
 					last_OffsetTuning = new_OffsetTuning;
 					somewhat_changed &= ~(64);
 				}
 				if (last_FreqCorrPPM != new_FreqCorrPPM || commandEverything)
 				{
-					if (!transmitTcpCmd(conn, 0x05, new_FreqCorrPPM))
-						break;
+					queueTcpCmd(0x05, new_FreqCorrPPM);
 					last_FreqCorrPPM = new_FreqCorrPPM;
 					somewhat_changed &= ~(128);
 				}
 				if (last_freq != new_freq || commandEverything)
 				{
-					if (!transmitTcpCmd(conn, 0x01, new_freq))
-						break;
+					if (scanStep < 0)
+					{
+						// scanning: frequency of the SDR program is restored when the scan stops
+						const long move = new_freq + tunerOffset - hw_freq;
+						if (!commandEverything && tunerOffset == softwareOffset() && labs(move) <= ncoMaxOffset())
+						{
+							ncoOffset = new_freq - hw_freq;		// digital: no PLL relock, no stale samples
+							++ncoRetunes;
+						}
+						else
+						{
+							queueTunerFreq();
+							retuneTicks = freqChangeTicks;
+							retuned = true;
+						}
+					}
 					last_freq = new_freq;
 					somewhat_changed &= ~(1);
 				}
@@ -1185,7 +2632,7 @@ void ThreadProc(void *p)
 				{
 					// re-parametrize TunerAGC
 					{
-						transmitTcpCmd(conn, 0x03, 1 - new_TunerAGC);
+						queueTcpCmd(0x03, 1 - new_TunerAGC);
 						last_TunerAGC = new_TunerAGC;
 						somewhat_changed &= ~(8);
 					}
@@ -1193,7 +2640,7 @@ void ThreadProc(void *p)
 					// re-parametrize Gain
 					if (new_TunerAGC == 0)
 					{
-						transmitTcpCmd(conn, 0x04, new_gain);
+						queueTcpCmd(0x04, new_gain);
 						last_gain = new_gain;
 						somewhat_changed &= ~(4);
 					}
@@ -1201,30 +2648,28 @@ void ThreadProc(void *p)
 					// re-parametrize Tuner Bandwidth
 					{
 						if (n_bandwidths)
-							transmitTcpCmd(conn, 0x0E, new_TunerBW * 1000);
+							queueTcpCmd(0x0E, new_TunerBW * 1000);
 						last_TunerBW = new_TunerBW;
 						somewhat_changed &= ~(256);
 					}
 
 					// re-parametrize samplerate
 					{
-						if (!transmitTcpCmd(conn, 0x02, samplerates[new_srate_idx].valueInt))
-							break;
+						queueTcpCmd(0x02, samplerates[new_srate_idx].valueInt);
+						retuned = true;
 						last_srate_idx = new_srate_idx;
 						somewhat_changed &= ~(2);
 					}
 				}
 				if (last_TunerBW != new_TunerBW )
 				{
-					if (!transmitTcpCmd(conn, 0x0E, new_TunerBW*1000))
-						break;
+					queueTcpCmd(0x0E, new_TunerBW*1000);
 					last_TunerBW = new_TunerBW;
 					somewhat_changed &= ~(256);
 				}
 				if (last_TunerAGC != new_TunerAGC)
 				{
-					if (!transmitTcpCmd(conn, 0x03, 1-new_TunerAGC))
-						break;
+					queueTcpCmd(0x03, 1-new_TunerAGC);
 					last_TunerAGC = new_TunerAGC;
 					if (new_TunerAGC == 0)
 						last_gain = new_gain + 1;
@@ -1232,8 +2677,7 @@ void ThreadProc(void *p)
 				}
 				if (last_RTLAGC != new_RTLAGC || commandEverything)
 				{
-					if (!transmitTcpCmd(conn, 0x08, new_RTLAGC))
-						break;
+					queueTcpCmd(0x08, new_RTLAGC);
 					last_RTLAGC = new_RTLAGC;
 					somewhat_changed &= ~(16);
 				}
@@ -1242,8 +2686,7 @@ void ThreadProc(void *p)
 					if (new_TunerAGC == 0)
 					{
 						// transmit manual gain only when TunerAGC is off
-						if (!transmitTcpCmd(conn, 0x04, new_gain))
-							break;
+						queueTcpCmd(0x04, new_gain);
 					}
 					last_gain = new_gain;
 					somewhat_changed &= ~(4);
@@ -1254,196 +2697,169 @@ void ThreadProc(void *p)
 					somewhat_changed &= ~(512);
 				}
 
+				if (scanStep < 0 && (tunerOffset != softwareOffset() || labs(ncoOffset + tunerOffset) > ncoMaxOffset()))
+				{
+					// samplerate, decimation or offset mode changed: LO left the nco window
+					queueTunerFreq();
+					retuned = true;
+				}
+				somewhat_changed &= ~(1024);
+
 				commandEverything = false;
+				if (!transmitTcpCmds(conn))
+					break;
+				if (retuned && scanStep >= 0)
+					scanRetune = true;		// samplerate changed: restart the step
+				else if (retuned && RetuneFlushPolicy != RETUNE_PASS)
+					settleByte = settledStreamOffset(conn, streamBytes);
+				if (retuneTicks)
+				{
+					// time from SetHWLO() until the frequency command is on the wire
+					LARGE_INTEGER now;
+					QueryPerformanceCounter(&now);
+					addRetuneLatency(now.QuadPart - retuneTicks);
+				}
+			}
+
+			if (scanStep >= 0 && scanRetune)
+			{
+				// next step right away: settling samples get dropped
+				scanRetune = false;
+				queueTcpCmd(0x01, scanPlan[scanStep].frequency);
+				if (!transmitTcpCmds(conn))
+					break;
+				settleByte = settledStreamOffset(conn, streamBytes);
+				const uint64_t dwellBytes = (uint64_t)scanPlan[scanStep].dwellMillis * samplerates[new_srate_idx].valueInt * 2 / 1000;
+				scanStepEnd = settleByte + dwellBytes;
+			}
+
+			if (receivedLen == 0)
+			{
+				// a larger buffer_len while streaming: the ring grows once the processing has caught up
+				const int ringSize = rcvRingSize();
+				if (ringSize > rcvRing.size() && ringSize != ringFailed && rcvRing.empty())
+				{
+					if (rcvRing.resize(ringSize))
+						snprintf(acMsg, 255, "receive ring: grown to %d kBytes", rcvRing.size() / 1024);
+					else
+					{
+						ringFailed = ringSize;
+						snprintf(acMsg, 255, "receive ring: no memory to grow to %d kBytes", ringSize / 1024);
+					}
+					SDRLOG(MSG_DEBUG, acMsg);
+				}
+				const int wantedLen = networkBlockLen();
+				if (wantedLen != blockLen)
+				{
+					if (blockLen)
+					{
+						snprintf(acMsg, 255, "network block size %d kBytes", wantedLen / 1024);
+						SDRLOG(MSG_DEBUG, acMsg);
+					}
+					blockLen = wantedLen;
+				}
+				// receive straight into the ring - if there is space
+				rcvBuf = ThreadStreamToSDR ? rcvRing.writeBlock(blockLen) : 0;
+				if (!rcvBuf)
+				{
+					if (ThreadStreamToSDR && !inOverflow)
+					{
+						// processing/callback is too slow: block is dropped
+						inOverflow = true;
+						snprintf(acMsg, 255, "receive ring overflow: %u blocks dropped in total", rcvRing.overflows());
+						SDRLOG(MSG_WARNING, acMsg);
+					}
+					rcvBuf = discardBuf;
+				}
 			}
 
-			int32 toRead = buffer_len - receivedLen;
-			int32 nRead = conn.Receive(toRead, &rcvBuf[receiveBufferIdx][receiveOffset]);
+			int32 toRead = blockLen - receivedLen;
+			if (rcvBuf == discardBuf && toRead > DISCARD_LEN)
+				toRead = DISCARD_LEN;		// dropped data: overwrite
+			int32 nRead = conn.Receive(toRead, (rcvBuf == discardBuf) ? discardBuf : &rcvBuf[receiveOffset]);
 			if (nRead > 0)
 			{
 				receivedLen += nRead;
 				receiveOffset += nRead;
-				if (receivedLen >= buffer_len)
+				streamBytes += nRead;
+				counters.bytesReceived.store(counters.bytesReceived.load(std::memory_order_relaxed) + nRead, std::memory_order_relaxed);
+				if (receivedLen >= blockLen)
 				{
-					// copy last MAX_DECIMATIONS I/Q samples from end of prevBufferIdx to begin of current received buffer
-					for (int k = 1; k <= 2 * MAX_DECIMATIONS; ++k)
-						rcvBuf[receiveBufferIdx][2 * MAX_DECIMATIONS - k] = rcvBuf[prevBufferIdx][2 * MAX_DECIMATIONS + buffer_len - k];
-					prevBufferIdx = receiveBufferIdx;
-
-					if (!ThreadStreamToSDR)
+					// arrival against the nominal rate: for the jitter buffer
+					const int byteRate = 2 * samplerates[new_srate_idx].valueInt;
+					if (byteRate != jitterRate)
 					{
-						commandEverything = true;
-						receiveBufferIdx = 0;			// restart reception with 1st decimation buffer
+						jitterRate = byteRate;
+						jitterBuf.reset(byteRate, tickFreq);
 					}
-					else
+					jitterBuf.setDropTarget(JitterDropPermille / 1000.0);
+					LARGE_INTEGER arrivalTicks;
+					QueryPerformanceCounter(&arrivalTicks);
+					jitterBuf.arrival(arrivalTicks.QuadPart, streamBytes);
+					if (!rateTicks)
 					{
-						++receiveBufferIdx;
-						if (receiveBufferIdx >= new_Decimation)
-						{
-							// start over with 1st decimation block - for next reception
-							receiveBufferIdx = 0;
-
-							const int n_samples_per_block = buffer_len / 2;
-							const int n_output_per_block = n_samples_per_block / new_Decimation;
-
-							short * short_ptr = &short_buf[0];
-							for (int callbackBufferNo = 0; callbackBufferNo < new_Decimation; ++callbackBufferNo)
-							{
-								if (new_Decimation > 1 && extHWtype == exthwUSBdata16 )
-								{
-									const unsigned char* char_ptr = &rcvBuf[callbackBufferNo][2*MAX_DECIMATIONS - 2*new_Decimation];
-#if ( !FULL_DECIMATION )
-									// block always starts from scratch without decimation
-									short_ptr = &short_buf[0];
-#endif
-									int i;
+						rateTicks = arrivalTicks.QuadPart;
+						rateBytes = streamBytes;
+					}
+					else if (arrivalTicks.QuadPart - rateTicks >= tickFreq)
+					{
+						counters.byteRate.store((int)((streamBytes - rateBytes) * tickFreq / (arrivalTicks.QuadPart - rateTicks)), std::memory_order_relaxed);
+						rateTicks = arrivalTicks.QuadPart;
+						rateBytes = streamBytes;
+					}
 
-#if ( FULL_DECIMATION )
-	#define CHAR_PTR_INC(D)		(2 * D);
-	#define ITER_COUNT			n_output_per_block
-#else
-	#define CHAR_PTR_INC(D)		(2);
-	#define ITER_COUNT			n_samples_per_block
-#endif
-									switch (new_Decimation)
-									{
-									case 1:
-										for (i = 0; i < ITER_COUNT; i++)
-										{
-											*short_ptr++ = ((short)(char_ptr[0])) - 128;
-											*short_ptr++ = ((short)(char_ptr[1])) - 128;
-											char_ptr += 2;
-										}
-										break;
-									case 2:
-										for (i = 0; i < ITER_COUNT; i++)
-										{
-											*short_ptr++ = ((short)(char_ptr[0])) + ((short)(char_ptr[2])) - 2 * 128;
-											*short_ptr++ = ((short)(char_ptr[1])) + ((short)(char_ptr[3])) - 2 * 128;
-											char_ptr += CHAR_PTR_INC(2);
-										}
-										break;
-									case 4:
-										for (i = 0; i < ITER_COUNT; i++)
-										{
-											*short_ptr++ = ((short)(char_ptr[0]))
-												+ ((short)(char_ptr[2]))
-												+ ((short)(char_ptr[4]))
-												+ ((short)(char_ptr[6])) - 4 * 128;
-											*short_ptr++ = ((short)(char_ptr[1]))
-												+ ((short)(char_ptr[3]))
-												+ ((short)(char_ptr[5]))
-												+ ((short)(char_ptr[7])) - 4 * 128;
-											char_ptr += CHAR_PTR_INC(4);
-										}
-										break;
-									case 6:
-										for (i = 0; i < ITER_COUNT; i++)
-										{
-											*short_ptr++ = ((short)(char_ptr[0]))
-												+ ((short)(char_ptr[2]))
-												+ ((short)(char_ptr[4]))
-												+ ((short)(char_ptr[6]))
-												+ ((short)(char_ptr[8]))
-												+ ((short)(char_ptr[10])) - 6 * 128;
-											*short_ptr++ = ((short)(char_ptr[1]))
-												+ ((short)(char_ptr[3]))
-												+ ((short)(char_ptr[5]))
-												+ ((short)(char_ptr[7]))
-												+ ((short)(char_ptr[9]))
-												+ ((short)(char_ptr[11])) - 6 * 128;
-											char_ptr += CHAR_PTR_INC(6);
-										}
-										break;
-									case 8:
-										for (i = 0; i < ITER_COUNT; i++)
-										{
-											*short_ptr++ = ((short)(char_ptr[0]))
-												+ ((short)(char_ptr[2]))
-												+ ((short)(char_ptr[4]))
-												+ ((short)(char_ptr[6]))
-												+ ((short)(char_ptr[8]))
-												+ ((short)(char_ptr[10]))
-												+ ((short)(char_ptr[12]))
-												+ ((short)(char_ptr[14])) - 8 * 128;
-											*short_ptr++ = ((short)(char_ptr[1]))
-												+ ((short)(char_ptr[3]))
-												+ ((short)(char_ptr[5]))
-												+ ((short)(char_ptr[7]))
-												+ ((short)(char_ptr[9]))
-												+ ((short)(char_ptr[11]))
-												+ ((short)(char_ptr[13]))
-												+ ((short)(char_ptr[15])) - 8 * 128;
-											char_ptr += CHAR_PTR_INC(8);
-										}
-										break;
-									}
-#if ( !FULL_DECIMATION )
-									if (printCallbackLen)
-									{
-										printCallbackLen = false;
-										snprintf(acMsg, 255, "Callback() with %d non-decimated I/Q pairs", ITER_COUNT);
-										SDRLOG(MSG_DEBUG, acMsg);
-									}
-									WinradCallBack(ITER_COUNT, 0, 0, short_buf);
-#endif
-								}
-								else
-								{
-									if (extHWtype == exthwUSBdata16)
-									{
-										short *short_ptr = &short_buf[0];
-										const unsigned char* char_ptr = &rcvBuf[callbackBufferNo][2*MAX_DECIMATIONS];
-										for (int i = 0; i < buffer_len; i++)
-											*short_ptr++ = ((short)(*char_ptr++)) - 128;
-										if (printCallbackLen)
-										{
-											printCallbackLen = false;
-											snprintf(acMsg, 255, "Callback() with %d raw 16 bit I/Q pairs", n_samples_per_block);
-											SDRLOG(MSG_DEBUG, acMsg);
-										}
-										WinradCallBack(n_samples_per_block, 0, 0, short_buf);
-									}
-									else
-									{
-										unsigned char* char_ptr = &rcvBuf[callbackBufferNo][2*MAX_DECIMATIONS];
-										if (printCallbackLen)
-										{
-											printCallbackLen = false;
-											snprintf(acMsg, 255, "Callback() with %d raw 8 Bit I/Q pairs", n_samples_per_block);
-											SDRLOG(MSG_DEBUG, acMsg);
-										}
-										WinradCallBack(n_samples_per_block, 0, 0, char_ptr);
-									}
-								}
-							} // end for
+					// stale samples from before the last retune?
+					const uint64_t blockStart = streamBytes - blockLen;
+					int staleLen = 0;
+					if (blockStart < settleByte && RetuneFlushPolicy != RETUNE_PASS)
+						staleLen = (settleByte - blockStart < (uint64_t)blockLen) ? (int)(settleByte - blockStart) : blockLen;
 
-#if ( FULL_DECIMATION )
-							if (new_Decimation > 1 && extHWtype == exthwUSBdata16)
+					if (!ThreadStreamToSDR)
+						commandEverything = true;
+					else if (scanStep >= 0)
+					{
+						// scan: settled blocks of the current step only
+						if (blockStart >= settleByte && rcvBuf != discardBuf)
+						{
+							rcvRing.commit(blockLen, SCAN_TAG(scanGeneration, scanSweep, scanStep));
+							SetEvent(rcvEvent);
+						}
+						if (streamBytes >= scanStepEnd)
+						{
+							if (++scanStep >= (int)scanPlan.size())
 							{
-								if (printCallbackLen)
-								{
-									printCallbackLen = false;
-									snprintf(acMsg, 255, "Callback() with %d decimated I/Q pairs", n_samples_per_block);
-									SDRLOG(MSG_DEBUG, acMsg);
-								}
-								WinradCallBack(n_samples_per_block, 0, 0, short_buf);
+								scanStep = 0;
+								scanSweep ^= 1;
 							}
-#endif
+							scanRetune = true;
+						}
+					}
+					else if (staleLen == blockLen && RetuneFlushPolicy == RETUNE_DROP)
+						++staleBlocksDropped;
+					else if (rcvBuf != discardBuf)
+					{
+						if (staleLen)
+						{
+							memset(rcvBuf, 128, staleLen);		// 128 == zero sample
+							++staleBlocksBlanked;
+						}
+						rcvRing.commit(blockLen, 0, streamBytes);
+						SetEvent(rcvEvent);
+						inOverflow = false;
+						if (rcvRing.highWater() / 1024 > loggedHighWater)
+						{
+							loggedHighWater = rcvRing.highWater() / 1024;
+							snprintf(acMsg, 255, "receive ring: new high-water mark %d of %d kBytes", loggedHighWater, rcvRing.size() / 1024);
+							SDRLOG(MSG_DEBUG, acMsg);
 						}
 					}
 
 					++receivedBlocks;	// network statistics
+					counters.increment(counters.blocksReceived);
 
-					// prepare next receive offset / length
-					receivedLen -= buffer_len;
-					receiveOffset -= buffer_len;
-					if (receivedLen > 0)
-					{
-						snprintf(acMsg, 255, "receivedLen - buffer_len = %d != 0", receivedLen);
-						SDRLOG(MSG_DEBUG, acMsg);
-						memcpy(&rcvBuf[receiveBufferIdx][2 * MAX_DECIMATIONS], &rcvBuf[prevBufferIdx][2 * MAX_DECIMATIONS + buffer_len], receivedLen);
-					}
+					// prepare next receive: toRead never exceeds the block
+					receivedLen = 0;
+					receiveOffset = 0;
 				}
 			}
 			else
@@ -1463,17 +2879,47 @@ void ThreadProc(void *p)
 						::MessageBoxA(0, acMsg, "Socket Error", 0);
 					goto label_reConnect;
 				}
-				else if (CSimpleSocket::SocketEwouldblock == err && SleepMillisWaitingForData >= 0)
-					::Sleep(SleepMillisWaitingForData);
+				else if (CSimpleSocket::SocketEwouldblock == err)
+					waitForSocket(conn, sockEvent);
 			}
 		}
 
 label_reConnect:
+		counters.byteRate.store(0, std::memory_order_relaxed);
+		if (!terminateThread)
+			counters.increment(counters.reconnects);
+		logRetuneLatency();
+		if (ncoRetunes)
+		{
+			char acMsg[256];
+			snprintf(acMsg, 255, "fine tuning: %u LO changes without retune", ncoRetunes);
+			SDRLOG(MSG_DEBUG, acMsg);
+		}
+		if (staleBlocksDropped || staleBlocksBlanked)
+		{
+			char acMsg[256];
+			snprintf(acMsg, 255, "retune settling: %u stale blocks dropped, %u blocks blanked", staleBlocksDropped, staleBlocksBlanked);
+			SDRLOG(MSG_DEBUG, acMsg);
+		}
+		if (rcvRing.highWater() || rcvRing.overflows())
+		{
+			char acMsg[256];
+			snprintf(acMsg, 255, "receive ring: high-water mark %d of %d kBytes, %u blocks dropped"
+				, rcvRing.highWater() / 1024, rcvRing.size() / 1024, rcvRing.overflows());
+			SDRLOG(MSG_DEBUG, acMsg);
+		}
 		conn.Close();
+		if (sockEvent != WSA_INVALID_EVENT)
+			WSACloseEvent(sockEvent);
 		if (!AutoReConnect)
 			break;
 	}
 
+	terminateProcessing = true;
+	SetEvent(rcvEvent);
+	WaitForSingleObject(process_handle, INFINITE);
+	CloseHandle(process_handle);
+
 	worker_handle = INVALID_HANDLE_VALUE;
 	_endthread();
 }
@@ -1544,7 +2990,7 @@ static void updateTunerGains(HWND hwndDlg)
 		if (new_gain != gains[gainIdx])
 		{
 			new_gain = gains[gainIdx];
-			somewhat_changed |= 4;
+			setChanged(4);
 		}
 		SendMessage(hGain, TBM_SETPOS, (WPARAM)TRUE, (LPARAM)-new_gain);
 	}
@@ -1570,6 +3016,8 @@ static void updateDecimations(HWND hwndDlg)
 {
 	TCHAR str[256];
 	HWND hDecimation = GetDlgItem(hwndDlg, IDC_DECIMATION);
+	// the real path of direct sampling halves the rate in front of the decimation
+	const int realFactor = (realInput() != DECIM_INPUT_IQ) ? 2 : 1;
 
 	maxDecimation = 1;
 	//int bwIdx = nearestBwIdx(new_TunerBW);
@@ -1578,6 +3026,7 @@ static void updateDecimations(HWND hwndDlg)
 	//::MessageBoxA(NULL, str, "info", 0);
 
 	ComboBox_ResetContent(hDecimation);
+	n_decimationItems = 0;
 	for (int i = 1; i <= MAX_DECIMATIONS; i++)
 	{
 		if (i == 1)
@@ -1586,29 +3035,77 @@ static void updateDecimations(HWND hwndDlg)
 			ComboBox_AddString(hDecimation, str);
 			maxDecimation = i;
 		}
-		else if ( (i & 1) == 0 && samplerates[new_srate_idx].valueInt >= i * 1000 * new_TunerBW * 24 / 35)
+		else if (isFilterDecimation(i) && samplerates[new_srate_idx].valueInt >= i * 1000 * new_TunerBW * 24 / 35)
 		{
-			double newSrateKHz = (double)samplerates[new_srate_idx].valueInt / ( i * 1000 );
+			double newSrateKHz = (double)samplerates[new_srate_idx].valueInt / ( i * realFactor * 1000 );
 			_stprintf_s(str, 255, TEXT("/ %d  -> %.1f kHz"), i, newSrateKHz);
 			ComboBox_AddString(hDecimation, str);
 			maxDecimation = i;
 		}
+		else
+			continue;
+		decimationItems[n_decimationItems].decimation = i;
+		decimationItems[n_decimationItems].outputRate = 0;
+		++n_decimationItems;
 	}
+#if ( MAX_DECIMATIONS > 1 )
+	// large decimations with the CIC: its compensation filter limits the passband, not the tuner
+	for (int i = CIC_MIN_DECIMATION; i <= CIC_MAX_DECIMATION && n_decimationItems < MAX_DECIMATION_ITEMS; i *= 2)
+	{
+		double newSrateKHz = (double)samplerates[new_srate_idx].valueInt / ( i * realFactor * 1000 );
+		_stprintf_s(str, 255, (realFactor == 1) ? TEXT("/ %d  -> %.1f kHz (CIC)") : TEXT("/ %d  -> %.1f kHz"), i, newSrateKHz);
+		ComboBox_AddString(hDecimation, str);
+		maxDecimation = i;
+		decimationItems[n_decimationItems].decimation = i;
+		decimationItems[n_decimationItems].outputRate = 0;
+		++n_decimationItems;
+	}
+#endif
 	if (new_Decimation < 1)
 		new_Decimation = 1;
 	if (new_Decimation > maxDecimation)
 		new_Decimation = maxDecimation;
 
+#if ( MAX_DECIMATIONS > 1 )
+	// resampled output rates: the digital filters take care of aliasing, independent of tuner bandwidth
+	for (int k = 0; k < n_resampleRates && n_decimationItems < MAX_DECIMATION_ITEMS; ++k)
+	{
+		int preDecimation, L, M;
+		if (!planResampling(samplerates[new_srate_idx].valueInt / realFactor, resampleRates[k], &preDecimation, &L, &M))
+			continue;
+		_stprintf_s(str, 255, TEXT("resample -> %.1f kHz"), resampleRates[k] / 1000.0);
+		ComboBox_AddString(hDecimation, str);
+		decimationItems[n_decimationItems].decimation = 1;
+		decimationItems[n_decimationItems].outputRate = resampleRates[k];
+		++n_decimationItems;
+	}
+#endif
+
 	//_stprintf_s(str, 255, TEXT("maxDec %d, newDec %d"), maxDecimation, new_Decimation);
 	//::MessageBoxA(NULL, str, "info", 0);
 
-	// idx , decimation
-	// 0, 1
-	// 1, 2
-	// 2, 4
-	// 3, 6
-	// 4, 8
-	int decimationIdx = new_Decimation >> 1;
+	int decimationIdx = -1;
+	for (int k = 0; k < n_decimationItems; ++k)
+	{
+		if (new_OutputRate > 0 && decimationItems[k].outputRate == new_OutputRate)
+			decimationIdx = k;
+		else if (new_OutputRate <= 0 && decimationItems[k].outputRate == 0 && decimationItems[k].decimation == new_Decimation)
+			decimationIdx = k;
+	}
+	if (decimationIdx < 0)
+	{
+		// resampling to new_OutputRate not possible from current samplerate
+		new_OutputRate = 0;
+		for (int k = 0; k < n_decimationItems; ++k)
+			if (decimationItems[k].outputRate == 0 && decimationItems[k].decimation == new_Decimation)
+				decimationIdx = k;
+	}
+	if (decimationIdx < 0)
+	{
+		// decimation not offered: fall back to no decimation
+		decimationIdx = 0;
+		new_Decimation = 1;
+	}
 	ComboBox_SetCurSel(hDecimation, decimationIdx);
 
 	if (MAX_DECIMATIONS == 1)
@@ -1709,14 +3206,14 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
                         TCHAR ppm[255];
 						Edit_GetText((HWND) lParam, ppm, 255 );
 						new_FreqCorrPPM = _ttoi(ppm);
-						somewhat_changed |= 128;
+						setChanged(128);
 						WinradCallBack(-1,WINRAD_LOCHANGE,0,NULL);
                     }
                     return TRUE;
                 case IDC_RTLAGC:
 				{
 					new_RTLAGC = (Button_GetCheck(GET_WM_COMMAND_HWND(wParam, lParam)) == BST_CHECKED) ? 1 : 0;
-					somewhat_changed |= 16;
+					setChanged(16);
 					return TRUE;
 				}
                 case IDC_OFFSET:
@@ -1724,7 +3221,7 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
 					HWND hDlgItmOffset = GetDlgItem(hwndDlg, IDC_OFFSET);
 
 					new_OffsetTuning = (Button_GetCheck(GET_WM_COMMAND_HWND(wParam, lParam)) == BST_CHECKED) ? 1 : 0;
-					somewhat_changed |= 64;
+					setChanged(64);
 
 					// E4000 = 1, FC0012 = 2, FC0013 = 3, FC2580 = 4, R820T = 5, R828D = 6
 					if (1 == rtl_tcp_dongle_info.ui[1])
@@ -1741,7 +3238,7 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
 					if(Button_GetCheck(GET_WM_COMMAND_HWND(wParam, lParam)) == BST_CHECKED) //it is checked
 					{
 						new_TunerAGC = 1;	// automatic
-						somewhat_changed |= 8;
+						setChanged(8);
 
 						EnableWindow(hGain,FALSE);
 						Static_SetText(hGainLabel, TEXT("AGC"));
@@ -1750,7 +3247,7 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
 					{
 						//rtlsdr_set_tuner_gain_mode(dev,1);
 						new_TunerAGC = 0;	// manual
-						somewhat_changed |= 8;
+						setChanged(8);
 
 						EnableWindow(hGain,TRUE);
 
@@ -1780,7 +3277,7 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
 					if(GET_WM_COMMAND_CMD(wParam, lParam) == CBN_SELCHANGE)
                     { 
 						new_srate_idx = ComboBox_GetCurSel(GET_WM_COMMAND_HWND(wParam, lParam));
-						somewhat_changed |= 2;
+						setChanged(2);
 						updateDecimations(hwndDlg);
 						WinradCallBack(-1,WINRAD_SRCHANGE,0,NULL);// Signal application
                     }
@@ -1814,11 +3311,16 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
                     {
 						bufferSizeIdx = ComboBox_GetCurSel(GET_WM_COMMAND_HWND(wParam, lParam));
 						buffer_len = buffer_sizes[bufferSizeIdx] * 1024;
-						WinradCallBack(-1,WINRAD_SRCHANGE,0,NULL);// Signal application
-						if (SDRsupportsLogging)
-							SDRLOG(MSG_ERRDLG, "Restart SDR application,\nthat changed buffer size has effect!");
-						else
-							::MessageBoxA(NULL, "Restart SDR application,\nthat changed buffer size has effect!", "Info", 0);
+						// network blocks follow at once. the host only learns a new callback size from
+						// StartHW(), so a running stream gets restarted - unless setting 35 fixes the
+						// callback size: the re-chunker delivers exactly that count with any block size
+						if (ThreadStreamToSDR && CallbackSize == 0)
+						{
+							WinradCallBack(-1, WINRAD_STOP, 0, NULL);
+							WinradCallBack(-1, WINRAD_START, 0, NULL);
+						}
+						else if (!ThreadStreamToSDR)
+							WinradCallBack(-1,WINRAD_SRCHANGE,0,NULL);// Signal application
                     }
                     return TRUE;
 
@@ -1827,7 +3329,7 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
 					{
 						int bwIdx = ComboBox_GetCurSel(GET_WM_COMMAND_HWND(wParam, lParam));
 						new_TunerBW = bandwidths[bwIdx];
-						somewhat_changed |= 256;
+						setChanged(256);
 						updateDecimations(hwndDlg);
 					}
 					return TRUE;
@@ -1835,29 +3337,18 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
 				case IDC_DECIMATION:
 					if (GET_WM_COMMAND_CMD(wParam, lParam) == CBN_SELCHANGE)
 					{
-						// idx , decimation
-						// 0, 1
-						// 1, 2
-						// 2, 4
-						// 3, 6
-						// 4, 8
 						int idx = ComboBox_GetCurSel(GET_WM_COMMAND_HWND(wParam, lParam));
-						new_Decimation = (idx == 0) ? 1 : (2 * idx);
-						somewhat_changed |= 512;
+						if (idx < 0 || idx >= n_decimationItems)
+							return TRUE;
+						new_Decimation = decimationItems[idx].decimation;
+						new_OutputRate = decimationItems[idx].outputRate;
+						setChanged(512);
 
 #if ( ALWAYS_PCMU8 == 0 && ALWAYS_PCM16 == 0 )
-						if (SDRsupportsSamplePCMU8 && SDRsupportsSampleFormats)
+						if (SDRsupportsSampleFormats)
 						{
-							if (new_Decimation == 1)
-							{
-								extHWtype = exthwUSBdataU8;		// 8bit samples are sufficient when not using decimation
-								WinradCallBack(-1, HDSDR_SAMPLE_FMT_PCMU8, 0, NULL);
-							}
-							else
-							{
-								extHWtype = exthwUSBdata16;		// with decimation 16-bit samples are necessary
-								WinradCallBack(-1, HDSDR_SAMPLE_FMT_PCM16, 0, NULL);
-							}
+							extHWtype = sampleTypeForDecimation();
+							WinradCallBack(-1, sampleFormatMsg(extHWtype), 0, NULL);
 						}
 #endif
 
@@ -1870,7 +3361,22 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
 					if(GET_WM_COMMAND_CMD(wParam, lParam) == CBN_SELCHANGE)
                     { 
 						new_DirectSampling = ComboBox_GetCurSel(GET_WM_COMMAND_HWND(wParam, lParam));
-						somewhat_changed |= 32;
+						setChanged(32);
+
+						if (DirectSamplingReal)
+						{
+							// real path: the output samplerate changes with the mode
+							updateDecimations(hwndDlg);
+#if ( ALWAYS_PCMU8 == 0 && ALWAYS_PCM16 == 0 )
+							if (SDRsupportsSampleFormats)
+							{
+								extHWtype = sampleTypeForDecimation();
+								WinradCallBack(-1, sampleFormatMsg(extHWtype), 0, NULL);
+							}
+#endif
+							WinradCallBack(-1, WINRAD_SRATES_CHANGED, 0, NULL);
+							WinradCallBack(-1, WINRAD_SRCHANGE, 0, NULL);
+						}
 
 						WinradCallBack(-1,WINRAD_LOCHANGE,0,NULL);// Signal application
                     }
@@ -1918,7 +3424,7 @@ static INT_PTR CALLBACK MainDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wParam, LPAR
 					if (pos != last_gain)
 					{
 						new_gain = pos;
-						somewhat_changed |= 4;
+						setChanged(4);
 						WinradCallBack(-1, WINRAD_ATTCHANGE, 0, NULL);
 					}
 
@@ -0,0 +1,207 @@
+/*
+ * aligned sample buffer pool for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "blockpool.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+// output pairs of a region beyond the block's share of the decimation
+#define BLOCKPOOL_MARGIN_PAIRS	512
+
+#ifdef _WIN32
+
+// SeLockMemoryPrivilege has to be granted to the user - enabling it in the token is up to us
+static bool enableLockMemoryPrivilege()
+{
+	HANDLE token;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+		return false;
+	TOKEN_PRIVILEGES tp;
+	tp.PrivilegeCount = 1;
+	tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	bool ok = LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid) != FALSE;
+	if (ok)
+		ok = AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL) && GetLastError() == ERROR_SUCCESS;
+	CloseHandle(token);
+	return ok;
+}
+
+// page allocation of at least total bytes: *capacity gets the size, *large whether in large pages
+static char * pageAlloc(size_t total, bool largePages, size_t * capacity, bool * large)
+{
+	if (largePages)
+	{
+		const size_t page = GetLargePageMinimum();
+		if (page && enableLockMemoryPrivilege())
+		{
+			const size_t size = (total + page - 1) & ~(page - 1);
+			char * base = (char *)VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (base)
+			{
+				*capacity = size;
+				*large = true;
+				return base;
+			}
+		}
+	}
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	const size_t page = si.dwPageSize;
+	const size_t size = (total + page - 1) & ~(page - 1);
+	char * base = (char *)VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	*capacity = size;
+	*large = false;
+	return base;
+}
+
+static void pageFree(char * base, size_t)
+{
+	VirtualFree(base, 0, MEM_RELEASE);
+}
+
+#else
+
+#define BLOCKPOOL_HUGE_PAGE		(2 * 1024 * 1024)
+
+// as on Windows: reserved huge pages first, then transparent huge pages on a huge page multiple
+static char * pageAlloc(size_t total, bool largePages, size_t * capacity, bool * large)
+{
+	if (largePages)
+	{
+		const size_t size = (total + BLOCKPOOL_HUGE_PAGE - 1) & ~(size_t)(BLOCKPOOL_HUGE_PAGE - 1);
+		void * base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+#ifdef MADV_HUGEPAGE
+		if (base == MAP_FAILED)
+		{
+			base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (base != MAP_FAILED && madvise(base, size, MADV_HUGEPAGE))
+			{
+				munmap(base, size);
+				base = MAP_FAILED;
+			}
+		}
+#endif
+		if (base != MAP_FAILED)
+		{
+			*capacity = size;
+			*large = true;
+			return (char *)base;
+		}
+	}
+	const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	const size_t size = (total + page - 1) & ~(page - 1);
+	void * base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	*capacity = size;
+	*large = false;
+	return (base != MAP_FAILED) ? (char *)base : 0;
+}
+
+static void pageFree(char * base, size_t capacity)
+{
+	munmap(base, capacity);
+}
+
+#endif
+
+
+BlockPool::BlockPool()
+	: m_base(0)
+	, m_capacity(0)
+	, m_used(0)
+	, m_largePages(false)
+	, m_nRegions(0)
+{
+}
+
+BlockPool::~BlockPool()
+{
+	free();
+}
+
+bool BlockPool::allocate(const size_t * sizes, int nRegions, bool largePages)
+{
+	if (nRegions < 1 || nRegions > BLOCKPOOL_MAX_REGIONS)
+		return false;
+
+	size_t offset[BLOCKPOOL_MAX_REGIONS];
+	size_t total = 0;
+	for (int k = 0; k < nRegions; ++k)
+	{
+		offset[k] = total;
+		total += (sizes[k] + BLOCKPOOL_ALIGN - 1) & ~(size_t)(BLOCKPOOL_ALIGN - 1);
+	}
+
+	const bool keep = m_base && total <= m_capacity && 2 * total > m_capacity && largePages == m_largePages;
+	if (!keep)
+	{
+		size_t capacity = 0;
+		bool large = false;
+		char * base = pageAlloc(total, largePages, &capacity, &large);
+		if (!base)
+			return false;
+		if (m_base)
+		{
+			// region 0 moves along: both start at offset 0
+			const size_t oldSize = (m_nRegions > 1) ? m_offset[1] : m_used;
+			memcpy(base, m_base, (oldSize < sizes[0]) ? oldSize : sizes[0]);
+		}
+		free();
+		m_base = base;
+		m_capacity = capacity;
+		m_largePages = large;
+	}
+
+	for (int k = 0; k < nRegions; ++k)
+		m_offset[k] = offset[k];
+	m_nRegions = nRegions;
+	m_used = total;
+	return true;
+}
+
+void BlockPool::free()
+{
+	if (m_base)
+		pageFree(m_base, m_capacity);
+	m_base = 0;
+	m_capacity = 0;
+	m_used = 0;
+	m_largePages = false;
+	m_nRegions = 0;
+}
+
+
+void blockpool_sample_sizes(int outPairs, int uses, int stageBytes, size_t * sizes)
+{
+	// the decimators output up to one pair per stage more than the block's share, the resampler two
+	const size_t values = 2 * ((size_t)outPairs + BLOCKPOOL_MARGIN_PAIRS);
+	sizes[BLOCKPOOL_STAGE] = (size_t)stageBytes;
+	sizes[BLOCKPOOL_SHORT] = (uses & BLOCKPOOL_USE_SHORT) ? values * sizeof(short) : 0;
+	sizes[BLOCKPOOL_FLOAT] = (uses & BLOCKPOOL_USE_FLOAT) ? values * sizeof(float) : 0;
+	sizes[BLOCKPOOL_INT] = (uses & BLOCKPOOL_USE_INT) ? values * sizeof(int32_t) : 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * aligned sample buffer pool for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// alignment of each region: cache line, also covers AVX vectors
+#define BLOCKPOOL_ALIGN			64
+#define BLOCKPOOL_MAX_REGIONS	8
+
+
+/*
+ * one allocation split into aligned regions - the sample buffers sized for
+ * the configured block length. page allocated, optionally in large pages:
+ * on Windows they need the "Lock pages in memory" privilege, elsewhere
+ * reserved huge pages (MAP_HUGETLB) or transparent ones (MADV_HUGEPAGE) -
+ * else it falls back. allocate() again resizes: memory is kept while the
+ * new size fits and does not waste more than half of it. region 0 keeps
+ * its content up to the smaller size, other regions are invalid after resizing.
+ */
+class BlockPool
+{
+public:
+	BlockPool();
+	~BlockPool();
+
+	bool allocate(const size_t * sizes, int nRegions, bool largePages);
+	void free();
+
+	void * region(int k) const { return (k >= 0 && k < m_nRegions) ? m_base + m_offset[k] : 0; }
+
+	// bytes requested by the regions / reserved, with alignment and page rounding
+	size_t used() const { return m_used; }
+	size_t footprint() const { return m_capacity; }
+	bool largePages() const { return m_largePages; }
+
+private:
+	BlockPool(const BlockPool &);
+	BlockPool & operator=(const BlockPool &);
+
+	char * m_base;
+	size_t m_capacity;
+	size_t m_used;
+	bool m_largePages;
+	int m_nRegions;
+	size_t m_offset[BLOCKPOOL_MAX_REGIONS];
+};
+
+
+// sample buffers of the processing thread. staging (a partial callback) comes first:
+// it survives resizing for another network block length
+enum { BLOCKPOOL_STAGE = 0, BLOCKPOOL_SHORT, BLOCKPOOL_FLOAT, BLOCKPOOL_INT, BLOCKPOOL_SAMPLE_REGIONS };
+
+// regions a processing chain writes
+#define BLOCKPOOL_USE_SHORT		1
+#define BLOCKPOOL_USE_FLOAT		2
+#define BLOCKPOOL_USE_INT		4
+
+// region sizes for outPairs I/Q pairs out of one network block in the regions of uses - the
+// others stay empty - and a staged callback of stageBytes
+void blockpool_sample_sizes(int outPairs, int uses, int stageBytes, size_t * sizes);
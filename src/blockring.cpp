@@ -0,0 +1,213 @@
+/*
+ * block ring buffer for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "blockring.h"
+
+#include <Windows.h>
+
+
+// another thread may grab the reserved address range between release and mapping
+#define MIRROR_MAP_RETRIES	16
+
+
+BlockRing::BlockRing()
+	: m_mapping(0)
+	, m_mem(0)
+	, m_size(0)
+	, m_head(0)
+	, m_tail(0)
+	, m_headBlock(0)
+	, m_tailBlock(0)
+	, m_highWater(0)
+	, m_overflows(0)
+{
+}
+
+BlockRing::~BlockRing()
+{
+	free();
+}
+
+// maps size bytes - rounded up - twice, back to back: the start of both views or 0
+static uint8_t * map_mirrored(int size, HANDLE * mappingOut, int * sizeOut)
+{
+	if (size < 1)
+		return 0;
+
+	// power of 2: offsets stay continuous when the counters wrap. at least one allocation unit
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	int alignedSize = (int)si.dwAllocationGranularity;
+	while (alignedSize < size)
+		alignedSize *= 2;
+
+	HANDLE mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)alignedSize, NULL);
+	if (mapping == NULL)
+		return 0;
+
+	uint8_t * mem = 0;
+	for (int k = 0; k < MIRROR_MAP_RETRIES && mem == 0; ++k)
+	{
+		// find free address space for both views, then map into it
+		uint8_t * base = (uint8_t *)VirtualAlloc(NULL, 2 * (SIZE_T)alignedSize, MEM_RESERVE, PAGE_NOACCESS);
+		if (base == 0)
+			break;
+		VirtualFree(base, 0, MEM_RELEASE);
+
+		void * lower = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, alignedSize, base);
+		void * upper = lower ? MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, alignedSize, base + alignedSize) : 0;
+		if (lower && upper)
+			mem = base;
+		else
+		{
+			if (upper)
+				UnmapViewOfFile(upper);
+			if (lower)
+				UnmapViewOfFile(lower);
+		}
+	}
+	if (mem == 0)
+	{
+		CloseHandle(mapping);
+		return 0;
+	}
+	*mappingOut = mapping;
+	*sizeOut = alignedSize;
+	return mem;
+}
+
+static void unmap_mirrored(uint8_t * mem, int size, HANDLE mapping)
+{
+	if (mem)
+	{
+		UnmapViewOfFile(mem + size);
+		UnmapViewOfFile(mem);
+	}
+	if (mapping)
+		CloseHandle(mapping);
+}
+
+bool BlockRing::allocate(int size)
+{
+	free();
+	HANDLE mapping = NULL;
+	int alignedSize = 0;
+	m_mem = map_mirrored(size, &mapping, &alignedSize);
+	if (m_mem == 0)
+		return false;
+
+	m_mapping = mapping;
+	m_size.store(alignedSize);
+	m_head.store(0);
+	m_tail.store(0);
+	m_headBlock.store(0);
+	m_tailBlock.store(0);
+	resetStatistics();
+	return true;
+}
+
+void BlockRing::free()
+{
+	unmap_mirrored(m_mem, size(), (HANDLE)m_mapping);
+	m_mem = 0;
+	m_mapping = 0;
+	m_size.store(0);
+}
+
+bool BlockRing::resize(int size)
+{
+	// empty: the consumer released every block and sees no other before the next commit()
+	if (!empty())
+		return false;
+	HANDLE mapping = NULL;
+	int alignedSize = 0;
+	uint8_t * mem = map_mirrored(size, &mapping, &alignedSize);
+	if (mem == 0)
+		return false;
+
+	unmap_mirrored(m_mem, m_size.load(std::memory_order_relaxed), (HANDLE)m_mapping);
+	m_mem = mem;
+	m_mapping = mapping;
+	m_size.store(alignedSize, std::memory_order_relaxed);
+	return true;
+}
+
+uint8_t * BlockRing::writeBlock(int len)
+{
+	const unsigned head = m_head.load(std::memory_order_relaxed);
+	const unsigned used = head - m_tail.load(std::memory_order_acquire);
+	const unsigned blocks = m_headBlock.load(std::memory_order_relaxed) - m_tailBlock.load(std::memory_order_acquire);
+	const int ringSize = size();
+	if (len > ringSize || used + (unsigned)len > (unsigned)ringSize || blocks >= BLOCKRING_MAX_BLOCKS)
+	{
+		m_overflows.fetch_add(1, std::memory_order_relaxed);
+		return 0;
+	}
+	return m_mem + (head & (ringSize - 1));
+}
+
+void BlockRing::commit(int len, int tag, uint64_t pos)
+{
+	const unsigned headBlock = m_headBlock.load(std::memory_order_relaxed);
+	m_len[headBlock % BLOCKRING_MAX_BLOCKS] = len;
+	m_tag[headBlock % BLOCKRING_MAX_BLOCKS] = tag;
+	m_pos[headBlock % BLOCKRING_MAX_BLOCKS] = pos;
+	m_head.store(m_head.load(std::memory_order_relaxed) + len, std::memory_order_relaxed);
+	m_headBlock.store(headBlock + 1, std::memory_order_release);
+
+	const int queued = fill();
+	if (queued > m_highWater.load(std::memory_order_relaxed))
+		m_highWater.store(queued, std::memory_order_relaxed);
+}
+
+const uint8_t * BlockRing::readBlock(int * len, int * tag, uint64_t * pos) const
+{
+	const unsigned tailBlock = m_tailBlock.load(std::memory_order_relaxed);
+	if (m_headBlock.load(std::memory_order_acquire) == tailBlock)
+		return 0;
+	if (len)
+		*len = m_len[tailBlock % BLOCKRING_MAX_BLOCKS];
+	if (tag)
+		*tag = m_tag[tailBlock % BLOCKRING_MAX_BLOCKS];
+	if (pos)
+		*pos = m_pos[tailBlock % BLOCKRING_MAX_BLOCKS];
+	return m_mem + (m_tail.load(std::memory_order_relaxed) & (size() - 1));
+}
+
+void BlockRing::release()
+{
+	const unsigned tailBlock = m_tailBlock.load(std::memory_order_relaxed);
+	const int len = m_len[tailBlock % BLOCKRING_MAX_BLOCKS];
+	m_tail.store(m_tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+	m_tailBlock.store(tailBlock + 1, std::memory_order_release);
+}
+
+int BlockRing::fill() const
+{
+	return (int)(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+}
+
+bool BlockRing::empty() const
+{
+	return m_headBlock.load(std::memory_order_acquire) == m_tailBlock.load(std::memory_order_acquire);
+}
+
+void BlockRing::resetStatistics()
+{
+	m_highWater.store(0, std::memory_order_relaxed);
+	m_overflows.store(0, std::memory_order_relaxed);
+}
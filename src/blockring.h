@@ -0,0 +1,90 @@
+/*
+ * block ring buffer for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+
+// maximum number of queued blocks
+#define BLOCKRING_MAX_BLOCKS	256
+
+
+/*
+ * lock-free single producer / single consumer ring of variable size blocks.
+ * the memory is mapped twice, back to back: a block starting near the end
+ * continues contiguously in the second mapping, so the socket receives
+ * straight into the ring and the consumer reads blocks without copying
+ * at the wrap-around.
+ * the producer (network receive) fills writeBlock() and commit()s it,
+ * the consumer (processing/callback) gets readBlock() and release()s it.
+ * the producer may also resize() the ring while it is empty: the consumer
+ * holds no block then, and reads the memory only after the next commit().
+ */
+class BlockRing
+{
+public:
+	BlockRing();
+	~BlockRing();
+
+	// size is rounded up to the allocation granularity
+	bool allocate(int size);
+	void free();
+	int size() const { return m_size.load(std::memory_order_relaxed); }
+
+	// producer side
+	// new memory of size for an empty ring, counters and statistics are kept. false while
+	// blocks are queued or without memory: the ring stays as it is
+	bool resize(int size);
+	// space for a block of len bytes - or 0 when the ring is full: counted as overflow
+	uint8_t * writeBlock(int len);
+	// queue the block from writeBlock(). tag and stream position are passed through to the consumer
+	void commit(int len, int tag = 0, uint64_t pos = 0);
+
+	// consumer side: oldest queued block or 0 when empty
+	const uint8_t * readBlock(int * len, int * tag = 0, uint64_t * pos = 0) const;
+	void release();
+
+	// queued bytes
+	int fill() const;
+	// no block queued - exact on the producer side
+	bool empty() const;
+
+	// statistics
+	int highWater() const { return m_highWater.load(std::memory_order_relaxed); }
+	unsigned overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+	void resetStatistics();
+
+private:
+	BlockRing(const BlockRing &);
+	BlockRing & operator=(const BlockRing &);
+
+	void * m_mapping;
+	uint8_t * m_mem;					// m_size bytes, mapped twice
+	std::atomic<int> m_size;
+	int m_len[BLOCKRING_MAX_BLOCKS];	// block lengths
+	int m_tag[BLOCKRING_MAX_BLOCKS];	// block tags
+	uint64_t m_pos[BLOCKRING_MAX_BLOCKS];	// block stream positions
+	std::atomic<unsigned> m_head;		// bytes committed - free running
+	std::atomic<unsigned> m_tail;		// bytes released - free running
+	std::atomic<unsigned> m_headBlock;	// blocks committed - free running
+	std::atomic<unsigned> m_tailBlock;	// blocks released - free running
+	std::atomic<int> m_highWater;		// maximum fill() seen at commit()
+	std::atomic<unsigned> m_overflows;	// blocks refused by writeBlock()
+};
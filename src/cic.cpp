@@ -0,0 +1,195 @@
+/*
+ * CIC decimator for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cic.h"
+#include "convert.h"
+#include "nco.h"
+#include "iqcorr.h"
+
+#include <math.h>
+#include <string.h>
+
+
+#define KAISER_BETA		6.0
+
+// compensation FIR: cutoff and end of droop compensation, relative to the CIC output rate
+#define COMP_CUTOFF		0.25
+#define COMP_INTEGRATION_STEPS	2000
+
+// pairs mixed per chunk on the stack
+#define CIC_MIX_CHUNK	1024
+
+
+static double bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	const double q = x * x / 4.0;
+	for (int k = 1; k < 40; ++k)
+	{
+		term *= q / ((double)k * (double)k);
+		sum += term;
+		if (term < sum * 1E-12)
+			break;
+	}
+	return sum;
+}
+
+// magnitude response of the CIC, normalized to DC gain 1. f relative to CIC output rate
+static double cic_response(double f, int R)
+{
+	const double PI = 3.14159265358979323846;
+	if (f <= 0.0)
+		return 1.0;
+	const double a = sin(PI * f) / (R * sin(PI * f / R));
+	return pow(fabs(a), CIC_STAGES);
+}
+
+
+CicDecimator::CicDecimator()
+	: m_factor(0)
+	, m_R(1)
+{
+	reset();
+}
+
+bool CicDecimator::configure(int decimation)
+{
+	if (decimation < CIC_MIN_DECIMATION || decimation > CIC_MAX_DECIMATION || (decimation & 1))
+		return false;
+
+	m_factor = decimation;
+	m_R = decimation / 2;
+
+	// frequency sampling design: inverse CIC response up to the cutoff, kaiser windowed
+	const double PI = 3.14159265358979323846;
+	const double mid = 0.5 * (CIC_COMP_TAPS - 1);
+	const double df = COMP_CUTOFF / COMP_INTEGRATION_STEPS;
+	double sum = 0.0;
+	for (int n = 0; n < CIC_COMP_TAPS; ++n)
+	{
+		const double t = n - mid;
+		double h = 0.0;
+		for (int k = 0; k < COMP_INTEGRATION_STEPS; ++k)
+		{
+			const double f = (k + 0.5) * df;
+			h += cos(2.0 * PI * f * t) / cic_response(f, m_R);
+		}
+		h *= 2.0 * df;
+		const double r = 2.0 * n / (CIC_COMP_TAPS - 1) - 1.0;
+		m_coef[n] = h * bessel_i0(KAISER_BETA * sqrt(1.0 - r * r)) / bessel_i0(KAISER_BETA);
+		sum += m_coef[n];
+	}
+	for (int n = 0; n < CIC_COMP_TAPS; ++n)
+		m_coef[n] /= sum;
+
+	// CIC gain is R^stages; input full scale 128 = 2^7 -> 2^31
+	m_scale = 16777216.0 / pow((double)m_R, CIC_STAGES);
+	reset();
+	return true;
+}
+
+void CicDecimator::reset()
+{
+	m_phase = 0;
+	m_firPhase = 0;
+	m_histPos = 0;
+	memset(m_integ, 0, sizeof(m_integ));
+	memset(m_comb, 0, sizeof(m_comb));
+	memset(m_hist, 0, sizeof(m_hist));
+}
+
+int CicDecimator::process(const uint8_t * iq, int nPairs, int32_t * out, Nco * nco, IqCorrector * corr)
+{
+	if ((!nco || !nco->active()) && (!corr || corr->mode() == IQCORR_OFF))
+		return run(iq, nPairs, 128, m_scale, out);
+
+	// corrected/shifted input, rounded to 16 bit
+	float mixed[2 * CIC_MIX_CHUNK];
+	int16_t rounded[2 * CIC_MIX_CHUNK];
+	int nOut = 0;
+	while (nPairs > 0)
+	{
+		const int n = (nPairs < CIC_MIX_CHUNK) ? nPairs : CIC_MIX_CHUNK;
+		iq_input(iq, mixed, n, (float)CIC_MIX_GAIN, corr, nco);
+		conv_f32_to_s16(mixed, rounded, 2 * n);
+		nOut += run(rounded, n, 0, m_scale / CIC_MIX_GAIN, out + 2 * nOut);
+		iq += 2 * n;
+		nPairs -= n;
+	}
+	return nOut;
+}
+
+template <class T>
+int CicDecimator::run(const T * iq, int nPairs, int bias, double scale, int32_t * out)
+{
+	int nOut = 0;
+	uint32_t i0 = m_integ[0][0], i1 = m_integ[0][1], i2 = m_integ[0][2];
+	uint32_t q0 = m_integ[1][0], q1 = m_integ[1][1], q2 = m_integ[1][2];
+
+	for (int k = 0; k < nPairs; ++k)
+	{
+		i0 += (uint32_t)((int)iq[2 * k] - bias);
+		i1 += i0;
+		i2 += i1;
+		q0 += (uint32_t)((int)iq[2 * k + 1] - bias);
+		q1 += q0;
+		q2 += q1;
+
+		if (++m_phase < m_R)
+			continue;
+		m_phase = 0;
+
+		// combs at the decimated rate
+		const uint32_t in[2] = { i2, q2 };
+		for (int c = 0; c < 2; ++c)
+		{
+			uint32_t v = in[c];
+			for (int s = 0; s < CIC_STAGES; ++s)
+			{
+				const uint32_t d = v - m_comb[c][s];
+				m_comb[c][s] = v;
+				v = d;
+			}
+			m_hist[c][m_histPos] = m_hist[c][m_histPos + CIC_COMP_TAPS] = (double)(int32_t)v;
+		}
+		if (++m_histPos >= CIC_COMP_TAPS)
+			m_histPos = 0;
+
+		// compensation FIR, decimating by 2
+		m_firPhase ^= 1;
+		if (m_firPhase)
+			continue;
+		for (int c = 0; c < 2; ++c)
+		{
+			const double * h = &m_hist[c][m_histPos];		// oldest sample first
+			double acc = 0.0;
+			for (int n = 0; n < CIC_COMP_TAPS; ++n)
+				acc += m_coef[n] * h[n];
+			acc *= scale;
+			if (acc >= 2147483647.0)
+				acc = 2147483647.0;
+			else if (acc <= -2147483648.0)
+				acc = -2147483648.0;
+			*out++ = (int32_t)floor(acc + 0.5);
+		}
+		++nOut;
+	}
+
+	m_integ[0][0] = i0;	m_integ[0][1] = i1;	m_integ[0][2] = i2;
+	m_integ[1][0] = q0;	m_integ[1][1] = q1;	m_integ[1][2] = q2;
+	return nOut;
+}
@@ -0,0 +1,71 @@
+/*
+ * CIC decimator for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class Nco;
+class IqCorrector;
+
+#define CIC_MIN_DECIMATION		16
+#define CIC_MAX_DECIMATION		256
+
+#define CIC_STAGES				3
+// taps of the compensation FIR, which also decimates by 2
+#define CIC_COMP_TAPS			47
+// corrected or shifted input is rounded to integers with this gain over the raw samples
+#define CIC_MIX_GAIN			4
+
+
+/*
+ * multiplierless CIC decimator by decimation / 2,
+ * followed by a short FIR compensating the CIC droop and decimating by 2.
+ * integrators and combs use wrapping 32 bit arithmetic: with 8 bit input
+ * and decimation up to 256 the bit growth fits - also with CIC_MIX_GAIN
+ * for corrected or shifted input, which is at most 128 * sqrt(2) * CIC_MIX_GAIN.
+ * state is independent of the decimation factor.
+ */
+class CicDecimator
+{
+public:
+	CicDecimator();
+
+	bool configure(int decimation);
+	int factor() const { return m_factor; }
+	void reset();
+
+	// raw unsigned 8 bit I/Q in; interleaved I/Q out with full 32 bit scale:
+	// input full scale (+/- 128) maps to +/- 2^31. returns number of complex outputs.
+	// an active corrector and nco correct and shift the input before filtering
+	int process(const uint8_t * iq, int nPairs, int32_t * out, Nco * nco = 0, IqCorrector * corr = 0);
+
+private:
+	template <class T>
+	int run(const T * iq, int nPairs, int bias, double scale, int32_t * out);
+
+	int m_factor;
+	int m_R;				// CIC decimation = m_factor / 2
+	int m_phase;			// input counter 0 .. m_R - 1
+	int m_firPhase;			// 0 / 1 for the FIR decimation by 2
+	uint32_t m_integ[2][CIC_STAGES];
+	uint32_t m_comb[2][CIC_STAGES];
+	double m_coef[CIC_COMP_TAPS];
+	double m_hist[2][2 * CIC_COMP_TAPS];	// delay lines, stored twice to avoid wrap handling
+	int m_histPos;
+	double m_scale;
+};
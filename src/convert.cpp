@@ -0,0 +1,1089 @@
+/*
+ * sample conversion kernels for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "convert.h"
+
+#include <math.h>
+#include <string.h>
+
+#if CONV_HAVE_X86
+	#include <emmintrin.h>
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+
+conv_u8_to_s16_fn conv_u8_to_s16 = conv_u8_to_s16_scalar;
+const char * conv_u8_to_s16_name = "scalar";
+conv_u8_to_f32_fn conv_u8_to_f32 = conv_u8_to_f32_scalar;
+conv_f32_to_s16_fn conv_f32_to_s16 = conv_f32_to_s16_scalar;
+conv_s32_to_s16_fn conv_s32_to_s16 = conv_s32_to_s16_scalar;
+conv_f32_to_s8_fn conv_f32_to_s8 = conv_f32_to_s8_scalar;
+conv_f32_to_s32_fn conv_f32_to_s32 = conv_f32_to_s32_scalar;
+conv_s32_to_s8_fn conv_s32_to_s8 = conv_s32_to_s8_scalar;
+conv_s32_to_f32_fn conv_s32_to_f32 = conv_s32_to_f32_scalar;
+conv_u8_mix_f32_fn conv_u8_mix_f32 = conv_u8_mix_f32_scalar;
+conv_u8_rot4_f32_fn conv_u8_rot4_f32 = conv_u8_rot4_f32_scalar;
+conv_f32_mix_f32_fn conv_f32_mix_f32 = conv_f32_mix_f32_scalar;
+conv_f32_rot4_f32_fn conv_f32_rot4_f32 = conv_f32_rot4_f32_scalar;
+conv_u8_iqcorr_f32_fn conv_u8_iqcorr_f32 = conv_u8_iqcorr_f32_scalar;
+conv_u8_iqstats_fn conv_u8_iqstats = conv_u8_iqstats_scalar;
+conv_u8_real_f32_fn conv_u8_real_f32 = conv_u8_real_f32_scalar;
+
+
+const conv_kernel_u8_s16 conv_kernels_u8_s16[] =
+{
+	  { "lut8", 0, conv_u8_to_s16_lut8 }
+	, { "lut16", 0, conv_u8_to_s16_lut16 }
+	, { "scalar", 0, conv_u8_to_s16_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_u8_to_s16_sse2 }
+	, { "avx2", CONV_CPU_AVX2, conv_u8_to_s16_avx2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_u8_f32 conv_kernels_u8_f32[] =
+{
+	  { "lut8", 0, conv_u8_to_f32_lut8 }
+	, { "lut16", 0, conv_u8_to_f32_lut16 }
+	, { "scalar", 0, conv_u8_to_f32_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_u8_to_f32_sse2 }
+	, { "avx2", CONV_CPU_AVX2, conv_u8_to_f32_avx2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_f32_s16 conv_kernels_f32_s16[] =
+{
+	  { "scalar", 0, conv_f32_to_s16_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_f32_to_s16_sse2 }
+	, { "avx2", CONV_CPU_AVX2, conv_f32_to_s16_avx2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_s32_s16 conv_kernels_s32_s16[] =
+{
+	  { "scalar", 0, conv_s32_to_s16_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_s32_to_s16_sse2 }
+	, { "avx2", CONV_CPU_AVX2, conv_s32_to_s16_avx2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_f32_s8 conv_kernels_f32_s8[] =
+{
+	  { "scalar", 0, conv_f32_to_s8_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_f32_to_s8_sse2 }
+	, { "avx2", CONV_CPU_AVX2, conv_f32_to_s8_avx2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_f32_s32 conv_kernels_f32_s32[] =
+{
+	  { "scalar", 0, conv_f32_to_s32_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_f32_to_s32_sse2 }
+	, { "avx2", CONV_CPU_AVX2, conv_f32_to_s32_avx2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_s32_s8 conv_kernels_s32_s8[] =
+{
+	  { "scalar", 0, conv_s32_to_s8_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_s32_to_s8_sse2 }
+	, { "avx2", CONV_CPU_AVX2, conv_s32_to_s8_avx2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_s32_f32 conv_kernels_s32_f32[] =
+{
+	  { "scalar", 0, conv_s32_to_f32_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_s32_to_f32_sse2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_u8_mix_f32 conv_kernels_u8_mix_f32[] =
+{
+	  { "scalar", 0, conv_u8_mix_f32_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_u8_mix_f32_sse2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_u8_rot4_f32 conv_kernels_u8_rot4_f32[] =
+{
+	  { "scalar", 0, conv_u8_rot4_f32_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_u8_rot4_f32_sse2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_f32_mix_f32 conv_kernels_f32_mix_f32[] =
+{
+	  { "scalar", 0, conv_f32_mix_f32_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_f32_mix_f32_sse2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_f32_rot4_f32 conv_kernels_f32_rot4_f32[] =
+{
+	  { "scalar", 0, conv_f32_rot4_f32_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_f32_rot4_f32_sse2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_u8_iqcorr_f32 conv_kernels_u8_iqcorr_f32[] =
+{
+	  { "lut8", 0, conv_u8_iqcorr_f32_lut8 }
+	, { "lut16", 0, conv_u8_iqcorr_f32_lut16 }
+	, { "scalar", 0, conv_u8_iqcorr_f32_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_u8_iqcorr_f32_sse2 }
+	, { "avx2", CONV_CPU_AVX2, conv_u8_iqcorr_f32_avx2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_u8_iqstats conv_kernels_u8_iqstats[] =
+{
+	  { "scalar", 0, conv_u8_iqstats_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_u8_iqstats_sse2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+const conv_kernel_u8_real_f32 conv_kernels_u8_real_f32[] =
+{
+	  { "scalar", 0, conv_u8_real_f32_scalar }
+#if CONV_HAVE_X86
+	, { "sse2", CONV_CPU_SSE2, conv_u8_real_f32_sse2 }
+#endif
+	, { 0, 0, 0 }
+};
+
+
+#if CONV_HAVE_X86
+
+static void cpuid(int leaf, int subleaf, unsigned regs[4])
+{
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex(r, leaf, subleaf);
+	for (int k = 0; k < 4; ++k)
+		regs[k] = (unsigned)r[k];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned lo, hi;
+	__asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static int detect_cpu_features()
+{
+	unsigned r[4];
+	int features = 0;
+
+	cpuid(0, 0, r);
+	const unsigned maxLeaf = r[0];
+	if (maxLeaf < 1)
+		return 0;
+
+	cpuid(1, 0, r);
+	if (r[3] & (1u << 26))
+		features |= CONV_CPU_SSE2;
+
+	// AVX2 needs OS support for saving the YMM registers: OSXSAVE + XCR0 bits 1 and 2
+	const bool osxsave = (r[2] & (1u << 27)) != 0;
+	const bool avx = (r[2] & (1u << 28)) != 0;
+	if (maxLeaf >= 7 && osxsave && avx && (xgetbv0() & 6) == 6)
+	{
+		cpuid(7, 0, r);
+		if (r[1] & (1u << 5))
+			features |= CONV_CPU_AVX2;
+	}
+	return features;
+}
+
+static void detect_cpu_name(char * name, int size)
+{
+	unsigned r[4];
+	cpuid(0x80000000, 0, r);
+	if (r[0] < 0x80000004)
+		return;
+	char brand[49];
+	for (unsigned leaf = 0; leaf < 3; ++leaf)
+	{
+		cpuid(0x80000002 + leaf, 0, r);
+		memcpy(brand + 16 * leaf, r, 16);
+	}
+	brand[48] = 0;
+	const char * p = brand;
+	while (*p == ' ')
+		++p;
+	if (*p)
+	{
+		strncpy(name, p, size - 1);
+		name[size - 1] = 0;
+	}
+}
+
+#else
+
+static int detect_cpu_features()
+{
+	return 0;
+}
+
+static void detect_cpu_name(char * name, int size)
+{
+}
+
+#endif
+
+
+int conv_cpu_features()
+{
+	static int features = -1;
+	if (features < 0)
+		features = detect_cpu_features();
+	return features;
+}
+
+const char * conv_cpu_name()
+{
+	static char name[64] = { 0 };
+	if (!name[0])
+	{
+		strcpy(name, "unknown");
+		detect_cpu_name(name, sizeof(name));
+	}
+	return name;
+}
+
+// tables are ordered from slowest to fastest: last supported one wins
+template <class FN>
+static const conv_kernel<FN> * select_kernel(const conv_kernel<FN> * table, int features)
+{
+	const conv_kernel<FN> * best = table;
+	for (int k = 0; table[k].fn; ++k)
+	{
+		if ((table[k].required_cpu & features) == table[k].required_cpu)
+			best = &table[k];
+	}
+	return best;
+}
+
+void conv_init()
+{
+	const int features = conv_cpu_features();
+
+	const conv_kernel_u8_s16 * k_u8_s16 = select_kernel(conv_kernels_u8_s16, features);
+	conv_u8_to_s16 = k_u8_s16->fn;
+	conv_u8_to_s16_name = k_u8_s16->name;
+
+	conv_u8_to_f32 = select_kernel(conv_kernels_u8_f32, features)->fn;
+	conv_f32_to_s16 = select_kernel(conv_kernels_f32_s16, features)->fn;
+	conv_s32_to_s16 = select_kernel(conv_kernels_s32_s16, features)->fn;
+	conv_f32_to_s8 = select_kernel(conv_kernels_f32_s8, features)->fn;
+	conv_f32_to_s32 = select_kernel(conv_kernels_f32_s32, features)->fn;
+	conv_s32_to_s8 = select_kernel(conv_kernels_s32_s8, features)->fn;
+	conv_s32_to_f32 = select_kernel(conv_kernels_s32_f32, features)->fn;
+	conv_u8_mix_f32 = select_kernel(conv_kernels_u8_mix_f32, features)->fn;
+	conv_u8_rot4_f32 = select_kernel(conv_kernels_u8_rot4_f32, features)->fn;
+	conv_f32_mix_f32 = select_kernel(conv_kernels_f32_mix_f32, features)->fn;
+	conv_f32_rot4_f32 = select_kernel(conv_kernels_f32_rot4_f32, features)->fn;
+	conv_u8_iqcorr_f32 = select_kernel(conv_kernels_u8_iqcorr_f32, features)->fn;
+	conv_u8_iqstats = select_kernel(conv_kernels_u8_iqstats, features)->fn;
+	conv_u8_real_f32 = select_kernel(conv_kernels_u8_real_f32, features)->fn;
+}
+
+
+void conv_u8_to_s16_scalar(const uint8_t * in, int16_t * out, int n)
+{
+	for (int i = 0; i < n; i++)
+		*out++ = ((int16_t)(*in++)) - 128;
+}
+
+void conv_u8_to_f32_scalar(const uint8_t * in, float * out, int n, float scale)
+{
+	for (int i = 0; i < n; i++)
+		*out++ = (float)(((int)(*in++)) - 128) * scale;
+}
+
+void conv_f32_to_s16_scalar(const float * in, int16_t * out, int n)
+{
+	// saturate first, then round half away from zero. the comparisons are those of
+	// maxps/minps in the SIMD kernels: NaN ends up at -32768 in both
+	for (int i = 0; i < n; i++)
+	{
+		float v = *in++;
+		v = (v > -32768.0F) ? v : -32768.0F;
+		v = (v < 32767.0F) ? v : 32767.0F;
+		*out++ = (int16_t)(int)(v + ((v >= 0.0F) ? 0.5F : -0.5F));
+	}
+}
+
+void conv_s32_to_s16_scalar(const int32_t * in, int16_t * out, int n)
+{
+	// round without overflow: keep 17 bits, add 1, drop last bit. result can't exceed 16 bit range
+	for (int i = 0; i < n; i++)
+	{
+		const int32_t r = ((*in++ >> 15) + 1) >> 1;
+		*out++ = (int16_t)((r > 32767) ? 32767 : r);
+	}
+}
+
+void conv_s32_to_f32_scalar(const int32_t * in, float * out, int n, float scale)
+{
+	for (int i = 0; i < n; i++)
+		*out++ = (float)(*in++) * scale;
+}
+
+// range of the output formats and the arithmetic of their rounding: float for 8 bit,
+// double for 32 bit, where the float +-0.5 would not be exact
+template <class T> struct conv_int_range;
+template <> struct conv_int_range<int8_t> { typedef float real; static real lo() { return -128.0F; } static real hi() { return 127.0F; } };
+template <> struct conv_int_range<int32_t> { typedef double real; static real lo() { return -2147483648.0; } static real hi() { return 2147483647.0; } };
+
+template <class T>
+static void conv_f32_to_int_scalar(const float * in, T * out, int n)
+{
+	// as conv_f32_to_s16_scalar: saturate first, then round half away from zero
+	typedef typename conv_int_range<T>::real real;
+	const real lo = conv_int_range<T>::lo();
+	const real hi = conv_int_range<T>::hi();
+	const real half = (real)0.5;
+	for (int i = 0; i < n; i++)
+	{
+		real v = *in++;
+		v = (v > lo) ? v : lo;
+		v = (v < hi) ? v : hi;
+		*out++ = (T)(int64_t)(v + ((v >= 0) ? half : -half));
+	}
+}
+
+void conv_f32_to_s8_scalar(const float * in, int8_t * out, int n)
+{
+	conv_f32_to_int_scalar(in, out, n);
+}
+
+void conv_f32_to_s32_scalar(const float * in, int32_t * out, int n)
+{
+	conv_f32_to_int_scalar(in, out, n);
+}
+
+void conv_s32_to_s8_scalar(const int32_t * in, int8_t * out, int n)
+{
+	// keep 9 bits, add 1, drop the last: as conv_s32_to_s16_scalar
+	for (int i = 0; i < n; i++)
+	{
+		const int32_t r = ((*in++ >> 23) + 1) >> 1;
+		*out++ = (int8_t)((r > 127) ? 127 : r);
+	}
+}
+
+template <> void conv_f32_to_int<int8_t>(const float * in, int8_t * out, int n) { conv_f32_to_s8(in, out, n); }
+template <> void conv_f32_to_int<int16_t>(const float * in, int16_t * out, int n) { conv_f32_to_s16(in, out, n); }
+template <> void conv_f32_to_int<int32_t>(const float * in, int32_t * out, int n) { conv_f32_to_s32(in, out, n); }
+template <> void conv_s32_to_int<int8_t>(const int32_t * in, int8_t * out, int n) { conv_s32_to_s8(in, out, n); }
+template <> void conv_s32_to_int<int16_t>(const int32_t * in, int16_t * out, int n) { conv_s32_to_s16(in, out, n); }
+template <> void conv_s32_to_int<int32_t>(const int32_t * in, int32_t * out, int n) { memcpy(out, in, n * sizeof(int32_t)); }
+
+void conv_u8_mix_f32_scalar(const uint8_t * in, float * out, int nPairs, float scale, float * phasor, const float * step)
+{
+	float c = phasor[0], s = phasor[1];
+	const float wc = step[0], ws = step[1];
+	for (int i = 0; i < nPairs; i++)
+	{
+		const float xr = (float)((int)in[2 * i] - 128) * scale;
+		const float xi = (float)((int)in[2 * i + 1] - 128) * scale;
+		out[2 * i] = xr * c - xi * s;
+		out[2 * i + 1] = xr * s + xi * c;
+		const float t = c * wc - s * ws;
+		s = c * ws + s * wc;
+		c = t;
+	}
+	phasor[0] = c;
+	phasor[1] = s;
+}
+
+void conv_u8_rot4_f32_scalar(const uint8_t * in, float * out, int nPairs, float scale, int quarter, int dir)
+{
+	int q = quarter & 3;
+	for (int i = 0; i < nPairs; i++)
+	{
+		const float xr = (float)((int)in[2 * i] - 128) * scale;
+		const float xi = (float)((int)in[2 * i + 1] - 128) * scale;
+		switch (q)
+		{
+		case 0:	out[2 * i] = xr;	out[2 * i + 1] = xi;	break;
+		case 1:	out[2 * i] = -xi;	out[2 * i + 1] = xr;	break;		// * j
+		case 2:	out[2 * i] = -xr;	out[2 * i + 1] = -xi;	break;
+		case 3:	out[2 * i] = xi;	out[2 * i + 1] = -xr;	break;		// * -j
+		}
+		q = (q + dir) & 3;
+	}
+}
+
+void conv_f32_mix_f32_scalar(const float * in, float * out, int nPairs, float * phasor, const float * step)
+{
+	float c = phasor[0], s = phasor[1];
+	const float wc = step[0], ws = step[1];
+	for (int i = 0; i < nPairs; i++)
+	{
+		const float xr = in[2 * i];
+		const float xi = in[2 * i + 1];
+		out[2 * i] = xr * c - xi * s;
+		out[2 * i + 1] = xr * s + xi * c;
+		const float t = c * wc - s * ws;
+		s = c * ws + s * wc;
+		c = t;
+	}
+	phasor[0] = c;
+	phasor[1] = s;
+}
+
+void conv_f32_rot4_f32_scalar(const float * in, float * out, int nPairs, int quarter, int dir)
+{
+	int q = quarter & 3;
+	for (int i = 0; i < nPairs; i++)
+	{
+		const float xr = in[2 * i];
+		const float xi = in[2 * i + 1];
+		switch (q)
+		{
+		case 0:	out[2 * i] = xr;	out[2 * i + 1] = xi;	break;
+		case 1:	out[2 * i] = -xi;	out[2 * i + 1] = xr;	break;
+		case 2:	out[2 * i] = -xr;	out[2 * i + 1] = -xi;	break;
+		case 3:	out[2 * i] = xi;	out[2 * i + 1] = -xr;	break;
+		}
+		q = (q + dir) & 3;
+	}
+}
+
+void conv_u8_iqcorr_f32_scalar(const uint8_t * in, float * out, int nPairs, float scale, const float * coef)
+{
+	const float biasI = 128.0F + coef[0], biasQ = 128.0F + coef[1];
+	const float a = coef[2] * scale, b = coef[3] * scale;
+	for (int i = 0; i < nPairs; i++)
+	{
+		const float xi = (float)in[2 * i] - biasI;
+		const float xq = (float)in[2 * i + 1] - biasQ;
+		out[2 * i] = xi * scale;
+		out[2 * i + 1] = a * xq + b * xi;
+	}
+}
+
+void conv_u8_iqstats_scalar(const uint8_t * in, int nPairs, int64_t * sums)
+{
+	int64_t sI = 0, sQ = 0, sII = 0, sQQ = 0, sIQ = 0;
+	for (int i = 0; i < nPairs; i++)
+	{
+		const int xi = (int)in[2 * i] - 128;
+		const int xq = (int)in[2 * i + 1] - 128;
+		sI += xi;	sQ += xq;
+		sII += xi * xi;	sQQ += xq * xq;	sIQ += xi * xq;
+	}
+	sums[0] += sI;	sums[1] += sQ;
+	sums[2] += sII;	sums[3] += sQQ;	sums[4] += sIQ;
+}
+
+void conv_u8_real_f32_scalar(const uint8_t * in, float * out, int nPairs, int channel, float scale, int quarter)
+{
+	in += channel & 1;
+	int q = quarter & 3;
+	for (int i = 0; i < nPairs; i++)
+	{
+		const float x = (float)((int)in[2 * i] - 128) * scale;
+		out[i] = (q & 2) ? -x : x;
+		q = (q + 1) & 3;
+	}
+}
+
+#if CONV_HAVE_X86
+
+CONV_TARGET_SSE2
+void conv_u8_to_s16_sse2(const uint8_t * in, int16_t * out, int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	int i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		const __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias);
+		const __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias);
+		_mm_storeu_si128((__m128i *)(out + i), lo);
+		_mm_storeu_si128((__m128i *)(out + i + 8), hi);
+	}
+	conv_u8_to_s16_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_AVX2
+void conv_u8_to_s16_avx2(const uint8_t * in, int16_t * out, int n)
+{
+	const __m256i bias = _mm256_set1_epi16(128);
+	int i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		const __m128i v0 = _mm_loadu_si128((const __m128i *)(in + i));
+		const __m128i v1 = _mm_loadu_si128((const __m128i *)(in + i + 16));
+		const __m256i lo = _mm256_sub_epi16(_mm256_cvtepu8_epi16(v0), bias);
+		const __m256i hi = _mm256_sub_epi16(_mm256_cvtepu8_epi16(v1), bias);
+		_mm256_storeu_si256((__m256i *)(out + i), lo);
+		_mm256_storeu_si256((__m256i *)(out + i + 16), hi);
+	}
+	_mm256_zeroupper();
+	conv_u8_to_s16_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_SSE2
+void conv_u8_to_f32_sse2(const uint8_t * in, float * out, int n, float scale)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128 vscale = _mm_set1_ps(scale);
+	int i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		const __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias);
+		const __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias);
+		// sign extend 16 -> 32 bit: unpack into upper half, then arithmetic shift
+		const __m128i w0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+		const __m128i w1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16);
+		const __m128i w2 = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16);
+		const __m128i w3 = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+		_mm_storeu_ps(out + i,      _mm_mul_ps(_mm_cvtepi32_ps(w0), vscale));
+		_mm_storeu_ps(out + i + 4,  _mm_mul_ps(_mm_cvtepi32_ps(w1), vscale));
+		_mm_storeu_ps(out + i + 8,  _mm_mul_ps(_mm_cvtepi32_ps(w2), vscale));
+		_mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(w3), vscale));
+	}
+	conv_u8_to_f32_scalar(in + i, out + i, n - i, scale);
+}
+
+CONV_TARGET_AVX2
+void conv_u8_to_f32_avx2(const uint8_t * in, float * out, int n, float scale)
+{
+	const __m256i bias = _mm256_set1_epi32(128);
+	const __m256 vscale = _mm256_set1_ps(scale);
+	int i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		for (int k = 0; k < 32; k += 8)
+		{
+			const __m256i w = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(in + i + k))), bias);
+			_mm256_storeu_ps(out + i + k, _mm256_mul_ps(_mm256_cvtepi32_ps(w), vscale));
+		}
+	}
+	_mm256_zeroupper();
+	conv_u8_to_f32_scalar(in + i, out + i, n - i, scale);
+}
+
+CONV_TARGET_SSE2
+void conv_f32_to_s16_sse2(const float * in, int16_t * out, int n)
+{
+	// as the scalar kernel: cvtps would round half to even. saturate, add +-0.5 with
+	// the sign of the value and truncate
+	const __m128 lo = _mm_set1_ps(-32768.0F);
+	const __m128 hi = _mm_set1_ps(32767.0F);
+	const __m128 half = _mm_set1_ps(0.5F);
+	const __m128 sign = _mm_set1_ps(-0.0F);
+	int i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		const __m128 va = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi);
+		const __m128 vb = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lo), hi);
+		const __m128i a = _mm_cvttps_epi32(_mm_add_ps(va, _mm_or_ps(_mm_and_ps(va, sign), half)));
+		const __m128i b = _mm_cvttps_epi32(_mm_add_ps(vb, _mm_or_ps(_mm_and_ps(vb, sign), half)));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(a, b));
+	}
+	conv_f32_to_s16_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_SSE2
+void conv_s32_to_s16_sse2(const int32_t * in, int16_t * out, int n)
+{
+	const __m128i one = _mm_set1_epi32(1);
+	int i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i a = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(in + i)), 15);
+		__m128i b = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(in + i + 4)), 15);
+		a = _mm_srai_epi32(_mm_add_epi32(a, one), 1);
+		b = _mm_srai_epi32(_mm_add_epi32(b, one), 1);
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(a, b));
+	}
+	conv_s32_to_s16_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_AVX2
+void conv_f32_to_s16_avx2(const float * in, int16_t * out, int n)
+{
+	const __m256 lo = _mm256_set1_ps(-32768.0F);
+	const __m256 hi = _mm256_set1_ps(32767.0F);
+	const __m256 half = _mm256_set1_ps(0.5F);
+	const __m256 sign = _mm256_set1_ps(-0.0F);
+	int i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m256 va = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i), lo), hi);
+		const __m256 vb = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i + 8), lo), hi);
+		const __m256i a = _mm256_cvttps_epi32(_mm256_add_ps(va, _mm256_or_ps(_mm256_and_ps(va, sign), half)));
+		const __m256i b = _mm256_cvttps_epi32(_mm256_add_ps(vb, _mm256_or_ps(_mm256_and_ps(vb, sign), half)));
+		// packs works per 128 bit lane: a0 b0 a1 b1 -> a0 a1 b0 b1
+		const __m256i ab = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i *)(out + i), ab);
+	}
+	_mm256_zeroupper();
+	conv_f32_to_s16_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_AVX2
+void conv_s32_to_s16_avx2(const int32_t * in, int16_t * out, int n)
+{
+	const __m256i one = _mm256_set1_epi32(1);
+	int i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m256i a = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(in + i)), 15);
+		__m256i b = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(in + i + 8)), 15);
+		a = _mm256_srai_epi32(_mm256_add_epi32(a, one), 1);
+		b = _mm256_srai_epi32(_mm256_add_epi32(b, one), 1);
+		const __m256i ab = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i *)(out + i), ab);
+	}
+	_mm256_zeroupper();
+	conv_s32_to_s16_scalar(in + i, out + i, n - i);
+}
+
+// the int16 kernels with another range: rounded values stay within int8, the packs do not saturate
+CONV_TARGET_SSE2
+static inline __m128i round_s8_sse2(__m128 v)
+{
+	v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-128.0F)), _mm_set1_ps(127.0F));
+	return _mm_cvttps_epi32(_mm_add_ps(v, _mm_or_ps(_mm_and_ps(v, _mm_set1_ps(-0.0F)), _mm_set1_ps(0.5F))));
+}
+
+CONV_TARGET_SSE2
+void conv_f32_to_s8_sse2(const float * in, int8_t * out, int n)
+{
+	int i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m128i ab = _mm_packs_epi32(round_s8_sse2(_mm_loadu_ps(in + i)), round_s8_sse2(_mm_loadu_ps(in + i + 4)));
+		const __m128i cd = _mm_packs_epi32(round_s8_sse2(_mm_loadu_ps(in + i + 8)), round_s8_sse2(_mm_loadu_ps(in + i + 12)));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi16(ab, cd));
+	}
+	conv_f32_to_s8_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_AVX2
+static inline __m256i round_s8_avx2(__m256 v)
+{
+	v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-128.0F)), _mm256_set1_ps(127.0F));
+	return _mm256_cvttps_epi32(_mm256_add_ps(v, _mm256_or_ps(_mm256_and_ps(v, _mm256_set1_ps(-0.0F)), _mm256_set1_ps(0.5F))));
+}
+
+CONV_TARGET_AVX2
+void conv_f32_to_s8_avx2(const float * in, int8_t * out, int n)
+{
+	// both packs per 128 bit lane leave dwords a0 b0 c0 d0 a1 b1 c1 d1
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	int i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		const __m256i ab = _mm256_packs_epi32(round_s8_avx2(_mm256_loadu_ps(in + i)), round_s8_avx2(_mm256_loadu_ps(in + i + 8)));
+		const __m256i cd = _mm256_packs_epi32(round_s8_avx2(_mm256_loadu_ps(in + i + 16)), round_s8_avx2(_mm256_loadu_ps(in + i + 24)));
+		const __m256i abcd = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(ab, cd), order);
+		_mm256_storeu_si256((__m256i *)(out + i), abcd);
+	}
+	_mm256_zeroupper();
+	conv_f32_to_s8_scalar(in + i, out + i, n - i);
+}
+
+// float has no exact +-0.5 at 32 bit: truncate, then step by one where the remaining
+// fraction - exact in float - reaches a half. at and above 2^31 cvttps gives 0x80000000
+CONV_TARGET_SSE2
+void conv_f32_to_s32_sse2(const float * in, int32_t * out, int n)
+{
+	const __m128 lo = _mm_set1_ps(-2147483648.0F);
+	const __m128 lim = _mm_set1_ps(2147483648.0F);
+	const __m128 half = _mm_set1_ps(0.5F);
+	const __m128 mhalf = _mm_set1_ps(-0.5F);
+	const __m128i max = _mm_set1_epi32(0x7fffffff);
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		const __m128 v = _mm_max_ps(_mm_loadu_ps(in + i), lo);		// NaN -> lo as in the scalar kernel
+		__m128i r = _mm_cvttps_epi32(v);
+		const __m128 frac = _mm_sub_ps(v, _mm_cvtepi32_ps(r));
+		r = _mm_sub_epi32(r, _mm_castps_si128(_mm_cmpge_ps(frac, half)));
+		r = _mm_add_epi32(r, _mm_castps_si128(_mm_cmple_ps(frac, mhalf)));
+		const __m128i over = _mm_castps_si128(_mm_cmpge_ps(v, lim));
+		r = _mm_or_si128(_mm_andnot_si128(over, r), _mm_and_si128(over, max));
+		_mm_storeu_si128((__m128i *)(out + i), r);
+	}
+	conv_f32_to_s32_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_AVX2
+void conv_f32_to_s32_avx2(const float * in, int32_t * out, int n)
+{
+	const __m256 lo = _mm256_set1_ps(-2147483648.0F);
+	const __m256 lim = _mm256_set1_ps(2147483648.0F);
+	const __m256 half = _mm256_set1_ps(0.5F);
+	const __m256 mhalf = _mm256_set1_ps(-0.5F);
+	const __m256 max = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	int i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		const __m256 v = _mm256_max_ps(_mm256_loadu_ps(in + i), lo);
+		__m256i r = _mm256_cvttps_epi32(v);
+		const __m256 frac = _mm256_sub_ps(v, _mm256_cvtepi32_ps(r));
+		r = _mm256_sub_epi32(r, _mm256_castps_si256(_mm256_cmp_ps(frac, half, _CMP_GE_OQ)));
+		r = _mm256_add_epi32(r, _mm256_castps_si256(_mm256_cmp_ps(frac, mhalf, _CMP_LE_OQ)));
+		const __m256 over = _mm256_cmp_ps(v, lim, _CMP_GE_OQ);
+		_mm256_storeu_ps((float *)(out + i), _mm256_blendv_ps(_mm256_castsi256_ps(r), max, over));
+	}
+	_mm256_zeroupper();
+	conv_f32_to_s32_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_SSE2
+void conv_s32_to_s8_sse2(const int32_t * in, int8_t * out, int n)
+{
+	const __m128i one = _mm_set1_epi32(1);
+	int i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i v[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			v[k] = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(in + i + 4 * k)), 23);
+			v[k] = _mm_srai_epi32(_mm_add_epi32(v[k], one), 1);
+		}
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+	}
+	conv_s32_to_s8_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_AVX2
+void conv_s32_to_s8_avx2(const int32_t * in, int8_t * out, int n)
+{
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	int i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		__m256i v[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			v[k] = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(in + i + 8 * k)), 23);
+			v[k] = _mm256_srai_epi32(_mm256_add_epi32(v[k], one), 1);
+		}
+		const __m256i abcd = _mm256_packs_epi16(_mm256_packs_epi32(v[0], v[1]), _mm256_packs_epi32(v[2], v[3]));
+		_mm256_storeu_si256((__m256i *)(out + i), _mm256_permutevar8x32_epi32(abcd, order));
+	}
+	_mm256_zeroupper();
+	conv_s32_to_s8_scalar(in + i, out + i, n - i);
+}
+
+CONV_TARGET_SSE2
+void conv_s32_to_f32_sse2(const int32_t * in, float * out, int n, float scale)
+{
+	const __m128 vscale = _mm_set1_ps(scale);
+	int i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		const __m128 a = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(in + i)));
+		const __m128 b = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(in + i + 4)));
+		_mm_storeu_ps(out + i, _mm_mul_ps(a, vscale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(b, vscale));
+	}
+	conv_s32_to_f32_scalar(in + i, out + i, n - i, scale);
+}
+
+CONV_TARGET_SSE2
+void conv_u8_mix_f32_sse2(const uint8_t * in, float * out, int nPairs, float scale, float * phasor, const float * step)
+{
+	// two pairs per vector: p = c0 s0 c1 s1, advancing by step^2
+	const float c1 = phasor[0] * step[0] - phasor[1] * step[1];
+	const float s1 = phasor[0] * step[1] + phasor[1] * step[0];
+	const float wc2 = step[0] * step[0] - step[1] * step[1];
+	const float ws2 = 2.0F * step[0] * step[1];
+	__m128 p = _mm_setr_ps(phasor[0], phasor[1], c1, s1);
+	const __m128 w2c = _mm_set1_ps(wc2);
+	const __m128 w2s = _mm_setr_ps(-ws2, ws2, -ws2, ws2);
+	const __m128 sign = _mm_setr_ps(-scale, scale, -scale, scale);
+	const __m128 vscale = _mm_set1_ps(scale);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi32(128);
+	int i = 0;
+	for (; i + 2 <= nPairs; i += 2)
+	{
+		int32_t raw;
+		memcpy(&raw, in + 2 * i, 4);
+		const __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(raw), zero), zero);
+		const __m128 x = _mm_cvtepi32_ps(_mm_sub_epi32(v, bias));			// r0 i0 r1 i1
+		const __m128 xs = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));	// i0 r0 i1 r1
+		const __m128 pc = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));	// c0 c0 c1 c1
+		const __m128 ps = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));	// s0 s0 s1 s1
+		const __m128 y = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(x, pc), vscale), _mm_mul_ps(_mm_mul_ps(xs, ps), sign));
+		_mm_storeu_ps(out + 2 * i, y);
+		const __m128 pswap = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1));
+		p = _mm_add_ps(_mm_mul_ps(p, w2c), _mm_mul_ps(pswap, w2s));
+	}
+	float next[4];
+	_mm_storeu_ps(next, p);
+	phasor[0] = next[0];
+	phasor[1] = next[1];
+	conv_u8_mix_f32_scalar(in + 2 * i, out + 2 * i, nPairs - i, scale, phasor, step);
+}
+
+CONV_TARGET_SSE2
+void conv_u8_rot4_f32_sse2(const uint8_t * in, float * out, int nPairs, float scale, int quarter, int dir)
+{
+	// scalar up to rotation 1, then 4 pairs per loop: 1, j^dir, -1, -j^dir
+	int i = (4 - quarter * dir) & 3;
+	if (i > nPairs)
+		i = nPairs;
+	conv_u8_rot4_f32_scalar(in, out, i, scale, quarter, dir);
+
+	const __m128 signA = _mm_setr_ps(scale, scale, -dir * scale, dir * scale);
+	const __m128 signB = _mm_setr_ps(-scale, -scale, dir * scale, -dir * scale);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi32(128);
+	for (; i + 4 <= nPairs; i += 4)
+	{
+		const __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(in + 2 * i)), zero);
+		const __m128 a = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpacklo_epi16(v, zero), bias));	// r0 i0 r1 i1
+		const __m128 b = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpackhi_epi16(v, zero), bias));	// r2 i2 r3 i3
+		// swap the second pair: r0 i0 i1 r1, then signs
+		_mm_storeu_ps(out + 2 * i, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 1, 0)), signA));
+		_mm_storeu_ps(out + 2 * i + 4, _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 1, 0)), signB));
+	}
+	conv_u8_rot4_f32_scalar(in + 2 * i, out + 2 * i, nPairs - i, scale, 0, dir);
+}
+
+CONV_TARGET_SSE2
+void conv_f32_mix_f32_sse2(const float * in, float * out, int nPairs, float * phasor, const float * step)
+{
+	// as conv_u8_mix_f32_sse2()
+	const float c1 = phasor[0] * step[0] - phasor[1] * step[1];
+	const float s1 = phasor[0] * step[1] + phasor[1] * step[0];
+	const float wc2 = step[0] * step[0] - step[1] * step[1];
+	const float ws2 = 2.0F * step[0] * step[1];
+	__m128 p = _mm_setr_ps(phasor[0], phasor[1], c1, s1);
+	const __m128 w2c = _mm_set1_ps(wc2);
+	const __m128 w2s = _mm_setr_ps(-ws2, ws2, -ws2, ws2);
+	const __m128 sign = _mm_setr_ps(-1.0F, 1.0F, -1.0F, 1.0F);
+	int i = 0;
+	for (; i + 2 <= nPairs; i += 2)
+	{
+		const __m128 x = _mm_loadu_ps(in + 2 * i);
+		const __m128 xs = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+		const __m128 pc = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+		const __m128 ps = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+		_mm_storeu_ps(out + 2 * i, _mm_add_ps(_mm_mul_ps(x, pc), _mm_mul_ps(_mm_mul_ps(xs, ps), sign)));
+		const __m128 pswap = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1));
+		p = _mm_add_ps(_mm_mul_ps(p, w2c), _mm_mul_ps(pswap, w2s));
+	}
+	float next[4];
+	_mm_storeu_ps(next, p);
+	phasor[0] = next[0];
+	phasor[1] = next[1];
+	conv_f32_mix_f32_scalar(in + 2 * i, out + 2 * i, nPairs - i, phasor, step);
+}
+
+CONV_TARGET_SSE2
+void conv_f32_rot4_f32_sse2(const float * in, float * out, int nPairs, int quarter, int dir)
+{
+	// as conv_u8_rot4_f32_sse2()
+	int i = (4 - quarter * dir) & 3;
+	if (i > nPairs)
+		i = nPairs;
+	conv_f32_rot4_f32_scalar(in, out, i, quarter, dir);
+
+	const __m128 signA = _mm_setr_ps(1.0F, 1.0F, (float)-dir, (float)dir);
+	const __m128 signB = _mm_setr_ps(-1.0F, -1.0F, (float)dir, (float)-dir);
+	for (; i + 4 <= nPairs; i += 4)
+	{
+		const __m128 a = _mm_loadu_ps(in + 2 * i);
+		const __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+		_mm_storeu_ps(out + 2 * i, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 1, 0)), signA));
+		_mm_storeu_ps(out + 2 * i + 4, _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 1, 0)), signB));
+	}
+	conv_f32_rot4_f32_scalar(in + 2 * i, out + 2 * i, nPairs - i, 0, dir);
+}
+
+CONV_TARGET_SSE2
+void conv_u8_iqcorr_f32_sse2(const uint8_t * in, float * out, int nPairs, float scale, const float * coef)
+{
+	// as conv_u8_to_f32_sse2() - with the same number of operations: fixed point
+	// (in - 128 - dc) * 2^7 in 16 bit, then madd of each duplicated pair with (1, 0) and (b, a) in 2^14
+	const int biasI = 128 * 128 + (int)floor(coef[0] * 128.0F + 0.5F);
+	const int biasQ = 128 * 128 + (int)floor(coef[1] * 128.0F + 0.5F);
+	const short ka = (short)floor(coef[2] * 16384.0F + 0.5F);
+	const short kb = (short)floor(coef[3] * 16384.0F + 0.5F);
+	const __m128i bias = _mm_setr_epi16((short)biasI, (short)biasQ, (short)biasI, (short)biasQ
+		, (short)biasI, (short)biasQ, (short)biasI, (short)biasQ);
+	const __m128i k = _mm_setr_epi16(16384, 0, kb, ka, 16384, 0, kb, ka);
+	const __m128 vscale = _mm_set1_ps(scale / (128.0F * 16384.0F));
+	const __m128i zero = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 8 <= nPairs; i += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+		const __m128i lo = _mm_sub_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(v, zero), 7), bias);
+		const __m128i hi = _mm_sub_epi16(_mm_slli_epi16(_mm_unpackhi_epi8(v, zero), 7), bias);
+		const __m128i w0 = _mm_madd_epi16(_mm_unpacklo_epi32(lo, lo), k);		// I0' Q0' I1' Q1'
+		const __m128i w1 = _mm_madd_epi16(_mm_unpackhi_epi32(lo, lo), k);
+		const __m128i w2 = _mm_madd_epi16(_mm_unpacklo_epi32(hi, hi), k);
+		const __m128i w3 = _mm_madd_epi16(_mm_unpackhi_epi32(hi, hi), k);
+		_mm_storeu_ps(out + 2 * i,      _mm_mul_ps(_mm_cvtepi32_ps(w0), vscale));
+		_mm_storeu_ps(out + 2 * i + 4,  _mm_mul_ps(_mm_cvtepi32_ps(w1), vscale));
+		_mm_storeu_ps(out + 2 * i + 8,  _mm_mul_ps(_mm_cvtepi32_ps(w2), vscale));
+		_mm_storeu_ps(out + 2 * i + 12, _mm_mul_ps(_mm_cvtepi32_ps(w3), vscale));
+	}
+	conv_u8_iqcorr_f32_scalar(in + 2 * i, out + 2 * i, nPairs - i, scale, coef);
+}
+
+CONV_TARGET_AVX2
+void conv_u8_iqcorr_f32_avx2(const uint8_t * in, float * out, int nPairs, float scale, const float * coef)
+{
+	// the sse2 kernel on 8 pairs per register. unpack and madd work per 128 bit lane:
+	// pairs 0 1 4 5 and 2 3 6 7 - put back in order by the lane permutes
+	const int biasI = 128 * 128 + (int)floor(coef[0] * 128.0F + 0.5F);
+	const int biasQ = 128 * 128 + (int)floor(coef[1] * 128.0F + 0.5F);
+	const short ka = (short)floor(coef[2] * 16384.0F + 0.5F);
+	const short kb = (short)floor(coef[3] * 16384.0F + 0.5F);
+	const __m256i bias = _mm256_set1_epi32((int)(((unsigned)(unsigned short)biasQ << 16) | (unsigned short)biasI));
+	const __m256i k = _mm256_set1_epi64x((long long)(((uint64_t)(unsigned short)ka << 48) | ((uint64_t)(unsigned short)kb << 32) | 16384));
+	const __m256 vscale = _mm256_set1_ps(scale / (128.0F * 16384.0F));
+	int i = 0;
+	for (; i + 16 <= nPairs; i += 16)
+	{
+		for (int h = 0; h < 16; h += 8)
+		{
+			const __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in + 2 * (i + h))));
+			const __m256i x = _mm256_sub_epi16(_mm256_slli_epi16(v, 7), bias);
+			const __m256 w0 = _mm256_cvtepi32_ps(_mm256_madd_epi16(_mm256_unpacklo_epi32(x, x), k));	// I0' Q0' I1' Q1' | I4' ..
+			const __m256 w1 = _mm256_cvtepi32_ps(_mm256_madd_epi16(_mm256_unpackhi_epi32(x, x), k));	// I2' Q2' I3' Q3' | I6' ..
+			_mm256_storeu_ps(out + 2 * (i + h),     _mm256_mul_ps(_mm256_permute2f128_ps(w0, w1, 0x20), vscale));
+			_mm256_storeu_ps(out + 2 * (i + h) + 8, _mm256_mul_ps(_mm256_permute2f128_ps(w0, w1, 0x31), vscale));
+		}
+	}
+	_mm256_zeroupper();
+	conv_u8_iqcorr_f32_scalar(in + 2 * i, out + 2 * i, nPairs - i, scale, coef);
+}
+
+CONV_TARGET_SSE2
+void conv_u8_iqstats_sse2(const uint8_t * in, int nPairs, int64_t * sums)
+{
+	// 8 pairs per loop as 16 bit: madd of I0 Q0 I1 Q1 .. with masked copies.
+	// 32 bit lanes take at most 2 * 128 * 128 * 65536 / 4
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128i maskI = _mm_set1_epi32(0x0000FFFF);
+	const __m128i onesI = _mm_set1_epi32(0x00000001);
+	const __m128i onesQ = _mm_set1_epi32(0x00010000);
+	__m128i sI = zero, sQ = zero, sII = zero, sQQ = zero, sIQ = zero;
+	int i = 0;
+	for (; i + 8 <= nPairs; i += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+		const __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias);
+		const __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias);
+		const __m128i x[2] = { lo, hi };
+		for (int k = 0; k < 2; ++k)
+		{
+			const __m128i xI = _mm_and_si128(x[k], maskI);			// I 0 I 0 ..
+			const __m128i xQ = _mm_andnot_si128(maskI, x[k]);		// 0 Q 0 Q ..
+			sI = _mm_add_epi32(sI, _mm_madd_epi16(x[k], onesI));
+			sQ = _mm_add_epi32(sQ, _mm_madd_epi16(x[k], onesQ));
+			sII = _mm_add_epi32(sII, _mm_madd_epi16(xI, xI));
+			sQQ = _mm_add_epi32(sQQ, _mm_madd_epi16(xQ, xQ));
+			sIQ = _mm_add_epi32(sIQ, _mm_madd_epi16(xI, _mm_srli_epi32(x[k], 16)));
+		}
+	}
+	const __m128i acc[5] = { sI, sQ, sII, sQQ, sIQ };
+	for (int k = 0; k < 5; ++k)
+	{
+		int32_t v[4];
+		_mm_storeu_si128((__m128i *)v, acc[k]);
+		sums[k] += (int64_t)v[0] + v[1] + v[2] + v[3];
+	}
+	conv_u8_iqstats_scalar(in + 2 * i, nPairs - i, sums);
+}
+
+CONV_TARGET_SSE2
+void conv_u8_real_f32_sse2(const uint8_t * in, float * out, int nPairs, int channel, float scale, int quarter)
+{
+	// 8 pairs per loop: the sign pattern repeats every 4 samples
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	const __m128i bias = _mm_set1_epi16(128);
+	float s[4];
+	for (int k = 0; k < 4; ++k)
+		s[k] = ((quarter + k) & 2) ? -scale : scale;
+	const __m128 vscale = _mm_loadu_ps(s);
+	int i = 0;
+	for (; i + 8 <= nPairs; i += 8)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+		const __m128i x = _mm_sub_epi16(channel ? _mm_srli_epi16(v, 8) : _mm_and_si128(v, mask), bias);
+		const __m128i w0 = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		const __m128i w1 = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+		_mm_storeu_ps(out + i,     _mm_mul_ps(_mm_cvtepi32_ps(w0), vscale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(w1), vscale));
+	}
+	conv_u8_real_f32_scalar(in + 2 * i, out + i, nPairs - i, channel, scale, quarter + i);
+}
+
+#endif
@@ -0,0 +1,225 @@
+/*
+ * sample conversion kernels for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CONV_HAVE_X86	1
+#else
+#define CONV_HAVE_X86	0
+#endif
+
+// gcc/clang need the instruction set enabled per function, MSVC does not
+#if CONV_HAVE_X86 && defined(__GNUC__)
+#define CONV_TARGET_SSE2	__attribute__((target("sse2")))
+#define CONV_TARGET_AVX2	__attribute__((target("avx2")))
+#else
+#define CONV_TARGET_SSE2
+#define CONV_TARGET_AVX2
+#endif
+
+
+// CPU features - bitmask returned by conv_cpu_features()
+#define CONV_CPU_SSE2	1
+#define CONV_CPU_AVX2	2
+
+
+// converts n unsigned 8 bit values (with 128 bias) to signed 16 bit
+typedef void (*conv_u8_to_s16_fn)(const uint8_t * in, int16_t * out, int n);
+
+// converts n unsigned 8 bit values to float: (in - 128) * scale
+typedef void (*conv_u8_to_f32_fn)(const uint8_t * in, float * out, int n, float scale);
+
+// converts n floats to signed 16 bit - saturated, rounded half away from zero. bit exact in all kernels
+typedef void (*conv_f32_to_s16_fn)(const float * in, int16_t * out, int n);
+
+// converts n full scale 32 bit values to 16 bit: rounded upper half
+typedef void (*conv_s32_to_s16_fn)(const int32_t * in, int16_t * out, int n);
+
+// converts n 32 bit values to float: in * scale
+typedef void (*conv_s32_to_f32_fn)(const int32_t * in, float * out, int n, float scale);
+
+// the same for the other output formats: floats at the level of int8 / int32, full scale 32 bit
+// values to their upper 8 bits. 32 bit to 32 bit is a copy
+typedef void (*conv_f32_to_s8_fn)(const float * in, int8_t * out, int n);
+typedef void (*conv_f32_to_s32_fn)(const float * in, int32_t * out, int n);
+typedef void (*conv_s32_to_s8_fn)(const int32_t * in, int8_t * out, int n);
+
+// output stage of the decimators for the signed formats T = int8_t, int16_t and int32_t,
+// through the active kernels above. floats at the level of T: saturated, rounded half away
+// from zero - bit exact in all kernels. full scale 32 bit values: rounded upper bits
+template <class T> void conv_f32_to_int(const float * in, T * out, int n);
+template <class T> void conv_s32_to_int(const int32_t * in, T * out, int n);
+
+// mixes nPairs unsigned 8 bit I/Q with a complex oscillator: out = (in - 128) * scale * phasor,
+// phasor advancing by step for each pair. phasor[2] is re/im - updated for the next call
+typedef void (*conv_u8_mix_f32_fn)(const uint8_t * in, float * out, int nPairs, float scale, float * phasor, const float * step);
+
+// shift by fs/4 without multiplications: out = (in - 128) * scale * j^(quarter + dir * k) for pair k
+// with quarter 0 .. 3 and dir +1 / -1
+typedef void (*conv_u8_rot4_f32_fn)(const uint8_t * in, float * out, int nPairs, float scale, int quarter, int dir);
+
+// both shifts on complex float: in and out may be the same
+typedef void (*conv_f32_mix_f32_fn)(const float * in, float * out, int nPairs, float * phasor, const float * step);
+typedef void (*conv_f32_rot4_f32_fn)(const float * in, float * out, int nPairs, int quarter, int dir);
+
+// conversion with DC and I/Q imbalance correction, coef[] = dcI, dcQ, a, b in raw units:
+// I = in - 128 - dcI, Q = in - 128 - dcQ; out = ( I, a * Q + b * I ) * scale.
+// SIMD kernels use fixed point: |dc| < 100, 0 < a < 2 and |b| < 1
+typedef void (*conv_u8_iqcorr_f32_fn)(const uint8_t * in, float * out, int nPairs, float scale, const float * coef);
+
+// one channel of nPairs unsigned 8 bit I/Q as real samples, shifted by -fs/4 for the real to complex
+// halfband: out[k] = (in[2 * k + channel] - 128) * scale * s(quarter + k) with s = +1 +1 -1 -1 ..
+typedef void (*conv_u8_real_f32_fn)(const uint8_t * in, float * out, int nPairs, int channel, float scale, int quarter);
+
+// adds the sums of I, Q, I*I, Q*Q and I*Q of nPairs unsigned 8 bit I/Q (without 128 bias) to sums[5].
+// exact: nPairs up to 65536
+typedef void (*conv_u8_iqstats_fn)(const uint8_t * in, int nPairs, int64_t * sums);
+
+template <class FN>
+struct conv_kernel
+{
+	const char * name;
+	int required_cpu;		// CONV_CPU_* bits
+	FN fn;
+};
+
+typedef conv_kernel<conv_u8_to_s16_fn> conv_kernel_u8_s16;
+typedef conv_kernel<conv_u8_to_f32_fn> conv_kernel_u8_f32;
+typedef conv_kernel<conv_f32_to_s16_fn> conv_kernel_f32_s16;
+typedef conv_kernel<conv_s32_to_s16_fn> conv_kernel_s32_s16;
+typedef conv_kernel<conv_f32_to_s8_fn> conv_kernel_f32_s8;
+typedef conv_kernel<conv_f32_to_s32_fn> conv_kernel_f32_s32;
+typedef conv_kernel<conv_s32_to_s8_fn> conv_kernel_s32_s8;
+typedef conv_kernel<conv_s32_to_f32_fn> conv_kernel_s32_f32;
+typedef conv_kernel<conv_u8_mix_f32_fn> conv_kernel_u8_mix_f32;
+typedef conv_kernel<conv_u8_rot4_f32_fn> conv_kernel_u8_rot4_f32;
+typedef conv_kernel<conv_f32_mix_f32_fn> conv_kernel_f32_mix_f32;
+typedef conv_kernel<conv_f32_rot4_f32_fn> conv_kernel_f32_rot4_f32;
+typedef conv_kernel<conv_u8_iqcorr_f32_fn> conv_kernel_u8_iqcorr_f32;
+typedef conv_kernel<conv_u8_iqstats_fn> conv_kernel_u8_iqstats;
+typedef conv_kernel<conv_u8_real_f32_fn> conv_kernel_u8_real_f32;
+
+// all compiled-in kernels, ordered from slowest to fastest. terminated with fn == 0.
+// lookup table kernels (convlut.cpp) come first: whether they win depends on the
+// CPU's caches - so select_kernel() never prefers them, only a measurement can
+extern const conv_kernel_u8_s16 conv_kernels_u8_s16[];
+extern const conv_kernel_u8_f32 conv_kernels_u8_f32[];
+extern const conv_kernel_f32_s16 conv_kernels_f32_s16[];
+extern const conv_kernel_s32_s16 conv_kernels_s32_s16[];
+extern const conv_kernel_f32_s8 conv_kernels_f32_s8[];
+extern const conv_kernel_f32_s32 conv_kernels_f32_s32[];
+extern const conv_kernel_s32_s8 conv_kernels_s32_s8[];
+extern const conv_kernel_s32_f32 conv_kernels_s32_f32[];
+extern const conv_kernel_u8_mix_f32 conv_kernels_u8_mix_f32[];
+extern const conv_kernel_u8_rot4_f32 conv_kernels_u8_rot4_f32[];
+extern const conv_kernel_f32_mix_f32 conv_kernels_f32_mix_f32[];
+extern const conv_kernel_f32_rot4_f32 conv_kernels_f32_rot4_f32[];
+extern const conv_kernel_u8_iqcorr_f32 conv_kernels_u8_iqcorr_f32[];
+extern const conv_kernel_u8_iqstats conv_kernels_u8_iqstats[];
+extern const conv_kernel_u8_real_f32 conv_kernels_u8_real_f32[];
+
+// detected once from CPUID
+int conv_cpu_features();
+// CPU brand string from CPUID - "unknown" without
+const char * conv_cpu_name();
+
+// kernel of a table by name - 0 when not compiled in or not supported by the CPU
+template <class FN>
+const conv_kernel<FN> * conv_find_kernel(const conv_kernel<FN> * table, const char * name)
+{
+	const int features = conv_cpu_features();
+	for (int k = 0; table[k].fn; ++k)
+	{
+		if (!strcmp(table[k].name, name) && (table[k].required_cpu & features) == table[k].required_cpu)
+			return &table[k];
+	}
+	return 0;
+}
+
+// selects the fastest supported kernel. safe to call multiple times
+void conv_init();
+
+// active kernels - valid after conv_init()
+extern conv_u8_to_s16_fn conv_u8_to_s16;
+extern const char * conv_u8_to_s16_name;
+extern conv_u8_to_f32_fn conv_u8_to_f32;
+extern conv_f32_to_s16_fn conv_f32_to_s16;
+extern conv_s32_to_s16_fn conv_s32_to_s16;
+extern conv_f32_to_s8_fn conv_f32_to_s8;
+extern conv_f32_to_s32_fn conv_f32_to_s32;
+extern conv_s32_to_s8_fn conv_s32_to_s8;
+extern conv_s32_to_f32_fn conv_s32_to_f32;
+extern conv_u8_mix_f32_fn conv_u8_mix_f32;
+extern conv_u8_rot4_f32_fn conv_u8_rot4_f32;
+extern conv_f32_mix_f32_fn conv_f32_mix_f32;
+extern conv_f32_rot4_f32_fn conv_f32_rot4_f32;
+extern conv_u8_iqcorr_f32_fn conv_u8_iqcorr_f32;
+extern conv_u8_iqstats_fn conv_u8_iqstats;
+extern conv_u8_real_f32_fn conv_u8_real_f32;
+
+
+void conv_u8_to_s16_scalar(const uint8_t * in, int16_t * out, int n);
+void conv_u8_to_f32_scalar(const uint8_t * in, float * out, int n, float scale);
+void conv_f32_to_s16_scalar(const float * in, int16_t * out, int n);
+void conv_s32_to_s16_scalar(const int32_t * in, int16_t * out, int n);
+void conv_f32_to_s8_scalar(const float * in, int8_t * out, int n);
+void conv_f32_to_s32_scalar(const float * in, int32_t * out, int n);
+void conv_s32_to_s8_scalar(const int32_t * in, int8_t * out, int n);
+void conv_s32_to_f32_scalar(const int32_t * in, float * out, int n, float scale);
+void conv_u8_mix_f32_scalar(const uint8_t * in, float * out, int nPairs, float scale, float * phasor, const float * step);
+void conv_u8_rot4_f32_scalar(const uint8_t * in, float * out, int nPairs, float scale, int quarter, int dir);
+void conv_f32_mix_f32_scalar(const float * in, float * out, int nPairs, float * phasor, const float * step);
+void conv_f32_rot4_f32_scalar(const float * in, float * out, int nPairs, int quarter, int dir);
+void conv_u8_iqcorr_f32_scalar(const uint8_t * in, float * out, int nPairs, float scale, const float * coef);
+void conv_u8_iqstats_scalar(const uint8_t * in, int nPairs, int64_t * sums);
+void conv_u8_real_f32_scalar(const uint8_t * in, float * out, int nPairs, int channel, float scale, int quarter);
+// lookup tables: for byte (lut8) or I/Q pair (lut16) values
+void conv_u8_to_s16_lut8(const uint8_t * in, int16_t * out, int n);
+void conv_u8_to_s16_lut16(const uint8_t * in, int16_t * out, int n);
+void conv_u8_to_f32_lut8(const uint8_t * in, float * out, int n, float scale);
+void conv_u8_to_f32_lut16(const uint8_t * in, float * out, int n, float scale);
+void conv_u8_iqcorr_f32_lut8(const uint8_t * in, float * out, int nPairs, float scale, const float * coef);
+void conv_u8_iqcorr_f32_lut16(const uint8_t * in, float * out, int nPairs, float scale, const float * coef);
+#if CONV_HAVE_X86
+void conv_u8_to_s16_sse2(const uint8_t * in, int16_t * out, int n);
+void conv_u8_to_s16_avx2(const uint8_t * in, int16_t * out, int n);
+void conv_u8_to_f32_sse2(const uint8_t * in, float * out, int n, float scale);
+void conv_u8_to_f32_avx2(const uint8_t * in, float * out, int n, float scale);
+void conv_f32_to_s16_sse2(const float * in, int16_t * out, int n);
+void conv_f32_to_s16_avx2(const float * in, int16_t * out, int n);
+void conv_s32_to_s16_sse2(const int32_t * in, int16_t * out, int n);
+void conv_s32_to_s16_avx2(const int32_t * in, int16_t * out, int n);
+void conv_f32_to_s8_sse2(const float * in, int8_t * out, int n);
+void conv_f32_to_s8_avx2(const float * in, int8_t * out, int n);
+void conv_f32_to_s32_sse2(const float * in, int32_t * out, int n);
+void conv_f32_to_s32_avx2(const float * in, int32_t * out, int n);
+void conv_s32_to_s8_sse2(const int32_t * in, int8_t * out, int n);
+void conv_s32_to_s8_avx2(const int32_t * in, int8_t * out, int n);
+void conv_s32_to_f32_sse2(const int32_t * in, float * out, int n, float scale);
+void conv_u8_mix_f32_sse2(const uint8_t * in, float * out, int nPairs, float scale, float * phasor, const float * step);
+void conv_u8_rot4_f32_sse2(const uint8_t * in, float * out, int nPairs, float scale, int quarter, int dir);
+void conv_f32_mix_f32_sse2(const float * in, float * out, int nPairs, float * phasor, const float * step);
+void conv_f32_rot4_f32_sse2(const float * in, float * out, int nPairs, int quarter, int dir);
+void conv_u8_iqcorr_f32_sse2(const uint8_t * in, float * out, int nPairs, float scale, const float * coef);
+void conv_u8_iqcorr_f32_avx2(const uint8_t * in, float * out, int nPairs, float scale, const float * coef);
+void conv_u8_iqstats_sse2(const uint8_t * in, int nPairs, int64_t * sums);
+void conv_u8_real_f32_sse2(const uint8_t * in, float * out, int nPairs, int channel, float scale, int quarter);
+#endif
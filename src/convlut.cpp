@@ -0,0 +1,202 @@
+/*
+ * lookup table conversion kernels for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "convert.h"
+
+#include <math.h>
+#include <string.h>
+
+
+/*
+ * a byte has 256 values, an I/Q pair 65536: the tables hold the converted
+ * value for each - with scale and correction baked in. "lut8" kernels look
+ * up each byte, "lut16" kernels the pair as one 16 bit index.
+ * tables are built on first use and rebuilt only when scale or correction
+ * change, which costs about a conversion of the table's size. they are
+ * shared: only one thread may convert with them - the processing thread.
+ * the correction estimates move a little with every block: the 65536 pair
+ * table follows small moves only every LUT16_REBUILD_PAIRS converted pairs.
+ */
+
+// correction changes below these limits (raw sample units) keep the table: an
+// output error up to 1/16 of the 8 bit step - the gain acts on up to 128
+#define LUT_DC_TOLERANCE		( 1.0F / 16.0F )
+#define LUT_GAIN_TOLERANCE		( 1.0F / 2048.0F )
+// changes beyond these rebuild the pair table at once, smaller ones at most
+// every LUT16_REBUILD_PAIRS: a rebuild then costs a 16th of the conversion
+#define LUT_DC_LIMIT			1.0F
+#define LUT_GAIN_LIMIT			( 1.0F / 128.0F )
+#define LUT16_REBUILD_PAIRS		( 16 * 65536 )
+
+
+static int16_t lut8_s16[256];
+static uint32_t lut16_s16[65536];		// I, Q as int16 in memory order
+static bool lut_s16_valid = false;
+
+static float lut8_f32[256];
+static float lut8_f32_scale = 0.0F;
+
+static float lut16_f32[2 * 65536];
+static float lut16_f32_scale = 0.0F;
+
+// correction: lut8 as I = t[0][in0], Q = t[1][in1] + t[2][in0]; lut16 per pair
+static float lut8_corr[3][256];
+static float lut8_corr_key[5];			// scale, dcI, dcQ, a, b
+static bool lut8_corr_valid = false;
+static float lut16_corr[2 * 65536];
+static float lut16_corr_key[5];
+static bool lut16_corr_valid = false;
+static int lut16_corr_pairs = 0;		// converted since the last build
+
+
+static void build_s16()
+{
+	for (int v = 0; v < 256; ++v)
+		lut8_s16[v] = (int16_t)(v - 128);
+	for (int q = 0; q < 256; ++q)
+	{
+		for (int i = 0; i < 256; ++i)
+		{
+			const int16_t iq[2] = { lut8_s16[i], lut8_s16[q] };
+			memcpy(&lut16_s16[(q << 8) | i], iq, sizeof(iq));
+		}
+	}
+	lut_s16_valid = true;
+}
+
+// pair index of little endian I, Q bytes
+static inline unsigned pair_index(const uint8_t * p)
+{
+	return (unsigned)p[0] | ((unsigned)p[1] << 8);
+}
+
+static bool same_correction(const float * key, float scale, const float * coef, float dcTolerance, float gainTolerance)
+{
+	return key[0] == scale
+		&& fabs(key[1] - coef[0]) < dcTolerance && fabs(key[2] - coef[1]) < dcTolerance
+		&& fabs(key[3] - coef[2]) < gainTolerance && fabs(key[4] - coef[3]) < gainTolerance;
+}
+
+static void set_key(float * key, float scale, const float * coef)
+{
+	key[0] = scale;
+	for (int k = 0; k < 4; ++k)
+		key[1 + k] = coef[k];
+}
+
+
+void conv_u8_to_s16_lut8(const uint8_t * in, int16_t * out, int n)
+{
+	if (!lut_s16_valid)
+		build_s16();
+	for (int i = 0; i < n; i++)
+		out[i] = lut8_s16[in[i]];
+}
+
+void conv_u8_to_s16_lut16(const uint8_t * in, int16_t * out, int n)
+{
+	if (!lut_s16_valid)
+		build_s16();
+	const int nPairs = n / 2;
+	for (int i = 0; i < nPairs; i++)
+		memcpy(out + 2 * i, &lut16_s16[pair_index(in + 2 * i)], sizeof(uint32_t));
+	if (n & 1)
+		out[n - 1] = lut8_s16[in[n - 1]];
+}
+
+void conv_u8_to_f32_lut8(const uint8_t * in, float * out, int n, float scale)
+{
+	if (lut8_f32_scale != scale)
+	{
+		for (int v = 0; v < 256; ++v)
+			lut8_f32[v] = (float)(v - 128) * scale;
+		lut8_f32_scale = scale;
+	}
+	for (int i = 0; i < n; i++)
+		out[i] = lut8_f32[in[i]];
+}
+
+void conv_u8_to_f32_lut16(const uint8_t * in, float * out, int n, float scale)
+{
+	if (lut16_f32_scale != scale)
+	{
+		for (int q = 0; q < 256; ++q)
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				lut16_f32[2 * ((q << 8) | i)] = (float)(i - 128) * scale;
+				lut16_f32[2 * ((q << 8) | i) + 1] = (float)(q - 128) * scale;
+			}
+		}
+		lut16_f32_scale = scale;
+	}
+	const int nPairs = n / 2;
+	for (int i = 0; i < nPairs; i++)
+		memcpy(out + 2 * i, &lut16_f32[2 * pair_index(in + 2 * i)], 2 * sizeof(float));
+	if (n & 1)
+		out[n - 1] = (float)((int)in[n - 1] - 128) * scale;
+}
+
+void conv_u8_iqcorr_f32_lut8(const uint8_t * in, float * out, int nPairs, float scale, const float * coef)
+{
+	if (!lut8_corr_valid || !same_correction(lut8_corr_key, scale, coef, LUT_DC_TOLERANCE, LUT_GAIN_TOLERANCE))
+	{
+		for (int v = 0; v < 256; ++v)
+		{
+			const float xi = (float)v - 128.0F - coef[0];
+			const float xq = (float)v - 128.0F - coef[1];
+			lut8_corr[0][v] = xi * scale;
+			lut8_corr[1][v] = coef[2] * xq * scale;
+			lut8_corr[2][v] = coef[3] * xi * scale;
+		}
+		set_key(lut8_corr_key, scale, coef);
+		lut8_corr_valid = true;
+	}
+	for (int i = 0; i < nPairs; i++)
+	{
+		const uint8_t vi = in[2 * i], vq = in[2 * i + 1];
+		out[2 * i] = lut8_corr[0][vi];
+		out[2 * i + 1] = lut8_corr[1][vq] + lut8_corr[2][vi];
+	}
+}
+
+void conv_u8_iqcorr_f32_lut16(const uint8_t * in, float * out, int nPairs, float scale, const float * coef)
+{
+	const bool due = lut16_corr_pairs >= LUT16_REBUILD_PAIRS;
+	if (!lut16_corr_valid || !same_correction(lut16_corr_key, scale, coef, LUT_DC_LIMIT, LUT_GAIN_LIMIT)
+		|| (due && !same_correction(lut16_corr_key, scale, coef, LUT_DC_TOLERANCE, LUT_GAIN_TOLERANCE)))
+	{
+		const float a = coef[2] * scale, b = coef[3] * scale;
+		for (int q = 0; q < 256; ++q)
+		{
+			const float xq = (float)q - 128.0F - coef[1];
+			for (int i = 0; i < 256; ++i)
+			{
+				const float xi = (float)i - 128.0F - coef[0];
+				lut16_corr[2 * ((q << 8) | i)] = xi * scale;
+				lut16_corr[2 * ((q << 8) | i) + 1] = a * xq + b * xi;
+			}
+		}
+		set_key(lut16_corr_key, scale, coef);
+		lut16_corr_valid = true;
+		lut16_corr_pairs = 0;
+	}
+	if (lut16_corr_pairs < LUT16_REBUILD_PAIRS)
+		lut16_corr_pairs += nPairs;
+	for (int i = 0; i < nPairs; i++)
+		memcpy(out + 2 * i, &lut16_corr[2 * pair_index(in + 2 * i)], 2 * sizeof(float));
+}
@@ -0,0 +1,855 @@
+/*
+ * decimation filters for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "decimator.h"
+#include "convert.h"
+#include "iqcorr.h"
+
+#include <math.h>
+#include <string.h>
+
+#if CONV_HAVE_X86
+#include <immintrin.h>
+#endif
+
+
+#define KAISER_BETA		7.0
+
+// halfband length of the last/sharp stage and of the relaxed stages in front
+#define HALFBAND_TAPS_SHARP		31
+#define HALFBAND_TAPS_RELAXED	15
+
+// longest halfband of the SIMD kernels: 31 taps
+#define HALFBAND_MAX_NCOEF		8
+// outputs per pass of the SIMD halfbands: the phases of one pass stay in the L1 cache
+#define HALFBAND_BLOCK			256
+
+// polyphase FIR: taps per output phase
+#define FIR_TAPS_PER_PHASE		16
+
+
+static double bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	const double q = x * x / 4.0;
+	for (int k = 1; k < 40; ++k)
+	{
+		term *= q / ((double)k * (double)k);
+		sum += term;
+		if (term < sum * 1E-12)
+			break;
+	}
+	return sum;
+}
+
+static double kaiser(int n, int taps, double beta)
+{
+	if (taps <= 1)
+		return 1.0;
+	const double r = (2.0 * n) / (taps - 1) - 1.0;
+	return bessel_i0(beta * sqrt(1.0 - r * r)) / bessel_i0(beta);
+}
+
+void fir_design_lowpass(float * h, int taps, double cutoff, double kaiserBeta)
+{
+	const double M_PI_ = 3.14159265358979323846;
+	const double mid = 0.5 * (taps - 1);
+	double sum = 0.0;
+	std::vector<double> d(taps);
+	for (int n = 0; n < taps; ++n)
+	{
+		const double t = n - mid;
+		const double x = 2.0 * M_PI_ * cutoff * t;
+		const double s = (t == 0.0) ? 2.0 * cutoff : sin(x) / (M_PI_ * t);
+		d[n] = s * kaiser(n, taps, kaiserBeta);
+		sum += d[n];
+	}
+	for (int n = 0; n < taps; ++n)
+		h[n] = (float)(d[n] / sum);
+}
+
+
+/*
+ * kernels: x points to the first complex input of the first output's window;
+ * output m uses the window starting at x + 2 * factor * m.
+ * the templates get specialized for the factors and lengths in use: a template
+ * argument of 0 takes the runtime parameter instead. the constant lengths let the
+ * compiler unroll the tap loops, as if written by hand for each factor.
+ */
+
+template <int NCOEF>
+static void halfband_decim_scalar(const float * x, int nOut, const float * c, int ncoef, float * y)
+{
+	const int nc = NCOEF ? NCOEF : ncoef;
+	const int center = 2 * nc - 1;
+	for (int m = 0; m < nOut; ++m)
+	{
+		const float * xc = x + 4 * m + 2 * center;
+		float accI = c[0] * xc[0];
+		float accQ = c[0] * xc[1];
+		for (int j = 0; j < nc; ++j)
+		{
+			const int d = 2 * (2 * j + 1);
+			accI += c[1 + j] * (xc[-d] + xc[d]);
+			accQ += c[1 + j] * (xc[1 - d] + xc[1 + d]);
+		}
+		*y++ = accI;
+		*y++ = accQ;
+	}
+}
+
+template <int FACTOR, int TAPS>
+static void fir_decim_scalar(const float * x, int nOut, int factor, const float * hh, int taps, float * y)
+{
+	const int f = FACTOR ? FACTOR : factor;
+	const int nt = TAPS ? TAPS : taps;
+	for (int m = 0; m < nOut; ++m)
+	{
+		const float * xm = x + 2 * f * m;
+		float accI = 0.0F, accQ = 0.0F;
+		for (int k = 0; k < nt; ++k)
+		{
+			accI += hh[2 * k] * xm[2 * k];
+			accQ += hh[2 * k + 1] * xm[2 * k + 1];
+		}
+		*y++ = accI;
+		*y++ = accQ;
+	}
+}
+
+#if CONV_HAVE_X86
+
+/*
+ * the SIMD halfbands vectorize across outputs: the odd offsets of output m all fall on
+ * the even samples x[2 (m + k)], the center on the odd ones. split into both phases,
+ * consecutive outputs use consecutive samples of a phase - one load for 2 (SSE2) or
+ * 4 (AVX2) complex outputs per tap, and no horizontal sums.
+ */
+
+// even[k] = x[2 k] for k <= nb + 2 nc - 2, odd[k] = x[2 k + 1] for k < nb + 2 nc - 2:
+// all samples of the windows of nb outputs
+CONV_TARGET_SSE2
+static void halfband_split_sse(const float * x, int nb, int nc, float * even, float * odd)
+{
+	const int pairs = nb + 2 * nc - 2;
+	int k = 0;
+	for (; k + 2 <= pairs; k += 2)
+	{
+		const __m128 a = _mm_loadu_ps(x + 4 * k);
+		const __m128 b = _mm_loadu_ps(x + 4 * k + 4);
+		_mm_storeu_ps(even + 2 * k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 1, 0)));
+		_mm_storeu_ps(odd + 2 * k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 2, 3, 2)));
+	}
+	for (; k < pairs; ++k)
+	{
+		even[2 * k] = x[4 * k];
+		even[2 * k + 1] = x[4 * k + 1];
+		odd[2 * k] = x[4 * k + 2];
+		odd[2 * k + 1] = x[4 * k + 3];
+	}
+	even[2 * k] = x[4 * k];
+	even[2 * k + 1] = x[4 * k + 1];
+}
+
+// the same split with 4 pairs per step
+CONV_TARGET_AVX2
+static void halfband_split_avx2(const float * x, int nb, int nc, float * even, float * odd)
+{
+	const int pairs = nb + 2 * nc - 2;
+	int k = 0;
+	for (; k + 4 <= pairs; k += 4)
+	{
+		// a: e0 o0 | e1 o1, b: e2 o2 | e3 o3 - the shuffle gives e0 e2 | e1 e3, the permute e0 e1 | e2 e3
+		const __m256 a = _mm256_loadu_ps(x + 4 * k);
+		const __m256 b = _mm256_loadu_ps(x + 4 * k + 8);
+		const __m256d e = _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 1, 0)));
+		const __m256d o = _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 2, 3, 2)));
+		_mm256_storeu_ps(even + 2 * k, _mm256_castpd_ps(_mm256_permute4x64_pd(e, _MM_SHUFFLE(3, 1, 2, 0))));
+		_mm256_storeu_ps(odd + 2 * k, _mm256_castpd_ps(_mm256_permute4x64_pd(o, _MM_SHUFFLE(3, 1, 2, 0))));
+	}
+	for (; k < pairs; ++k)
+	{
+		even[2 * k] = x[4 * k];
+		even[2 * k + 1] = x[4 * k + 1];
+		odd[2 * k] = x[4 * k + 2];
+		odd[2 * k + 1] = x[4 * k + 3];
+	}
+	even[2 * k] = x[4 * k];
+	even[2 * k + 1] = x[4 * k + 1];
+}
+
+// outputs from..nb of a pass, one at a time
+static void halfband_phases_scalar(const float * even, const float * odd, int from, int nb, int nc, const float * c, float * y)
+{
+	for (int m = from; m < nb; ++m)
+	{
+		const float * e = even + 2 * m;
+		const float * o = odd + 2 * (m + nc - 1);
+		float accI = c[0] * o[0];
+		float accQ = c[0] * o[1];
+		for (int j = 0; j < nc; ++j)
+		{
+			accI += c[1 + j] * (e[2 * (nc - 1 - j)] + e[2 * (nc + j)]);
+			accQ += c[1 + j] * (e[2 * (nc - 1 - j) + 1] + e[2 * (nc + j) + 1]);
+		}
+		y[2 * m] = accI;
+		y[2 * m + 1] = accQ;
+	}
+}
+
+template <int NCOEF>
+CONV_TARGET_SSE2
+static void halfband_decim_sse(const float * x, int nOut, const float * c, int ncoef, float * y)
+{
+	const int nc = NCOEF ? NCOEF : ncoef;
+	float even[2 * (HALFBAND_BLOCK + 2 * HALFBAND_MAX_NCOEF)];
+	float odd[2 * (HALFBAND_BLOCK + 2 * HALFBAND_MAX_NCOEF)];
+	__m128 cc[1 + HALFBAND_MAX_NCOEF];
+	for (int j = 0; j <= nc; ++j)
+		cc[j] = _mm_set1_ps(c[j]);
+
+	for (int m0 = 0; m0 < nOut; m0 += HALFBAND_BLOCK)
+	{
+		const int nb = (nOut - m0 < HALFBAND_BLOCK) ? (nOut - m0) : HALFBAND_BLOCK;
+		halfband_split_sse(x + 4 * m0, nb, nc, even, odd);
+		float * yb = y + 2 * m0;
+
+		// 4 complex outputs in 2 registers
+		int m = 0;
+		for (; m + 4 <= nb; m += 4)
+		{
+			const float * e = even + 2 * m;
+			const float * o = odd + 2 * (m + nc - 1);
+			__m128 acc0 = _mm_mul_ps(cc[0], _mm_loadu_ps(o));
+			__m128 acc1 = _mm_mul_ps(cc[0], _mm_loadu_ps(o + 4));
+			for (int j = 0; j < nc; ++j)
+			{
+				const float * lo = e + 2 * (nc - 1 - j);
+				const float * hi = e + 2 * (nc + j);
+				acc0 = _mm_add_ps(acc0, _mm_mul_ps(cc[1 + j], _mm_add_ps(_mm_loadu_ps(lo), _mm_loadu_ps(hi))));
+				acc1 = _mm_add_ps(acc1, _mm_mul_ps(cc[1 + j], _mm_add_ps(_mm_loadu_ps(lo + 4), _mm_loadu_ps(hi + 4))));
+			}
+			_mm_storeu_ps(yb + 2 * m, acc0);
+			_mm_storeu_ps(yb + 2 * m + 4, acc1);
+		}
+		halfband_phases_scalar(even, odd, m, nb, nc, c, yb);
+	}
+}
+
+// 8 complex outputs in 2 registers: twice the SSE2 width
+template <int NCOEF>
+CONV_TARGET_AVX2
+static void halfband_decim_avx2(const float * x, int nOut, const float * c, int ncoef, float * y)
+{
+	const int nc = NCOEF ? NCOEF : ncoef;
+	float even[2 * (HALFBAND_BLOCK + 2 * HALFBAND_MAX_NCOEF)];
+	float odd[2 * (HALFBAND_BLOCK + 2 * HALFBAND_MAX_NCOEF)];
+	__m256 cc[1 + HALFBAND_MAX_NCOEF];
+	for (int j = 0; j <= nc; ++j)
+		cc[j] = _mm256_set1_ps(c[j]);
+
+	for (int m0 = 0; m0 < nOut; m0 += HALFBAND_BLOCK)
+	{
+		const int nb = (nOut - m0 < HALFBAND_BLOCK) ? (nOut - m0) : HALFBAND_BLOCK;
+		halfband_split_avx2(x + 4 * m0, nb, nc, even, odd);
+		float * yb = y + 2 * m0;
+
+		int m = 0;
+		for (; m + 8 <= nb; m += 8)
+		{
+			const float * e = even + 2 * m;
+			const float * o = odd + 2 * (m + nc - 1);
+			__m256 acc0 = _mm256_mul_ps(cc[0], _mm256_loadu_ps(o));
+			__m256 acc1 = _mm256_mul_ps(cc[0], _mm256_loadu_ps(o + 8));
+			for (int j = 0; j < nc; ++j)
+			{
+				const float * lo = e + 2 * (nc - 1 - j);
+				const float * hi = e + 2 * (nc + j);
+				acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(cc[1 + j], _mm256_add_ps(_mm256_loadu_ps(lo), _mm256_loadu_ps(hi))));
+				acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(cc[1 + j], _mm256_add_ps(_mm256_loadu_ps(lo + 8), _mm256_loadu_ps(hi + 8))));
+			}
+			_mm256_storeu_ps(yb + 2 * m, acc0);
+			_mm256_storeu_ps(yb + 2 * m + 8, acc1);
+		}
+		halfband_phases_scalar(even, odd, m, nb, nc, c, yb);
+	}
+	_mm256_zeroupper();
+}
+
+template <int FACTOR, int TAPS>
+CONV_TARGET_SSE2
+static void fir_decim_sse(const float * x, int nOut, int factor, const float * hh, int taps, float * y)
+{
+	const int f = FACTOR ? FACTOR : factor;
+	const int nt = TAPS ? TAPS : taps;
+	for (int m = 0; m < nOut; ++m)
+	{
+		const float * xm = x + 2 * f * m;
+		__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+		int k = 0;
+		for (; k + 4 <= nt; k += 4)
+		{
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(hh + 2 * k), _mm_loadu_ps(xm + 2 * k)));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(hh + 2 * k + 4), _mm_loadu_ps(xm + 2 * k + 4)));
+		}
+		for (; k < nt; k += 2)
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(hh + 2 * k), _mm_loadu_ps(xm + 2 * k)));
+		acc0 = _mm_add_ps(acc0, acc1);
+		acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+		_mm_storel_pi((__m64 *)y, acc0);
+		y += 2;
+	}
+}
+
+// 4 complex taps per vector: twice the SSE2 width
+template <int FACTOR, int TAPS>
+CONV_TARGET_AVX2
+static void fir_decim_avx2(const float * x, int nOut, int factor, const float * hh, int taps, float * y)
+{
+	const int f = FACTOR ? FACTOR : factor;
+	const int nt = TAPS ? TAPS : taps;
+	for (int m = 0; m < nOut; ++m)
+	{
+		const float * xm = x + 2 * f * m;
+		__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+		int k = 0;
+		for (; k + 8 <= nt; k += 8)
+		{
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(hh + 2 * k), _mm256_loadu_ps(xm + 2 * k)));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(hh + 2 * k + 8), _mm256_loadu_ps(xm + 2 * k + 8)));
+		}
+		for (; k + 4 <= nt; k += 4)
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(hh + 2 * k), _mm256_loadu_ps(xm + 2 * k)));
+		acc0 = _mm256_add_ps(acc0, acc1);
+		__m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+		for (; k < nt; k += 2)
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(hh + 2 * k), _mm_loadu_ps(xm + 2 * k)));
+		acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+		_mm_storel_pi((__m64 *)y, acc);
+		y += 2;
+	}
+	_mm256_zeroupper();
+}
+
+#endif
+
+
+/*
+ * dispatch tables: ordered from slowest to fastest, 0 in ncoef/factor/taps matches
+ * any length (generic). the last supported match wins - see select_kernel() in convert.cpp
+ */
+struct halfband_kernel
+{
+	int ncoef;
+	int required_cpu;
+	halfband_decim_fn fn;
+};
+
+struct fir_kernel
+{
+	int factor;
+	int taps;
+	int required_cpu;
+	fir_decim_fn fn;
+};
+
+// halfband taps 7, 15, 23, 31
+#define HALFBAND_KERNELS(NAME, CPU) \
+	, { 2, CPU, NAME<2> } \
+	, { 4, CPU, NAME<4> } \
+	, { 6, CPU, NAME<6> } \
+	, { 8, CPU, NAME<8> }
+
+// factor 1: real to complex halfbands (see initRealHalfband). 3, 5: odd parts of the offered decimations
+#define FIR_KERNELS(NAME, CPU) \
+	, { 1, 8, CPU, NAME<1, 8> } \
+	, { 1, 16, CPU, NAME<1, 16> } \
+	, { 3, 3 * FIR_TAPS_PER_PHASE, CPU, NAME<3, 3 * FIR_TAPS_PER_PHASE> } \
+	, { 5, 5 * FIR_TAPS_PER_PHASE, CPU, NAME<5, 5 * FIR_TAPS_PER_PHASE> }
+
+static const halfband_kernel halfband_kernels[] =
+{
+	  { 0, 0, halfband_decim_scalar<0> }
+	HALFBAND_KERNELS(halfband_decim_scalar, 0)
+#if CONV_HAVE_X86
+	, { 0, CONV_CPU_SSE2, halfband_decim_sse<0> }
+	HALFBAND_KERNELS(halfband_decim_sse, CONV_CPU_SSE2)
+	, { 0, CONV_CPU_AVX2, halfband_decim_avx2<0> }
+	HALFBAND_KERNELS(halfband_decim_avx2, CONV_CPU_AVX2)
+#endif
+	, { -1, 0, 0 }
+};
+
+static const fir_kernel fir_kernels[] =
+{
+	  { 0, 0, 0, fir_decim_scalar<0, 0> }
+	FIR_KERNELS(fir_decim_scalar, 0)
+#if CONV_HAVE_X86
+	, { 0, 0, CONV_CPU_SSE2, fir_decim_sse<0, 0> }
+	FIR_KERNELS(fir_decim_sse, CONV_CPU_SSE2)
+	, { 0, 0, CONV_CPU_AVX2, fir_decim_avx2<0, 0> }
+	FIR_KERNELS(fir_decim_avx2, CONV_CPU_AVX2)
+#endif
+	, { -1, 0, 0, 0 }
+};
+
+static int decim_features = -1;		// -1: all of the CPU
+
+void decim_set_cpu_features(int features)
+{
+	decim_features = features;
+}
+
+int decim_cpu_features()
+{
+	return (decim_features < 0) ? conv_cpu_features() : (decim_features & conv_cpu_features());
+}
+
+static halfband_decim_fn select_halfband(int ncoef)
+{
+	const int features = decim_cpu_features();
+	halfband_decim_fn best = halfband_kernels[0].fn;
+	for (int k = 0; halfband_kernels[k].fn; ++k)
+	{
+		const halfband_kernel & e = halfband_kernels[k];
+		if ((e.ncoef == 0 || e.ncoef == ncoef) && (e.required_cpu & features) == e.required_cpu
+			&& (e.required_cpu == 0 || ncoef <= HALFBAND_MAX_NCOEF))
+			best = e.fn;
+	}
+	return best;
+}
+
+static fir_decim_fn select_fir(int factor, int taps)
+{
+	const int features = decim_cpu_features();
+	fir_decim_fn best = fir_kernels[0].fn;
+	for (int k = 0; fir_kernels[k].fn; ++k)
+	{
+		const fir_kernel & e = fir_kernels[k];
+		if (((e.factor == 0 && e.taps == 0) || (e.factor == factor && e.taps == taps))
+			&& (e.required_cpu & features) == e.required_cpu)
+			best = e.fn;
+	}
+	return best;
+}
+
+
+void fir_complex_dot(const float * x, const float * hh, int taps, float * y)
+{
+	// follows decim_set_cpu_features(): the resampler keeps no kernel of its own
+	static fir_decim_fn fn = 0;
+	static int fnFeatures = -2;
+	if (fnFeatures != decim_features)
+	{
+		fn = select_fir(0, 0);
+		fnFeatures = decim_features;
+	}
+	fn(x, 1, 1, hh, taps, y);
+}
+
+
+FilterInput::FilterInput()
+	: m_start(0)
+	, m_count(0)
+{
+}
+
+void FilterInput::reset(int history)
+{
+	m_buf.assign(2 * (size_t)history, 0.0F);
+	m_start = 0;
+	m_count = history;
+}
+
+float * FilterInput::inputPtr(int n)
+{
+	if (2 * (size_t)(m_start + m_count + n) > m_buf.size())
+	{
+		// room for two blocks of this size: the history moves every other block at most
+		const size_t room = 2 * 2 * (size_t)(m_count + n);
+		if (m_buf.size() < room)
+			m_buf.resize(room, 0.0F);
+		if (2 * (size_t)(m_start + m_count + n) > m_buf.size())
+		{
+			memmove(&m_buf[0], &m_buf[2 * (size_t)m_start], 2 * (size_t)m_count * sizeof(float));
+			m_start = 0;
+		}
+	}
+	return &m_buf[2 * (size_t)(m_start + m_count)];
+}
+
+
+DecimStage::DecimStage()
+	: m_halfband(false)
+	, m_halfbandFn(0)
+	, m_firFn(0)
+	, m_factor(1)
+	, m_taps(1)
+{
+}
+
+void DecimStage::initHalfband(int taps)
+{
+	// taps = 4 * ncoef - 1  with even ncoef
+	std::vector<float> h(taps);
+	fir_design_lowpass(&h[0], taps, 0.25, KAISER_BETA);
+	const int ncoef = (taps + 1) / 4;
+	const int center = (taps - 1) / 2;
+	m_coef.resize(1 + ncoef);
+	m_coef[0] = h[center];
+	for (int j = 0; j < ncoef; ++j)
+		m_coef[1 + j] = h[center + 2 * j + 1];
+	m_halfband = true;
+	m_factor = 2;
+	m_taps = taps;
+	reset();
+}
+
+void DecimStage::initSum(int length, int factor)
+{
+	// even number of taps for the kernels: a zero tap in front keeps the sum in place
+	const int taps = (length + 1) & ~1;
+	m_coef.assign(2 * taps, 1.0F);
+	if (taps > length)
+		m_coef[0] = m_coef[1] = 0.0F;
+	m_halfband = false;
+	m_factor = factor;
+	m_taps = taps;
+	reset();
+}
+
+void DecimStage::initFir(int factor, int taps)
+{
+	taps = (taps + 1) & ~1;
+	std::vector<float> h(taps);
+	fir_design_lowpass(&h[0], taps, 0.5 / factor, KAISER_BETA);
+	m_coef.resize(2 * taps);
+	for (int k = 0; k < taps; ++k)
+		m_coef[2 * k] = m_coef[2 * k + 1] = h[k];
+	m_halfband = false;
+	m_factor = factor;
+	m_taps = taps;
+	reset();
+}
+
+void DecimStage::initRealHalfband(int taps)
+{
+	// h[center] falls on the odd sample of pair (center - 1) / 2: center is odd for taps = 4 * n - 1
+	std::vector<float> h(taps);
+	fir_design_lowpass(&h[0], taps, 0.25, KAISER_BETA);
+	const int center = (taps - 1) / 2;
+	const int pairs = (taps + 1) / 2;
+	m_coef.assign(2 * pairs, 0.0F);
+	for (int k = 0; k < pairs; ++k)
+		m_coef[2 * k] = h[2 * k];
+	// odd samples were shifted by -j: the center tap lands on Q, with sign
+	m_coef[center] = -h[center];
+	m_halfband = false;
+	m_factor = 1;
+	m_taps = pairs;
+	reset();
+}
+
+void DecimStage::reset()
+{
+	if (m_halfband)
+		m_halfbandFn = select_halfband((int)m_coef.size() - 1);
+	else
+		m_firFn = select_fir(m_factor, m_taps);
+
+	// zero history of taps - 1 samples
+	m_buf.reset(m_taps - 1);
+}
+
+float * DecimStage::inputPtr(int n)
+{
+	return m_buf.inputPtr(n);
+}
+
+int DecimStage::run(int n, float * out)
+{
+	m_buf.commit(n);
+	const int count = m_buf.count();
+	const int nOut = (count >= m_taps) ? ((count - m_taps) / m_factor + 1) : 0;
+	if (nOut > 0)
+	{
+		const float * x = m_buf.data();
+		if (m_halfband)
+			m_halfbandFn(x, nOut, &m_coef[0], (int)m_coef.size() - 1, out);
+		else
+			m_firFn(x, nOut, m_factor, &m_coef[0], m_taps, out);
+
+		// the unconsumed tail stays as history for the next block
+		m_buf.consume(nOut * m_factor);
+	}
+	return nOut;
+}
+
+
+Decimator::Decimator()
+	: m_factor(1)
+	, m_input(DECIM_INPUT_IQ)
+	, m_filter(DECIM_FILTER_HALFBAND)
+	, m_quarter(0)
+	, m_scale(1.0F)
+{
+}
+
+bool Decimator::configure(int decimation, int input, int filter)
+{
+	if (decimation < 1 || (filter != DECIM_FILTER_HALFBAND && decimation > DECIM_SUM_MAX_FACTOR))
+		return false;
+	const bool real = (input == DECIM_INPUT_REAL_I || input == DECIM_INPUT_REAL_Q);
+	m_input = real ? input : DECIM_INPUT_IQ;
+	m_filter = filter;
+	m_quarter = 0;
+
+	if (filter != DECIM_FILTER_HALFBAND)
+	{
+		// one stage: sum of 'decimation' pairs, behind the real to complex halfband
+		const bool moving = (filter == DECIM_FILTER_MOVING_SUM);
+		const int first = real ? 1 : 0;
+		m_stages.clear();
+		m_stages.resize(first + ((decimation > 1) ? 1 : 0));
+		if (real)
+			m_stages[0].initRealHalfband((decimation == 1) ? HALFBAND_TAPS_SHARP : HALFBAND_TAPS_RELAXED);
+		if (decimation > 1)
+			m_stages[first].initSum(decimation, moving ? 1 : decimation);
+		m_factor = (real ? 2 : 1) * (moving ? 1 : decimation);
+		return true;
+	}
+
+	int halfbands = 0;
+	int odd = decimation;
+	while ((odd & 1) == 0)
+	{
+		odd >>= 1;
+		++halfbands;
+	}
+
+	m_stages.clear();
+	const int first = real ? 1 : 0;
+	m_stages.resize(first + halfbands + ((odd > 1) ? 1 : 0));
+	if (real)
+		m_stages[0].initRealHalfband((decimation == 1) ? HALFBAND_TAPS_SHARP : HALFBAND_TAPS_RELAXED);
+	for (int k = 0; k < halfbands; ++k)
+	{
+		// only the last stage needs the sharp transition - if no FIR follows
+		const bool last = (k == halfbands - 1) && (odd == 1);
+		m_stages[first + k].initHalfband(last ? HALFBAND_TAPS_SHARP : HALFBAND_TAPS_RELAXED);
+	}
+	if (odd > 1)
+		m_stages[first + halfbands].initFir(odd, FIR_TAPS_PER_PHASE * odd);
+
+	m_factor = real ? 2 * decimation : decimation;
+	return true;
+}
+
+void Decimator::reset()
+{
+	for (size_t k = 0; k < m_stages.size(); ++k)
+		m_stages[k].reset();
+	m_quarter = 0;
+}
+
+int Decimator::process(const uint8_t * iq, int nPairs, float * out, Nco * nco, IqCorrector * corr)
+{
+	// convert directly behind the first stage's history
+	int n = nPairs;
+	if (m_input != DECIM_INPUT_IQ)
+	{
+		// two real samples per pair: blocks have even length. 2 * scale for the
+		// level of a real sine, which splits into positive and negative frequency
+		n = nPairs / 2;
+		conv_u8_real_f32(iq, m_stages[0].inputPtr(n), 2 * n, m_input - DECIM_INPUT_REAL_I, 2.0F * m_scale, m_quarter);
+		m_quarter = (m_quarter + 2 * n) & 3;
+	}
+	else
+	{
+		float * x = m_stages.empty() ? out : m_stages[0].inputPtr(nPairs);
+		iq_input(iq, x, nPairs, m_scale, corr, nco);
+		if (m_stages.empty())
+			return nPairs;
+	}
+
+	const size_t last = m_stages.size() - 1;
+	for (size_t k = 0; k < last && n > 0; ++k)
+	{
+		// upper bound for the outputs: next stage's buffer gets them directly
+		const int maxOut = n / m_stages[k].factor() + 1;
+		float * next = m_stages[k + 1].inputPtr(maxOut);
+		n = m_stages[k].run(n, next);
+	}
+	if (n <= 0)
+		return 0;
+	return m_stages[last].run(n, out);
+}
+
+
+/*
+ * sums of FACTOR pairs, one after the other. as the kernels above: the constant
+ * length lets the compiler unroll and vectorize, 0 takes the runtime factor
+ */
+template <int FACTOR>
+static void sum_pairs(const uint8_t * x, int nOut, int factor, int16_t * y)
+{
+	const int f = FACTOR ? FACTOR : factor;
+	for (int m = 0; m < nOut; ++m)
+	{
+		int sI = 0, sQ = 0;
+		for (int k = 0; k < f; ++k)
+		{
+			sI += x[2 * k];
+			sQ += x[2 * k + 1];
+		}
+		*y++ = (int16_t)(sI - 128 * f);
+		*y++ = (int16_t)(sQ - 128 * f);
+		x += 2 * f;
+	}
+}
+
+// the factors of the decimation dialog below the CIC
+static void sum_pairs_any(const uint8_t * x, int nOut, int factor, int16_t * y)
+{
+	switch (factor)
+	{
+	case 2:		sum_pairs<2>(x, nOut, factor, y);	break;
+	case 3:		sum_pairs<3>(x, nOut, factor, y);	break;
+	case 4:		sum_pairs<4>(x, nOut, factor, y);	break;
+	case 5:		sum_pairs<5>(x, nOut, factor, y);	break;
+	case 6:		sum_pairs<6>(x, nOut, factor, y);	break;
+	case 8:		sum_pairs<8>(x, nOut, factor, y);	break;
+	case 10:	sum_pairs<10>(x, nOut, factor, y);	break;
+	case 12:	sum_pairs<12>(x, nOut, factor, y);	break;
+	default:	sum_pairs<0>(x, nOut, factor, y);	break;
+	}
+}
+
+
+SumDecimator::SumDecimator()
+	: m_factor(1)
+	, m_moving(false)
+	, m_partialPairs(0)
+	, m_histPos(0)
+{
+	m_partial[0] = m_partial[1] = 0;
+}
+
+bool SumDecimator::configure(int factor, bool moving)
+{
+	if (factor < 1 || factor > DECIM_SUM_MAX_FACTOR)
+		return false;
+	m_factor = factor;
+	m_moving = moving;
+	reset();
+	return true;
+}
+
+void SumDecimator::reset()
+{
+	// history of factor - 1 zero pairs: the first sum ends with the first pair, as the FIR does
+	m_partialPairs = m_factor - 1;
+	m_partial[0] = m_partial[1] = 128 * m_partialPairs;
+	m_hist.assign(2 * (size_t)m_partialPairs, 128);
+	m_histPos = 0;
+}
+
+int SumDecimator::process(const uint8_t * iq, int nPairs, int16_t * out)
+{
+	const int f = m_factor;
+	const int bias = 128 * f;
+	if (m_moving)
+	{
+		// the window of the next output without its newest pair: the last f - 1 pairs
+		const int hist = f - 1;
+		int sI = m_partial[0], sQ = m_partial[1];
+		int k = 0;
+		for (; k < nPairs && k < hist; ++k)
+		{
+			// the oldest pair still comes from the history
+			const uint8_t * old = &m_hist[2 * ((m_histPos + k) % hist)];
+			sI += iq[2 * k];
+			sQ += iq[2 * k + 1];
+			*out++ = (int16_t)(sI - bias);
+			*out++ = (int16_t)(sQ - bias);
+			sI -= old[0];
+			sQ -= old[1];
+		}
+		for (; k < nPairs; ++k)
+		{
+			sI += iq[2 * k];
+			sQ += iq[2 * k + 1];
+			*out++ = (int16_t)(sI - bias);
+			*out++ = (int16_t)(sQ - bias);
+			sI -= iq[2 * (k - hist)];
+			sQ -= iq[2 * (k - hist) + 1];
+		}
+		m_partial[0] = sI;
+		m_partial[1] = sQ;
+
+		// the newest pairs replace the oldest of the history
+		if (nPairs >= hist)
+		{
+			if (hist > 0)
+				memcpy(&m_hist[0], iq + 2 * (nPairs - hist), 2 * hist);
+			m_histPos = 0;
+		}
+		else
+		{
+			for (k = 0; k < nPairs; ++k)
+			{
+				m_hist[2 * m_histPos] = iq[2 * k];
+				m_hist[2 * m_histPos + 1] = iq[2 * k + 1];
+				m_histPos = (m_histPos + 1) % hist;
+			}
+		}
+		return nPairs;
+	}
+
+	int nOut = 0;
+	int k = 0;
+	if (m_partialPairs > 0)
+	{
+		// complete the sum begun in an earlier block
+		for (; k < nPairs && m_partialPairs < f; ++k, ++m_partialPairs)
+		{
+			m_partial[0] += iq[2 * k];
+			m_partial[1] += iq[2 * k + 1];
+		}
+		if (m_partialPairs < f)
+			return 0;
+		out[0] = (int16_t)(m_partial[0] - bias);
+		out[1] = (int16_t)(m_partial[1] - bias);
+		nOut = 1;
+	}
+
+	// the sums inside the block - directly
+	const int n = (nPairs - k) / f;
+	sum_pairs_any(iq + 2 * k, n, f, out + 2 * nOut);
+	nOut += n;
+	k += n * f;
+
+	// the rest begins the next sum
+	m_partial[0] = m_partial[1] = 0;
+	m_partialPairs = nPairs - k;
+	for (; k < nPairs; ++k)
+	{
+		m_partial[0] += iq[2 * k];
+		m_partial[1] += iq[2 * k + 1];
+	}
+	return nOut;
+}
@@ -0,0 +1,204 @@
+/*
+ * decimation filters for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class Nco;
+class IqCorrector;
+
+// decimator input: complex I/Q - or the real samples of one channel (direct sampling pin I / Q)
+#define DECIM_INPUT_IQ		0
+#define DECIM_INPUT_REAL_I	1
+#define DECIM_INPUT_REAL_Q	2
+
+// filter of the decimations below the CIC: halfband cascade and polyphase FIR - or the former
+// sum of 'decimation' pairs, cheapest but aliasing: the box filter's sidelobes are only -13 dB.
+// the moving sum only filters, with output at the input rate (FULL_DECIMATION 0)
+#define DECIM_FILTER_HALFBAND		0
+#define DECIM_FILTER_SUM			1
+#define DECIM_FILTER_MOVING_SUM		2
+
+// longest sum: 8 bit samples still fit into 16 bit
+#define DECIM_SUM_MAX_FACTOR	256
+
+// windowed sinc (kaiser) lowpass with DC gain 1
+//   cutoff: -6 dB frequency relative to samplerate, 0 < cutoff < 0.5
+void fir_design_lowpass(float * h, int taps, double cutoff, double kaiserBeta);
+
+// decimation kernels, x: first complex input of the first output's window.
+// c[0]: center tap; c[1 + j]: ncoef (even) coefficients for the odd offsets 1, 3, 5, .. around the center
+typedef void (*halfband_decim_fn)(const float * x, int nOut, const float * c, int ncoef, float * y);
+// hh[]: coefficients duplicated for I and Q: h0 h0 h1 h1 ..; taps even
+typedef void (*fir_decim_fn)(const float * x, int nOut, int factor, const float * hh, int taps, float * y);
+
+// limits the decimation kernels to these CONV_CPU_* features - for the autotuner.
+// stages pick their kernels on init and reset(), fir_complex_dot() on its next call
+void decim_set_cpu_features(int features);
+int decim_cpu_features();
+
+// y = sum over k of hh[2k] * x[k] for one complex output; hh[] as in DecimStage: h0 h0 h1 h1 ..; taps even
+void fir_complex_dot(const float * x, const float * hh, int taps, float * y);
+
+
+/*
+ * input buffer of a filter stage, interleaved complex float. new samples are
+ * written behind the filter history, and the window slides on along the buffer
+ * as the outputs consume samples: the history stays where it is. only when the
+ * window reaches the end of the buffer - room for two blocks - the history,
+ * shorter than the filter, moves back to the front: every other block at most.
+ */
+class FilterInput
+{
+public:
+	FilterInput();
+
+	// history of n zero samples
+	void reset(int history);
+
+	// pointer to space for n complex samples behind the buffered ones
+	float * inputPtr(int n);
+	// n samples were written to inputPtr()
+	void commit(int n) { m_count += n; }
+
+	// the buffered samples - from the oldest of the history on
+	const float * data() const { return &m_buf[2 * (size_t)m_start]; }
+	int count() const { return m_count; }
+	// the first n samples are no longer needed
+	void consume(int n) { m_start += n; m_count -= n; }
+
+private:
+	std::vector<float> m_buf;
+	int m_start;		// first buffered complex sample
+	int m_count;		// buffered complex samples
+};
+
+
+/*
+ * one decimation stage on interleaved complex float samples.
+ * the stage owns its input buffer: new samples are written behind the
+ * filter history (inputPtr()), so a network block is filtered where it
+ * was converted, and the history is not copied - see FilterInput.
+ */
+class DecimStage
+{
+public:
+	DecimStage();
+
+	// halfband filter decimating by 2. taps has to be one of 7, 15, 23, 31
+	void initHalfband(int taps);
+	// sum of the last length samples - every factor-th: a FIR with coefficients 1
+	void initSum(int length, int factor);
+	// polyphase FIR decimating by factor
+	void initFir(int factor, int taps);
+	// real to complex: real samples, shifted by -fs/4 and stored as pairs (even, odd), through a
+	// halfband of taps (see initHalfband). its I part needs the even samples, Q only the center tap:
+	// runs as FIR with factor 1 on the pairs - complex output at half the real samplerate
+	void initRealHalfband(int taps);
+
+	// also selects the kernel again
+	void reset();
+	int factor() const { return m_factor; }
+
+	// pointer to space for n complex samples - behind the history
+	float * inputPtr(int n);
+	// filter/decimate the n samples just written to inputPtr(). returns number of complex outputs
+	int run(int n, float * out);
+
+private:
+	bool m_halfband;
+	halfband_decim_fn m_halfbandFn;		// specialized for the length - when available
+	fir_decim_fn m_firFn;
+	int m_factor;
+	int m_taps;
+	std::vector<float> m_coef;	// halfband: center + unique odd-offset coefficients; fir: coefficient pairs expanded for SIMD
+	FilterInput m_buf;			// history + new input
+};
+
+
+/*
+ * cascade of halfband stages for the power-of-two part of the decimation
+ * followed by a polyphase FIR stage for the remaining odd factor.
+ * input are the raw unsigned 8 bit I/Q samples from rtl_tcp,
+ * output is interleaved complex float, scaled by setScale().
+ * with real input, a real to complex halfband stage runs first: the
+ * band 0 .. fs/2 of the channel comes out as complex, centered on fs/4.
+ */
+class Decimator
+{
+public:
+	Decimator();
+
+	// real input (DECIM_INPUT_REAL_*) decimates by 2 * decimation in total.
+	// the sum filters (DECIM_FILTER_*) have the gain of the decimation
+	bool configure(int decimation, int input = DECIM_INPUT_IQ, int filter = DECIM_FILTER_HALFBAND);
+	int factor() const { return m_factor; }
+	int input() const { return m_input; }
+	int filter() const { return m_filter; }
+	void reset();
+
+	// output = (input - 128) * scale
+	void setScale(float scale) { m_scale = scale; }
+
+	// returns number of complex output samples written to out.
+	// an active corrector and nco correct and shift the input before filtering - not with real input
+	int process(const uint8_t * iq, int nPairs, float * out, Nco * nco = 0, IqCorrector * corr = 0);
+
+private:
+	std::vector<DecimStage> m_stages;
+	int m_factor;
+	int m_input;
+	int m_filter;
+	int m_quarter;		// real input: sample count modulo 4 for the fs/4 shift
+	float m_scale;
+};
+
+
+/*
+ * the former decimation in integer arithmetic: sums of 'factor' raw I/Q pairs
+ * as 16 bit, for the cheapest 16 bit output - without shift or correction.
+ * no pairs get copied for the next block: a sum left incomplete at the block
+ * end is kept as partial sum. the moving sum advances by adding the new pair
+ * and subtracting the oldest, which it takes from a circular history of the
+ * last factor - 1 pairs. the output is the same as of a Decimator with the
+ * sum filter and scale 1, which does shift and correct.
+ */
+class SumDecimator
+{
+public:
+	SumDecimator();
+
+	// moving: the sum advances by one pair - filter only, output at the input rate
+	bool configure(int factor, bool moving = false);
+	int factor() const { return m_factor; }
+	bool moving() const { return m_moving; }
+	void reset();
+
+	// returns number of complex outputs written to out: nPairs / factor (+1), or nPairs when moving
+	int process(const uint8_t * iq, int nPairs, int16_t * out);
+
+private:
+	int m_factor;
+	bool m_moving;
+	int m_partial[2];				// raw sums of I and Q over the pairs of the next sum - or of the moving window
+	int m_partialPairs;				// pairs in m_partial
+	std::vector<uint8_t> m_hist;	// moving sum: the last factor - 1 pairs, circular
+	int m_histPos;					// oldest pair in m_hist
+};
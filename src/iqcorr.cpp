@@ -0,0 +1,187 @@
+/*
+ * DC offset and I/Q imbalance correction for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "iqcorr.h"
+#include "convert.h"
+#include "nco.h"
+
+#include <Windows.h>
+
+#include <math.h>
+#include <string.h>
+
+
+// time constant of the recursive estimates in estimated I/Q pairs: ~ 0.6 sec at 3.2 Msps
+#define IQCORR_AVERAGE_PAIRS	( 1 << 15 )
+// estimation from a share of each block: runs of pairs at this stride
+#define IQCORR_ESTIMATE_RUN		128
+#define IQCORR_ESTIMATE_STRIDE	8192
+// the plain conversion is timed as reference on every n-th block
+#define IQCORR_REFERENCE_BLOCKS	64
+// limits of the correction - within the fixed point range of the SIMD kernels
+#define IQCORR_MAX_SIN			0.5		// phase: sin(30 deg)
+#define IQCORR_MAX_GAIN			1.9
+#define IQCORR_MAX_DC			100.0
+
+
+IqCorrector::IqCorrector()
+	: m_mode(IQCORR_OFF)
+{
+	reset();
+	resetCost();
+}
+
+void IqCorrector::setMode(int mode)
+{
+	if (mode == m_mode)
+		return;
+	m_mode = mode;
+	reset();
+}
+
+void IqCorrector::reset()
+{
+	m_valid = false;
+	memset(m_mean, 0, sizeof(m_mean));
+	m_coef[0] = m_coef[1] = 0.0F;
+	m_coef[2] = 1.0F;
+	m_coef[3] = 0.0F;
+}
+
+void IqCorrector::resetCost()
+{
+	m_estimateTicks = 0;
+	m_correctTicks = 0;
+	m_referenceTicks = 0;
+	m_blocks = 0;
+	m_measuredBlocks = 0;
+	m_referenceBlocks = 0;
+}
+
+double IqCorrector::costPercent() const
+{
+	if (!m_measuredBlocks || !m_referenceBlocks || !m_referenceTicks)
+		return 0.0;
+	const double reference = (double)m_referenceTicks / m_referenceBlocks;
+	const double used = (double)(m_estimateTicks + m_correctTicks) / m_measuredBlocks;
+	return 100.0 * (used - reference) / reference;
+}
+
+double IqCorrector::gainRatio() const
+{
+	const double PI = m_mean[2] - m_mean[0] * m_mean[0];
+	const double PQ = m_mean[3] - m_mean[1] * m_mean[1];
+	return (PI > 0.0) ? sqrt(PQ / PI) : 1.0;
+}
+
+double IqCorrector::phaseDegrees() const
+{
+	// b = -tan(phase)
+	return -atan((double)m_coef[3]) * 180.0 / 3.14159265358979323846;
+}
+
+void IqCorrector::convert(const uint8_t * iq, float * out, int nPairs, float scale)
+{
+	LARGE_INTEGER t0, t1, t2;
+	const bool reference = (m_blocks++ % IQCORR_REFERENCE_BLOCKS == 0);
+	if (reference)
+	{
+		// cost reference: gets overwritten below - which is not timed, having out in the cache
+		QueryPerformanceCounter(&t0);
+		conv_u8_to_f32(iq, out, 2 * nPairs, scale);
+		QueryPerformanceCounter(&t1);
+		m_referenceTicks += t1.QuadPart - t0.QuadPart;
+		++m_referenceBlocks;
+	}
+
+	QueryPerformanceCounter(&t0);
+	int64_t sums[5] = { 0, 0, 0, 0, 0 };
+	int counted = 0;
+	for (int k = 0; k < nPairs; k += IQCORR_ESTIMATE_STRIDE)
+	{
+		const int n = (nPairs - k < IQCORR_ESTIMATE_RUN) ? (nPairs - k) : IQCORR_ESTIMATE_RUN;
+		conv_u8_iqstats(iq + 2 * k, n, sums);
+		counted += n;
+	}
+	if (counted)
+		update(sums, counted);
+	QueryPerformanceCounter(&t1);
+
+	conv_u8_iqcorr_f32(iq, out, nPairs, scale, m_coef);
+	QueryPerformanceCounter(&t2);
+
+	if (!reference)
+	{
+		m_estimateTicks += t1.QuadPart - t0.QuadPart;
+		m_correctTicks += t2.QuadPart - t1.QuadPart;
+		++m_measuredBlocks;
+	}
+}
+
+void IqCorrector::update(const int64_t * sums, int nPairs)
+{
+	const double alpha = m_valid ? (double)nPairs / ((double)nPairs + IQCORR_AVERAGE_PAIRS) : 1.0;
+	for (int j = 0; j < 5; ++j)
+		m_mean[j] += alpha * ((double)sums[j] / nPairs - m_mean[j]);
+	m_valid = true;
+
+	const double dcI = (fabs(m_mean[0]) < IQCORR_MAX_DC) ? m_mean[0] : 0.0;
+	const double dcQ = (fabs(m_mean[1]) < IQCORR_MAX_DC) ? m_mean[1] : 0.0;
+	double a = 1.0, b = 0.0;
+	if (m_mode == IQCORR_DC_IQ)
+	{
+		// Q = g * (Q0 cos(phi) + I0 sin(phi)): decorrelate from I and equalize the power
+		const double PI = m_mean[2] - dcI * dcI;
+		const double PQ = m_mean[3] - dcQ * dcQ;
+		const double C = m_mean[4] - dcI * dcQ;
+		if (PI > 0.0 && PQ > 0.0)
+		{
+			double s = C / sqrt(PI * PQ);
+			if (s > IQCORR_MAX_SIN)
+				s = IQCORR_MAX_SIN;
+			else if (s < -IQCORR_MAX_SIN)
+				s = -IQCORR_MAX_SIN;
+			const double c = sqrt(1.0 - s * s);
+			a = sqrt(PI / PQ) / c;
+			b = -s / c;
+			if (a > IQCORR_MAX_GAIN || a < 1.0 / IQCORR_MAX_GAIN)
+				a = 1.0;
+		}
+	}
+	m_coef[0] = (float)dcI;
+	m_coef[1] = (float)dcQ;
+	m_coef[2] = (float)a;
+	m_coef[3] = (float)b;
+}
+
+
+void iq_input(const uint8_t * iq, float * out, int nPairs, float scale, IqCorrector * corr, Nco * nco)
+{
+	const bool shift = nco && nco->active();
+	if (corr && corr->mode() != IQCORR_OFF)
+	{
+		// correction before the shift: the DC offset is at the tuner frequency
+		corr->convert(iq, out, nPairs, scale);
+		if (shift)
+			nco->mix(out, out, nPairs);
+	}
+	else if (shift)
+		nco->mix(iq, out, nPairs, scale);
+	else
+		conv_u8_to_f32(iq, out, 2 * nPairs, scale);
+}
@@ -0,0 +1,80 @@
+/*
+ * DC offset and I/Q imbalance correction for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+class Nco;
+
+
+#define IQCORR_OFF		0
+#define IQCORR_DC		1		// DC offset only
+#define IQCORR_DC_IQ	2		// DC offset, gain and phase imbalance
+
+
+/*
+ * removes the drifting DC offset and the I/Q gain/phase imbalance of the
+ * RTL2832 stream. the estimates are block recursive: integer sums over a
+ * share of each block update running averages, then the block is converted
+ * and corrected in one pass. runs on the processing thread.
+ */
+class IqCorrector
+{
+public:
+	IqCorrector();
+
+	// a changed mode restarts the estimation
+	void setMode(int mode);
+	int mode() const { return m_mode; }
+	void reset();
+
+	// raw unsigned 8 bit I/Q to complex float: (in - 128) * scale, then corrected
+	void convert(const uint8_t * iq, float * out, int nPairs, float scale);
+
+	// estimates in raw sample units
+	double dcI() const { return m_coef[0]; }
+	double dcQ() const { return m_coef[1]; }
+	double gainRatio() const;		// Q / I amplitude
+	double phaseDegrees() const;	// deviation from 90 degrees
+
+	// cost since resetCost(): estimation and corrected conversion against a plain
+	// conversion, which is timed on some blocks - in percent of the plain conversion
+	double costPercent() const;
+	unsigned blocks() const { return m_blocks; }
+	void resetCost();
+
+private:
+	void update(const int64_t * sums, int nPairs);
+
+	int m_mode;
+	bool m_valid;
+	double m_mean[5];		// recursive averages of I, Q, I*I, Q*Q, I*Q
+	float m_coef[4];		// dcI, dcQ, a, b - see conv_u8_iqcorr_f32_fn
+	int64_t m_estimateTicks;	// QueryPerformanceCounter() ticks
+	int64_t m_correctTicks;
+	int64_t m_referenceTicks;
+	unsigned m_blocks;
+	unsigned m_measuredBlocks;		// blocks in m_estimateTicks, m_correctTicks
+	unsigned m_referenceBlocks;
+};
+
+
+// raw unsigned 8 bit I/Q to complex float for the decimators: (in - 128) * scale,
+// corrected and shifted. corr and nco may be 0 or inactive
+void iq_input(const uint8_t * iq, float * out, int nPairs, float scale, IqCorrector * corr, Nco * nco);
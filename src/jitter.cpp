@@ -0,0 +1,106 @@
+/*
+ * adaptive jitter buffer for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "jitter.h"
+
+#include <algorithm>
+
+
+// delay until the first estimate: 100 ms
+#define JITTER_START_DELAY_DIV	10
+
+
+JitterBuffer::JitterBuffer()
+	: m_dropTarget(0.01)
+	, m_freq(1)
+	, m_start(0)
+	, m_count(0)
+	, m_byteRate(0)
+	, m_baseline(0)
+	, m_delay(0)
+	, m_arrivals(0)
+	, m_late(0)
+{
+}
+
+void JitterBuffer::reset(int byteRate, int64_t tickFreq)
+{
+	const int64_t freq = (tickFreq > 0) ? tickFreq : 1;
+	m_count = 0;
+	// no arrival first: due() stops using the old stream
+	m_arrivals.store(0, std::memory_order_release);
+	m_freq.store(freq, std::memory_order_relaxed);
+	m_start.store(0, std::memory_order_relaxed);
+	m_byteRate.store(byteRate > 0 ? byteRate : 1, std::memory_order_relaxed);
+	m_baseline.store(0, std::memory_order_relaxed);
+	m_delay.store(freq / JITTER_START_DELAY_DIV, std::memory_order_relaxed);
+	m_late.store(0, std::memory_order_relaxed);
+}
+
+int64_t JitterBuffer::streamTicks(uint64_t pos) const
+{
+	return (int64_t)((double)pos * (double)m_freq.load(std::memory_order_relaxed)
+		/ (double)m_byteRate.load(std::memory_order_relaxed));
+}
+
+void JitterBuffer::arrival(int64_t ticks, uint64_t pos)
+{
+	// m_start, m_freq and m_byteRate are published to due() by the release of m_arrivals
+	const unsigned n = m_arrivals.load(std::memory_order_relaxed);
+	if (n == 0)
+		m_start.store(ticks, std::memory_order_relaxed);
+	const int64_t offset = (ticks - m_start.load(std::memory_order_relaxed)) - streamTicks(pos);
+
+	int64_t baseline = m_baseline.load(std::memory_order_relaxed);
+	if (n == 0 || offset < baseline)
+		m_baseline.store(baseline = offset, std::memory_order_release);
+	else if (offset - baseline > m_delay.load(std::memory_order_relaxed))
+		m_late.fetch_add(1, std::memory_order_relaxed);
+
+	m_offset[n % JITTER_WINDOW] = offset;
+	if (m_count < JITTER_WINDOW)
+		++m_count;
+	m_arrivals.store(n + 1, std::memory_order_release);
+	if ((n + 1) % JITTER_UPDATE == 0)
+		estimate();
+}
+
+void JitterBuffer::estimate()
+{
+	int64_t lateness[JITTER_WINDOW];
+	// the baseline follows clock drift: earliest arrival within the window
+	const int64_t baseline = *std::min_element(m_offset, m_offset + m_count);
+	for (int k = 0; k < m_count; ++k)
+		lateness[k] = m_offset[k] - baseline;
+
+	int q = (int)((1.0 - m_dropTarget.load(std::memory_order_relaxed)) * m_count);
+	q = (q >= m_count) ? m_count - 1 : (q < 0) ? 0 : q;
+	std::nth_element(lateness, lateness + q, lateness + m_count);
+	const int64_t wanted = lateness[q];
+
+	const int64_t delay = m_delay.load(std::memory_order_relaxed);
+	m_delay.store((wanted >= delay) ? wanted : delay - (delay - wanted) / 8, std::memory_order_relaxed);
+	m_baseline.store(baseline, std::memory_order_release);
+}
+
+int64_t JitterBuffer::due(uint64_t pos, int64_t maxDelay) const
+{
+	if (m_arrivals.load(std::memory_order_acquire) == 0)
+		return 0;
+	const int64_t d = m_delay.load(std::memory_order_relaxed);
+	return m_start.load(std::memory_order_relaxed) + m_baseline.load(std::memory_order_acquire)
+		+ streamTicks(pos) + ((d < maxDelay) ? d : maxDelay);
+}
@@ -0,0 +1,76 @@
+/*
+ * adaptive jitter buffer for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+
+#define JITTER_WINDOW		512		// arrivals the delay is estimated from
+#define JITTER_UPDATE		32		// arrivals between estimates
+
+
+/*
+ * adaptive playout delay for network blocks.
+ * each arrival is compared against the stream position at the nominal byte rate:
+ * the earliest arrival within the window is the baseline, the lateness of the others
+ * is the jitter. the delay is the smallest lateness exceeded by no more than the
+ * drop target - it grows at once and shrinks slowly.
+ * a block is due at baseline + position / rate + delay; blocks arriving after
+ * that are counted late. reset(), setDropTarget() and arrival() run in the receive
+ * thread, due() and the statistics in the processing thread: what due() reads is
+ * published atomically, as in BlockRing. the offset window and its count belong
+ * to the receive thread alone.
+ */
+class JitterBuffer
+{
+public:
+	JitterBuffer();
+
+	// new stream: nominal bytes per second and ticks per second of the clock
+	void reset(int byteRate, int64_t tickFreq);
+	// fraction of blocks allowed to arrive late
+	void setDropTarget(double fraction) { m_dropTarget.store(fraction, std::memory_order_relaxed); }
+
+	// receive thread: the block ending at stream offset pos arrived at 'ticks'
+	void arrival(int64_t ticks, uint64_t pos);
+
+	// processing thread: time the block ending at pos is due - with the delay limited
+	// to maxDelay ticks. 0 before the first arrival
+	int64_t due(uint64_t pos, int64_t maxDelay) const;
+
+	// statistics - the delay in ticks
+	int64_t delay() const { return m_delay.load(std::memory_order_relaxed); }
+	int byteRate() const { return m_byteRate.load(std::memory_order_relaxed); }
+	unsigned arrivals() const { return m_arrivals.load(std::memory_order_relaxed); }
+	unsigned lateBlocks() const { return m_late.load(std::memory_order_relaxed); }
+
+private:
+	int64_t streamTicks(uint64_t pos) const;
+	void estimate();
+
+	std::atomic<double> m_dropTarget;
+	std::atomic<int64_t> m_freq;
+	std::atomic<int64_t> m_start;		// ticks of the first arrival
+	int64_t m_offset[JITTER_WINDOW];	// arrival - nominal stream time: receive thread only
+	int m_count;						// receive thread only
+	std::atomic<int> m_byteRate;
+	std::atomic<int64_t> m_baseline;	// earliest offset in the window
+	std::atomic<int64_t> m_delay;
+	std::atomic<unsigned> m_arrivals;
+	std::atomic<unsigned> m_late;
+};
@@ -0,0 +1,640 @@
+/*
+ * kernel benchmarks for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "kernelbench.h"
+#include "convert.h"
+#include "decimator.h"
+#include "cic.h"
+#include "resampler.h"
+#include "nco.h"
+#include "iqcorr.h"
+#include "blockpool.h"
+
+#include <Windows.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _MSC_VER
+	#define snprintf  _snprintf
+#endif
+
+
+// minimum time per measurement - and per candidate of the autotuner
+#define BENCH_MILLIS		40
+#define AUTOTUNE_MILLIS		10
+
+static const char * bench_format_names[] = { "float", "int16", "int32", "uint8", "int8" };
+
+// columns of the decimation matrix
+static const int bench_matrix_formats[] = { BENCH_OUT_FLOAT, BENCH_OUT_S8, BENCH_OUT_S16, BENCH_OUT_S32 };
+#define BENCH_MATRIX_FORMATS	4
+
+// the buffers before the ring and the block pool, for any block size: MAX_DECIMATIONS (8) + 2
+// receive blocks of 257 kB and 257 k shorts
+#define BENCH_FORMER_BUFFERS	((8 + 2) * (256 * 1024 + 1024) + (256 * 1024 + 1024) * 2)
+
+// halfband/FIR factors of the decimation dialog - CIC factors are powers of two from CIC_MIN_DECIMATION
+static const int bench_filter_factors[] = { 2, 3, 4, 5, 6, 8, 10, 12 };
+
+
+struct bench_buffers
+{
+	std::vector<uint8_t> iq;
+	std::vector<float> f32;
+	std::vector<int32_t> s32;
+	std::vector<int16_t> s16;
+	std::vector<int8_t> s8;
+};
+
+// output stage of the decimators: int16 through the active kernel, as the DLL delivers it.
+// none for the decimators' own format
+static void bench_output(const float *, float *, int) {}
+static void bench_output(const int32_t *, int32_t *, int) {}
+static void bench_output(const float * in, int16_t * out, int n) { conv_f32_to_s16(in, out, n); }
+static void bench_output(const int32_t * in, int16_t * out, int n) { conv_s32_to_s16(in, out, n); }
+static void bench_output(const int32_t * in, float * out, int n) { conv_s32_to_f32(in, out, n, 1.0F / 2147483648.0F); }
+template <class T> static void bench_output(const float * in, T * out, int n) { conv_f32_to_int(in, out, n); }
+template <class T> static void bench_output(const int32_t * in, T * out, int n) { conv_s32_to_int(in, out, n); }
+
+// runs op() - one block of nPairs - until millis elapsed: returns input Msps
+template <class OP>
+static double bench_msps(OP & op, int nPairs, int millis = BENCH_MILLIS)
+{
+	LARGE_INTEGER freq, t0, t1;
+	QueryPerformanceFrequency(&freq);
+	const LONGLONG minTicks = freq.QuadPart * millis / 1000;
+
+	op();		// warm up: caches, tables and filter history
+	long long pairs = 0;
+	QueryPerformanceCounter(&t0);
+	do
+	{
+		op();
+		pairs += nPairs;
+		QueryPerformanceCounter(&t1);
+	} while (t1.QuadPart - t0.QuadPart < minTicks);
+
+	const double seconds = (double)(t1.QuadPart - t0.QuadPart) / (double)freq.QuadPart;
+	return (double)pairs / seconds * 1E-6;
+}
+
+// one block through the decimator and the output conversion to T
+template <class T>
+struct bench_filter_op
+{
+	Decimator * decim;
+	T * out;
+	bench_buffers * b;
+	int nPairs;
+	void operator()()
+	{
+		const int n = decim->process(&b->iq[0], nPairs, &b->f32[0]);
+		bench_output(&b->f32[0], out, 2 * n);
+	}
+};
+
+// one block through the chain of the autotuner: decimator, resampler and output conversion
+struct bench_chain_op
+{
+	Decimator * decim;
+	Resampler * rs;			// 0: no resampling
+	Nco * nco;
+	IqCorrector * corr;
+	int format;
+	bench_buffers * b;
+	int nPairs;
+	void operator()()
+	{
+		float * out = rs ? rs->inputPtr(nPairs / decim->factor() + 1) : &b->f32[0];
+		int n = decim->process(&b->iq[0], nPairs, out, nco, corr);
+		if (rs)
+			n = rs->run(n, &b->f32[0]);
+		if (format == BENCH_OUT_S16)
+			conv_f32_to_s16(&b->f32[0], &b->s16[0], 2 * n);
+	}
+};
+
+// the former sums in integer arithmetic: 16 bit output
+struct bench_sum_op
+{
+	SumDecimator * sum;
+	bench_buffers * b;
+	int nPairs;
+	void operator()() { sum->process(&b->iq[0], nPairs, &b->s16[0]); }
+};
+
+// one block through the CIC and the output conversion to T
+template <class T>
+struct bench_cic_op
+{
+	CicDecimator * cic;
+	T * out;
+	bench_buffers * b;
+	int nPairs;
+	void operator()()
+	{
+		const int n = cic->process(&b->iq[0], nPairs, &b->s32[0]);
+		bench_output(&b->s32[0], out, 2 * n);
+	}
+};
+
+// rate of one format of the matrix
+template <class DECIM, template <class> class OP>
+static double bench_format(DECIM * decim, int format, bench_buffers & b, int nPairs)
+{
+	if (format == BENCH_OUT_FLOAT)
+	{
+		OP<float> op = { decim, &b.f32[0], &b, nPairs };
+		return bench_msps(op, nPairs);
+	}
+	if (format == BENCH_OUT_S8)
+	{
+		OP<int8_t> op = { decim, &b.s8[0], &b, nPairs };
+		return bench_msps(op, nPairs);
+	}
+	if (format == BENCH_OUT_S16)
+	{
+		OP<int16_t> op = { decim, &b.s16[0], &b, nPairs };
+		return bench_msps(op, nPairs);
+	}
+	OP<int32_t> op = { decim, &b.s32[0], &b, nPairs };
+	return bench_msps(op, nPairs);
+}
+
+// one report line of the matrix: the rates of all formats
+static void bench_matrix_line(const char * what, const double * rate, const char * extra, bench_report_fn report)
+{
+	char line[256];
+	int len = snprintf(line, 255, "benchmark: %-20s", what);
+	for (int k = 0; k < BENCH_MATRIX_FORMATS && len > 0 && len < 230; ++k)
+		len += snprintf(line + len, 255 - len, "  %s %8.1f", bench_format_names[bench_matrix_formats[k]], rate[k]);
+	if (len > 0 && len < 230)
+		snprintf(line + len, 255 - len, "%s", extra);
+	line[255] = 0;
+	report(line);
+}
+
+// conversion kernels of one table entry
+struct bench_u8_s16_op
+{
+	conv_u8_to_s16_fn fn;
+	bench_buffers * b;
+	int nPairs;
+	void operator()() { fn(&b->iq[0], &b->s16[0], 2 * nPairs); }
+};
+
+struct bench_u8_f32_op
+{
+	conv_u8_to_f32_fn fn;
+	bench_buffers * b;
+	int nPairs;
+	void operator()() { fn(&b->iq[0], &b->f32[0], 2 * nPairs, 1.0F / 128.0F); }
+};
+
+struct bench_u8_iqcorr_op
+{
+	conv_u8_iqcorr_f32_fn fn;
+	bench_buffers * b;
+	int nPairs;
+	unsigned calls;
+	void operator()()
+	{
+		// a typical RTL2832 imbalance - moving from block to block as the running
+		// estimates do: up to +-0.1 raw units DC and +-0.002 gain and phase
+		static const float base[4] = { 1.5F, -0.75F, 1.02F, -0.03F };
+		const float d = (float)((++calls * 2654435761u) >> 22) / 1024.0F - 0.5F;
+		const float coef[4] = { base[0] + 0.2F * d, base[1] - 0.2F * d, base[2] + 0.004F * d, base[3] - 0.004F * d };
+		fn(&b->iq[0], &b->f32[0], nPairs, 1.0F / 128.0F, coef);
+	}
+};
+
+static void bench_init(bench_buffers & b, int nPairs)
+{
+	b.iq.resize(2 * nPairs);
+	b.f32.resize(2 * nPairs + 1024);
+	b.s32.resize(2 * nPairs + 1024);
+	b.s16.resize(2 * nPairs + 1024);
+	b.s8.resize(2 * nPairs + 1024);
+	srand(1);
+	for (size_t k = 0; k < b.iq.size(); ++k)
+		b.iq[k] = (uint8_t)(rand() & 0xFF);
+}
+
+// times all supported kernels of a table: one report line
+template <class FN, class OP>
+static void bench_table(const conv_kernel<FN> * table, OP op, const char * what, bench_report_fn report)
+{
+	char line[256];
+	int len = snprintf(line, 255, "benchmark: %-16s", what);
+	const int features = conv_cpu_features();
+	for (int k = 0; table[k].fn && len > 0 && len < 230; ++k)
+	{
+		if ((table[k].required_cpu & features) != table[k].required_cpu)
+			continue;
+		op.fn = table[k].fn;
+		len += snprintf(line + len, 255 - len, "  %s %8.1f", table[k].name, bench_msps(op, op.nPairs));
+	}
+	line[255] = 0;
+	report(line);
+}
+
+void bench_decimation(int nPairs, bench_report_fn report)
+{
+	char line[256];
+	bench_buffers b;
+	bench_init(b, nPairs);
+
+	snprintf(line, 255, "benchmark: decimation of %d I/Q pairs per block, input Msps", nPairs);
+	report(line);
+
+	const int nFilter = sizeof(bench_filter_factors) / sizeof(bench_filter_factors[0]);
+	for (int k = 0; k < nFilter; ++k)
+	{
+		Decimator decim;
+		decim.configure(bench_filter_factors[k]);
+		double rate[BENCH_MATRIX_FORMATS];
+		for (int f = 0; f < BENCH_MATRIX_FORMATS; ++f)
+			rate[f] = bench_format<Decimator, bench_filter_op>(&decim, bench_matrix_formats[f], b, nPairs);
+		SumDecimator sum;
+		sum.configure(bench_filter_factors[k]);
+		bench_sum_op sumOp = { &sum, &b, nPairs };
+		char what[64], extra[64];
+		snprintf(what, sizeof(what) - 1, "/ %3d halfband/FIR", bench_filter_factors[k]);
+		what[sizeof(what) - 1] = 0;
+		snprintf(extra, sizeof(extra) - 1, "  sum %s %8.1f", bench_format_names[BENCH_OUT_S16], bench_msps(sumOp, nPairs));
+		extra[sizeof(extra) - 1] = 0;
+		bench_matrix_line(what, rate, extra, report);
+	}
+
+	for (int factor = CIC_MIN_DECIMATION; factor <= CIC_MAX_DECIMATION; factor *= 2)
+	{
+		CicDecimator cic;
+		cic.configure(factor);
+		double rate[BENCH_MATRIX_FORMATS];
+		for (int f = 0; f < BENCH_MATRIX_FORMATS; ++f)
+			rate[f] = bench_format<CicDecimator, bench_cic_op>(&cic, bench_matrix_formats[f], b, nPairs);
+		char what[64];
+		snprintf(what, sizeof(what) - 1, "/ %3d CIC", factor);
+		what[sizeof(what) - 1] = 0;
+		bench_matrix_line(what, rate, "", report);
+	}
+}
+
+void bench_conversion(int nPairs, bench_report_fn report)
+{
+	char line[256];
+	bench_buffers b;
+	bench_init(b, nPairs);
+
+	snprintf(line, 255, "benchmark: conversion of %d I/Q pairs per block, Msps per kernel", nPairs);
+	report(line);
+
+	bench_u8_s16_op s16 = { 0, &b, nPairs };
+	bench_table(conv_kernels_u8_s16, s16, "u8 -> int16", report);
+	bench_u8_f32_op f32 = { 0, &b, nPairs };
+	bench_table(conv_kernels_u8_f32, f32, "u8 -> float", report);
+	bench_u8_iqcorr_op corr = { 0, &b, nPairs, 0 };
+	bench_table(conv_kernels_u8_iqcorr_f32, corr, "u8 -> corrected", report);
+}
+
+void bench_chain_output(const bench_chain & chain, int blockLen, int * outPairs, int * uses)
+{
+	const int pairs = blockLen / 2;
+	const int real = (chain.input != DECIM_INPUT_IQ) ? 2 : 1;
+	const int toShort = (chain.format == BENCH_OUT_S16) ? BLOCKPOOL_USE_SHORT : 0;
+	switch (chain.path)
+	{
+	case BENCH_CHAIN_RESAMPLE:
+		// the real path resamples half the samplerate
+		*outPairs = (int)((long long)pairs * chain.L / ((long long)real * chain.decimation * chain.M));
+		*uses = BLOCKPOOL_USE_FLOAT | toShort;
+		break;
+	case BENCH_CHAIN_CIC:
+		// int32 goes out as the CIC delivers it
+		*outPairs = pairs / chain.decimation;
+		*uses = BLOCKPOOL_USE_INT | ((chain.format == BENCH_OUT_FLOAT) ? BLOCKPOOL_USE_FLOAT : toShort);
+		break;
+	case BENCH_CHAIN_SUM:
+	case BENCH_CHAIN_DECIMATE:
+		// the moving sum filters without decimating
+		*outPairs = pairs / ((chain.filter == DECIM_FILTER_MOVING_SUM) ? real : real * chain.decimation);
+		*uses = (chain.path == BENCH_CHAIN_SUM) ? BLOCKPOOL_USE_SHORT : (BLOCKPOOL_USE_FLOAT | toShort);
+		break;
+	default:
+		// the correction converts to float first, 8 bit goes out as received
+		*outPairs = pairs;
+		*uses = toShort;
+		if (chain.format == BENCH_OUT_FLOAT || (chain.correction != IQCORR_OFF && chain.format == BENCH_OUT_S16))
+			*uses |= BLOCKPOOL_USE_FLOAT;
+		break;
+	}
+}
+
+void bench_footprint(int maxBlockLen, int ringBlocks, int minRingSize, bench_report_fn report)
+{
+	char line[256];
+	snprintf(line, 255, "benchmark: receive ring and sample buffer pool, kBytes - former fixed buffers %d kBytes"
+		, BENCH_FORMER_BUFFERS / 1024);
+	report(line);
+
+	// 16 bit output without decimation - the largest pool -, halfband/FIR / 8 and CIC / 64
+	static const int paths[] = { BENCH_CHAIN_RAW, BENCH_CHAIN_DECIMATE, BENCH_CHAIN_CIC };
+	static const int decimations[] = { 1, 8, 64 };
+	static const char * names[] = { "raw", "/ 8", "CIC / 64" };
+	bench_chain chain;
+	chain.input = DECIM_INPUT_IQ;
+	chain.filter = DECIM_FILTER_HALFBAND;
+	chain.L = chain.M = 1;
+	chain.format = BENCH_OUT_S16;
+	chain.correction = IQCORR_OFF;
+	chain.shifted = false;
+
+	// one pool per chain and for the large pages, resized along the block sizes as the processing thread does it
+	BlockPool pool[4];
+	for (int blockLen = 1024; blockLen <= maxBlockLen; blockLen *= 2)
+	{
+		// the ring: a power of two, mapped twice - the memory counts once
+		int ring = 64 * 1024;
+		while (ring < ringBlocks * blockLen || ring < minRingSize)
+			ring *= 2;
+		int len = snprintf(line, 255, "benchmark: %4d kB blocks  ring %5d", blockLen / 1024, ring / 1024);
+		size_t total = ring;
+		for (int k = 0; k < 4 && len > 0 && len < 200; ++k)
+		{
+			const int c = (k < 3) ? k : 0;
+			chain.path = paths[c];
+			chain.decimation = decimations[c];
+			int outPairs, uses;
+			bench_chain_output(chain, blockLen, &outPairs, &uses);
+			size_t sizes[BLOCKPOOL_SAMPLE_REGIONS];
+			blockpool_sample_sizes(outPairs, uses, blockLen / 2 * 2 * sizeof(int16_t), sizes);
+			if (!pool[k].allocate(sizes, BLOCKPOOL_SAMPLE_REGIONS, k == 3))
+				len += snprintf(line + len, 255 - len, "  %s failed", (k == 3) ? "large pages" : names[k]);
+			else if (k < 3)
+				len += snprintf(line + len, 255 - len, "  %s %5d", names[k], (int)(pool[k].footprint() / 1024));
+			else
+				len += snprintf(line + len, 255 - len, "  raw in large pages %5d%s", (int)(pool[k].footprint() / 1024)
+					, pool[k].largePages() ? "" : " (not granted)");
+			if (k == 0)
+				total += pool[k].footprint();
+		}
+		if (len > 0 && len < 200)
+			snprintf(line + len, 255 - len, "  total raw %5d", (int)(total / 1024));
+		line[255] = 0;
+		report(line);
+	}
+}
+
+
+/*
+ * autotuner. record: "cpu;pairs;chain;format;u8s16;u8f32;corr;decim"
+ * with the kernel names of the conversion tables and the CPU feature level
+ * of the decimation kernels. tables the chain does not use keep the default
+ */
+
+static const char * decim_level_names[] = { "scalar", "sse2", "avx2" };
+static const int decim_level_features[] = { 0, CONV_CPU_SSE2, CONV_CPU_SSE2 | CONV_CPU_AVX2 };
+#define DECIM_LEVELS	3
+
+// fastest supported kernel of a table - for blocks of op.nPairs
+template <class FN, class OP>
+static const conv_kernel<FN> * tune_table(const conv_kernel<FN> * table, OP op)
+{
+	const int features = conv_cpu_features();
+	const conv_kernel<FN> * best = 0;
+	double bestRate = 0.0;
+	for (int k = 0; table[k].fn; ++k)
+	{
+		if ((table[k].required_cpu & features) != table[k].required_cpu)
+			continue;
+		op.fn = table[k].fn;
+		const double rate = bench_msps(op, op.nPairs, AUTOTUNE_MILLIS);
+		if (!best || rate > bestRate)
+		{
+			best = &table[k];
+			bestRate = rate;
+		}
+	}
+	return best;
+}
+
+// table entry of the active kernel fn - 0 when it is not in the table
+template <class FN>
+static const conv_kernel<FN> * active_kernel(const conv_kernel<FN> * table, FN fn)
+{
+	for (int k = 0; table[k].fn; ++k)
+		if (table[k].fn == fn)
+			return &table[k];
+	return 0;
+}
+
+// level of the active decimation kernels
+static int active_decim_level()
+{
+	const int features = decim_cpu_features();
+	int level = 0;
+	for (int k = 0; k < DECIM_LEVELS; ++k)
+		if ((decim_level_features[k] & features) == decim_level_features[k])
+			level = k;
+	return level;
+}
+
+// splits the record into at most n fields, in place
+static int split_record(char * record, char ** fields, int n)
+{
+	int count = 0;
+	char * p = record;
+	while (count < n)
+	{
+		fields[count++] = p;
+		p = strchr(p, ';');
+		if (!p)
+			break;
+		*p++ = 0;
+	}
+	return count;
+}
+
+static int decim_level(const char * name)
+{
+	for (int k = 0; k < DECIM_LEVELS; ++k)
+	{
+		if (!strcmp(decim_level_names[k], name)
+			&& (decim_level_features[k] & conv_cpu_features()) == decim_level_features[k])
+			return k;
+	}
+	return -1;
+}
+
+// applies the kernels of a matching record: false when it does not match or names are unknown
+static bool apply_record(const char * record, const char * key)
+{
+	const size_t keyLen = strlen(key);
+	if (strncmp(record, key, keyLen))
+		return false;
+
+	char names[256];
+	strncpy(names, record + keyLen, sizeof(names) - 1);
+	names[sizeof(names) - 1] = 0;
+	char * f[4];
+	if (split_record(names, f, 4) != 4)
+		return false;
+
+	const conv_kernel_u8_s16 * s16 = conv_find_kernel(conv_kernels_u8_s16, f[0]);
+	const conv_kernel_u8_f32 * f32 = conv_find_kernel(conv_kernels_u8_f32, f[1]);
+	const conv_kernel_u8_iqcorr_f32 * corr = conv_find_kernel(conv_kernels_u8_iqcorr_f32, f[2]);
+	const int level = decim_level(f[3]);
+	if (!s16 || !f32 || !corr || level < 0)
+		return false;
+
+	conv_u8_to_s16 = s16->fn;
+	conv_u8_to_s16_name = s16->name;
+	conv_u8_to_f32 = f32->fn;
+	conv_u8_iqcorr_f32 = corr->fn;
+	decim_set_cpu_features(decim_level_features[level]);
+	return true;
+}
+
+// chain part of the record: path, decimation, filter/input and what runs in front
+static void chain_name(const bench_chain & c, char * name, int size)
+{
+	static const char * filters[] = { "fir", "sum", "msum" };
+	static const char * inputs[] = { "", "-realI", "-realQ" };
+	const char * filter = (c.filter >= 0 && c.filter < 3) ? filters[c.filter] : "?";
+	const char * input = (c.input >= 0 && c.input < 3) ? inputs[c.input] : "?";
+	int len;
+	if (c.path == BENCH_CHAIN_RESAMPLE)
+		len = snprintf(name, size - 1, "resample/%d*%d:%d%s", c.decimation, c.L, c.M, input);
+	else if (c.path == BENCH_CHAIN_CIC)
+		len = snprintf(name, size - 1, "cic/%d", c.decimation);
+	else if (c.path == BENCH_CHAIN_SUM)
+		len = snprintf(name, size - 1, "int%s/%d", filter, c.decimation);
+	else if (c.path == BENCH_CHAIN_DECIMATE)
+		len = snprintf(name, size - 1, "%s/%d%s", filter, c.decimation, input);
+	else
+		len = snprintf(name, size - 1, "raw");
+	if (len > 0 && len < size - 1 && (c.correction != IQCORR_OFF || c.shifted))
+		snprintf(name + len, size - 1 - len, "+corr%d%s", c.correction, c.shifted ? "+shift" : "");
+	name[size - 1] = 0;
+}
+
+bool bench_autotune(char * record, int recordSize, int nPairs, const bench_chain & chain)
+{
+	char name[64];
+	char key[160];
+	chain_name(chain, name, sizeof(name));
+	const int format = (chain.format >= 0 && chain.format <= BENCH_OUT_U8) ? chain.format : BENCH_OUT_S16;
+	snprintf(key, sizeof(key) - 1, "%s;%d;%s;%s;", conv_cpu_name(), nPairs, name, bench_format_names[format]);
+	key[sizeof(key) - 1] = 0;
+	if (apply_record(record, key))
+		return false;
+
+	// what the chain runs: only these get measured - the rest keeps the default
+	conv_init();
+	decim_set_cpu_features(-1);
+	const bool iq = (chain.input == DECIM_INPUT_IQ);
+	const bool corrected = iq && chain.correction != IQCORR_OFF && chain.format != BENCH_OUT_U8;
+	const bool filtered = (chain.path == BENCH_CHAIN_DECIMATE || chain.path == BENCH_CHAIN_RESAMPLE);
+	const bool raw = (chain.path == BENCH_CHAIN_RAW);
+	const bool tuneS16 = raw && format == BENCH_OUT_S16 && !corrected;
+	const bool tuneCorr = corrected && (raw || filtered || chain.path == BENCH_CHAIN_CIC);
+	const bool tuneF32 = iq && !corrected && ((raw && format == BENCH_OUT_FLOAT) || (filtered && !chain.shifted));
+
+	bench_buffers b;
+	bench_init(b, nPairs);
+	const conv_kernel_u8_s16 * ks16 = active_kernel(conv_kernels_u8_s16, conv_u8_to_s16);
+	const conv_kernel_u8_f32 * kf32 = active_kernel(conv_kernels_u8_f32, conv_u8_to_f32);
+	const conv_kernel_u8_iqcorr_f32 * kcorr = active_kernel(conv_kernels_u8_iqcorr_f32, conv_u8_iqcorr_f32);
+	if (tuneS16)
+	{
+		bench_u8_s16_op s16 = { 0, &b, nPairs };
+		ks16 = tune_table(conv_kernels_u8_s16, s16);
+	}
+	if (tuneF32)
+	{
+		bench_u8_f32_op f32 = { 0, &b, nPairs };
+		kf32 = tune_table(conv_kernels_u8_f32, f32);
+	}
+	if (tuneCorr)
+	{
+		bench_u8_iqcorr_op corr = { 0, &b, nPairs, 0 };
+		kcorr = tune_table(conv_kernels_u8_iqcorr_f32, corr);
+	}
+	if (!ks16 || !kf32 || !kcorr)
+		return false;
+	conv_u8_to_s16 = ks16->fn;
+	conv_u8_to_s16_name = ks16->name;
+	conv_u8_to_f32 = kf32->fn;
+	conv_u8_iqcorr_f32 = kcorr->fn;
+
+	// decimation kernels: on the decimator and resampler as the processing thread configures them
+	int bestLevel = active_decim_level();
+	if (filtered)
+	{
+		const bool resample = (chain.path == BENCH_CHAIN_RESAMPLE);
+		double bestRate = 0.0;
+		for (int k = 0; k < DECIM_LEVELS; ++k)
+		{
+			if ((decim_level_features[k] & conv_cpu_features()) != decim_level_features[k])
+				continue;
+			decim_set_cpu_features(decim_level_features[k]);
+			Decimator decim;
+			Resampler rs;
+			Nco nco;
+			IqCorrector corr;
+			if (resample)
+			{
+				decim.configure(chain.decimation, chain.input);
+				rs.configure(chain.L, chain.M);
+				const size_t outLen = 2 * (size_t)rs.maxOutput(nPairs / decim.factor() + 1);
+				if (b.f32.size() < outLen)
+					b.f32.resize(outLen);
+				if (b.s16.size() < outLen)
+					b.s16.resize(outLen);
+			}
+			else
+				decim.configure(chain.decimation, chain.input, chain.filter);
+			nco.setFrequency(chain.shifted ? 0.25 : 0.0);
+			corr.setMode(corrected ? chain.correction : IQCORR_OFF);
+			bench_chain_op op = { &decim, resample ? &rs : 0, &nco, &corr, format, &b, nPairs };
+			const double rate = bench_msps(op, nPairs, AUTOTUNE_MILLIS);
+			if (rate > bestRate)
+			{
+				bestLevel = k;
+				bestRate = rate;
+			}
+		}
+	}
+
+	snprintf(record, recordSize - 1, "%s%s;%s;%s;%s", key, ks16->name, kf32->name, kcorr->name, decim_level_names[bestLevel]);
+	record[recordSize - 1] = 0;
+	apply_record(record, key);
+	return true;
+}
+
+void bench_kernel_choice(char * text, int size)
+{
+	const conv_kernel_u8_f32 * f32 = active_kernel(conv_kernels_u8_f32, conv_u8_to_f32);
+	const conv_kernel_u8_iqcorr_f32 * corr = active_kernel(conv_kernels_u8_iqcorr_f32, conv_u8_iqcorr_f32);
+	snprintf(text, size - 1, "u8->int16 %s, u8->float %s, corrected %s, decimation %s on %s"
+		, conv_u8_to_s16_name, f32 ? f32->name : "?", corr ? corr->name : "?"
+		, decim_level_names[active_decim_level()], conv_cpu_name());
+	text[size - 1] = 0;
+}
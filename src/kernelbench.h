@@ -0,0 +1,74 @@
+/*
+ * kernel benchmarks for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// receives one line of results
+typedef void (*bench_report_fn)(const char * line);
+
+// runs the decimation over the matrix of offered factors and the output formats
+// float, int8, int16 and int32 on blocks of nPairs raw I/Q pairs. reports the input rate in Msps per entry
+void bench_decimation(int nPairs, bench_report_fn report);
+
+// times each supported kernel of the u8 -> int16, float and corrected float conversions,
+// including the lookup tables. reports Msps per kernel
+void bench_conversion(int nPairs, bench_report_fn report);
+
+// output formats of the benchmarks and the autotuner
+#define BENCH_OUT_FLOAT		0
+#define BENCH_OUT_S16		1
+#define BENCH_OUT_S32		2
+#define BENCH_OUT_U8		3
+#define BENCH_OUT_S8		4
+
+// processing paths of ProcessThreadProc
+#define BENCH_CHAIN_RAW			0	// no decimation: conversion only
+#define BENCH_CHAIN_SUM			1	// integer sums: no kernels to choose
+#define BENCH_CHAIN_DECIMATE	2	// halfband/FIR or sum decimation in float, also the real path
+#define BENCH_CHAIN_CIC			3
+#define BENCH_CHAIN_RESAMPLE	4	// pre-decimation, then L / M
+
+// the chain that will run for the current settings
+struct bench_chain
+{
+	int path;			// BENCH_CHAIN_*
+	int decimation;		// of the CIC, the decimator or before the resampler
+	int input;			// DECIM_INPUT_*
+	int filter;			// DECIM_FILTER_*
+	int L, M;			// resampling
+	int format;			// BENCH_OUT_*
+	int correction;		// IQCORR_*
+	bool shifted;		// NCO/software offset active
+};
+
+// I/Q pairs the chain outputs from a network block of blockLen bytes, and the regions
+// of the sample buffer pool it writes (BLOCKPOOL_USE_*)
+void bench_chain_output(const bench_chain & chain, int blockLen, int * outPairs, int * uses);
+
+// memory of the receive ring - ringBlocks blocks, at least minRingSize bytes - and of the sample
+// buffer pool for network blocks from 1 kB up to maxBlockLen bytes and callbacks of one block:
+// for 16 bit output of a few chains, in normal and large pages. against the former fixed buffers
+void bench_footprint(int maxBlockLen, int ringBlocks, int minRingSize, bench_report_fn report);
+
+// autotuner: picks the fastest kernels of the chain for blocks of nPairs: only the tables
+// the chain uses get measured, the decimation kernels on the configured decimator/resampler.
+// record (settings text) is reused while CPU and chain match - else the kernels get
+// measured and the record rewritten. returns true when measured
+bool bench_autotune(char * record, int recordSize, int nPairs, const bench_chain & chain);
+
+// readable summary of the active kernels
+void bench_kernel_choice(char * text, int size);
@@ -0,0 +1,122 @@
+/*
+ * stream metrics for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "metrics.h"
+
+#include <PassiveSocket.h>
+
+#include <Windows.h>
+#include <process.h>
+#include <string.h>
+
+// polling interval for connections - also the delay of stop()
+#define METRICS_POLL_MS		100
+#define METRICS_TEXT_SIZE	4096
+
+
+StreamCounters::StreamCounters()
+	: bytesReceived(0)
+	, blocksReceived(0)
+	, reconnects(0)
+	, callbacks(0)
+	, byteRate(0)
+	, processTicks(0)
+	, callbackTicks(0)
+	, paceTicks(0)
+	, intervalMicros(0)
+	, cadenceJitterMicros(0)
+{
+}
+
+
+static unsigned __stdcall metricsThreadProc(void * p)
+{
+	((MetricsServer *)p)->serve();
+	return 0;
+}
+
+
+MetricsServer::MetricsServer()
+	: m_thread(0)
+	, m_stop(false)
+	, m_port(0)
+	, m_text(0)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+	stop();
+}
+
+bool MetricsServer::start(int port, metrics_text_fn text)
+{
+	if (m_thread && port == m_port)
+		return true;
+	stop();
+	if (port <= 0 || port > 65535 || !text)
+		return false;
+	m_port = port;
+	m_text = text;
+	m_stop = false;
+	m_thread = (void *)_beginthreadex(NULL, 0, metricsThreadProc, this, 0, NULL);
+	if (!m_thread)
+		m_port = 0;
+	return m_thread != 0;
+}
+
+void MetricsServer::stop()
+{
+	if (!m_thread)
+		return;
+	m_stop = true;
+	WaitForSingleObject((HANDLE)m_thread, INFINITE);
+	CloseHandle((HANDLE)m_thread);
+	m_thread = 0;
+	m_port = 0;
+}
+
+
+void MetricsServer::serve()
+{
+	CPassiveSocket listener;
+	// localhost only: the metrics are not meant for the network
+	if (!listener.Initialize() || !listener.Listen("127.0.0.1", (uint16_t)m_port))
+		return;
+	listener.SetNonblocking();
+
+	static const char header[] = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n";
+	char text[METRICS_TEXT_SIZE];
+	while (!m_stop)
+	{
+		CActiveSocket * client = listener.Accept();
+		if (!client)
+		{
+			::Sleep(METRICS_POLL_MS);
+			continue;
+		}
+		// the request does not matter: any connection gets the metrics
+		client->SetBlocking();
+		client->SetReceiveTimeout(0, 200000);
+		client->Receive(1024);
+		const int len = m_text(text, sizeof(text));
+		client->Send((const uint8_t *)header, sizeof(header) - 1);
+		client->Send((const uint8_t *)text, len);
+		client->Close();
+		delete client;
+	}
+	listener.Close();
+}
@@ -0,0 +1,80 @@
+/*
+ * stream metrics for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+
+// counters of the receive and processing threads - each has a single writer
+struct StreamCounters
+{
+	std::atomic<uint64_t> bytesReceived;
+	std::atomic<unsigned> blocksReceived;
+	std::atomic<unsigned> reconnects;		// connections lost while streaming
+	std::atomic<unsigned> callbacks;
+	std::atomic<int> byteRate;				// bytes per second, measured over ~ 1 s
+	std::atomic<int64_t> processTicks;		// processing thread: conversion, filters and callbacks
+	std::atomic<int64_t> callbackTicks;		// inside the SDR program's callback
+	std::atomic<int64_t> paceTicks;			// waiting for the jitter buffer/pacing
+	std::atomic<int> intervalMicros;		// callback cadence of the last report: mean interval
+	std::atomic<int> cadenceJitterMicros;	// and its deviation
+
+	StreamCounters();
+	void add(std::atomic<int64_t> & counter, int64_t ticks)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+	}
+	void increment(std::atomic<unsigned> & counter)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+};
+
+
+// writes the metrics as text into buf, returns the length
+typedef int (*metrics_text_fn)(char * buf, int size);
+
+
+/*
+ * text metrics for scraping: a thread listens on localhost and answers each
+ * connection with the current metrics - as a plain HTTP response, so that
+ * curl or a Prometheus scraper can read it.
+ */
+class MetricsServer
+{
+public:
+	MetricsServer();
+	~MetricsServer();
+
+	// listens on 127.0.0.1:port. restarts, when the port differs
+	bool start(int port, metrics_text_fn text);
+	void stop();
+	int port() const { return m_port; }
+
+	// thread body: answers connections until stop()
+	void serve();
+
+private:
+	MetricsServer(const MetricsServer &);
+	MetricsServer & operator=(const MetricsServer &);
+
+	void * m_thread;
+	volatile bool m_stop;
+	int m_port;
+	metrics_text_fn m_text;
+};
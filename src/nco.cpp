@@ -0,0 +1,103 @@
+/*
+ * fine tuning oscillator for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nco.h"
+#include "convert.h"
+
+#include <math.h>
+
+
+// the float phasor recursion is restarted from the exact phase after this many pairs
+#define NCO_RENORM_PAIRS	1024
+
+
+Nco::Nco()
+{
+	reset();
+}
+
+void Nco::setFrequency(double freq)
+{
+	m_freq = freq;
+}
+
+void Nco::reset()
+{
+	m_freq = 0.0;
+	m_phase = 0.0;
+}
+
+// fs/4 at a quarter phase: exp(-j 2 pi phase) = j^-quarter - no multiplications
+bool Nco::quarterShift() const
+{
+	return (m_freq == 0.25 || m_freq == -0.25) && m_phase * 4.0 == floor(m_phase * 4.0);
+}
+
+void Nco::advance(int nPairs)
+{
+	m_phase += m_freq * nPairs;
+	m_phase -= floor(m_phase);
+}
+
+void Nco::mix(const uint8_t * iq, float * out, int nPairs, float scale)
+{
+	if (quarterShift())
+	{
+		const int quarter = (4 - (int)(m_phase * 4.0)) & 3;
+		conv_u8_rot4_f32(iq, out, nPairs, scale, quarter, (m_freq < 0.0) ? 1 : -1);
+		advance(nPairs);
+		return;
+	}
+
+	const double PI = 3.14159265358979323846;
+	const float step[2] = { (float)cos(2.0 * PI * m_freq), (float)-sin(2.0 * PI * m_freq) };
+	while (nPairs > 0)
+	{
+		const int n = (nPairs < NCO_RENORM_PAIRS) ? nPairs : NCO_RENORM_PAIRS;
+		float phasor[2] = { (float)cos(2.0 * PI * m_phase), (float)-sin(2.0 * PI * m_phase) };
+		conv_u8_mix_f32(iq, out, n, scale, phasor, step);
+		advance(n);
+		iq += 2 * n;
+		out += 2 * n;
+		nPairs -= n;
+	}
+}
+
+void Nco::mix(const float * iq, float * out, int nPairs)
+{
+	if (quarterShift())
+	{
+		const int quarter = (4 - (int)(m_phase * 4.0)) & 3;
+		conv_f32_rot4_f32(iq, out, nPairs, quarter, (m_freq < 0.0) ? 1 : -1);
+		advance(nPairs);
+		return;
+	}
+
+	const double PI = 3.14159265358979323846;
+	const float step[2] = { (float)cos(2.0 * PI * m_freq), (float)-sin(2.0 * PI * m_freq) };
+	while (nPairs > 0)
+	{
+		const int n = (nPairs < NCO_RENORM_PAIRS) ? nPairs : NCO_RENORM_PAIRS;
+		float phasor[2] = { (float)cos(2.0 * PI * m_phase), (float)-sin(2.0 * PI * m_phase) };
+		conv_f32_mix_f32(iq, out, n, phasor, step);
+		advance(n);
+		iq += 2 * n;
+		out += 2 * n;
+		nPairs -= n;
+	}
+}
@@ -0,0 +1,54 @@
+/*
+ * fine tuning oscillator for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+
+/*
+ * numerically controlled oscillator shifting the raw I/Q stream digitally.
+ * the phase runs continuously over blocks and frequency changes,
+ * so moving the LO inside the receive bandwidth does not glitch.
+ */
+class Nco
+{
+public:
+	Nco();
+
+	// shift relative to the samplerate, -0.5 .. 0.5: out = in * exp(-j 2 pi freq n)
+	void setFrequency(double freq);
+	double frequency() const { return m_freq; }
+	// back to zero phase and frequency
+	void reset();
+	// mixing needed: shifted now - or the phase is off from a previous shift
+	bool active() const { return m_freq != 0.0 || m_phase != 0.0; }
+
+	// out = (in - 128) * scale * exp(-j 2 pi freq n) for nPairs raw unsigned 8 bit I/Q.
+	// a shift of exactly fs/4 from a quarter phase needs no multiplications
+	void mix(const uint8_t * iq, float * out, int nPairs, float scale);
+	// the same for complex float, e.g. after correction. in and out may be the same
+	void mix(const float * iq, float * out, int nPairs);
+
+private:
+	bool quarterShift() const;
+	void advance(int nPairs);
+
+	double m_freq;
+	double m_phase;		// in cycles: 0 .. 1
+};
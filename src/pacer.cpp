@@ -0,0 +1,178 @@
+/*
+ * paced callback delivery for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "pacer.h"
+
+#include <Windows.h>
+#include <math.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION	0x00000002
+#endif
+
+// the timer wakes this early, the rest is spun - in microseconds
+#define PACER_SPIN_US		1000
+// chunks later than this restart the clock - in milliseconds
+#define PACER_MAX_LATE_MS	50
+// longest single wait - in milliseconds
+#define PACER_MAX_WAIT_MS	1000
+
+
+void CadenceStats::reset()
+{
+	m_last = 0;
+	m_started = false;
+	m_count = 0;
+	m_sum = m_sumSq = 0.0;
+	m_max = 0;
+}
+
+void CadenceStats::add(int64_t ticks)
+{
+	if (m_started)
+	{
+		const int64_t d = ticks - m_last;
+		m_sum += (double)d;
+		m_sumSq += (double)d * (double)d;
+		if (d > m_max)
+			m_max = d;
+		++m_count;
+	}
+	m_started = true;
+	m_last = ticks;
+}
+
+double CadenceStats::mean() const
+{
+	return m_count ? m_sum / m_count : 0.0;
+}
+
+double CadenceStats::deviation() const
+{
+	if (!m_count)
+		return 0.0;
+	const double m = m_sum / m_count;
+	const double v = m_sumSq / m_count - m * m;
+	return (v > 0.0) ? sqrt(v) : 0.0;
+}
+
+
+static int64_t nowTicks()
+{
+	LARGE_INTEGER t;
+	QueryPerformanceCounter(&t);
+	return t.QuadPart;
+}
+
+Pacer::Pacer()
+	: m_timer(0)
+	, m_anchored(false)
+	, m_anchor(0)
+	, m_pairs(0.0)
+	, m_rate(0)
+	, m_reanchors(0)
+	, m_hurried(0)
+{
+	LARGE_INTEGER f;
+	QueryPerformanceFrequency(&f);
+	m_freq = f.QuadPart;
+	// high resolution timers need Windows 10 1803 - else the timer has the system tick
+	m_timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!m_timer)
+		m_timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+}
+
+Pacer::~Pacer()
+{
+	if (m_timer)
+		CloseHandle((HANDLE)m_timer);
+}
+
+void Pacer::resetStatistics()
+{
+	ready.reset();
+	released.reset();
+	m_reanchors = m_hurried = 0;
+}
+
+void Pacer::timerWait(int64_t ticks)
+{
+	if (ticks <= 0)
+		return;
+	if (!m_timer)
+	{
+		::Sleep((DWORD)(ticks * 1000 / m_freq));
+		return;
+	}
+	// relative due time in 100 ns units
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -(LONGLONG)(ticks * 10000000 / m_freq);
+	if (SetWaitableTimer((HANDLE)m_timer, &dueTime, 0, NULL, NULL, FALSE))
+		WaitForSingleObject((HANDLE)m_timer, PACER_MAX_WAIT_MS);
+}
+
+void Pacer::sleepUntil(int64_t due)
+{
+	const int64_t rest = due - nowTicks();
+	const int64_t spin = m_freq * PACER_SPIN_US / 1000000;
+	if (rest > spin && m_timer)
+		timerWait(rest - spin);
+	while (nowTicks() < due)
+		YieldProcessor();
+}
+
+void Pacer::wait(int nPairs, int rate, bool hurry)
+{
+	int64_t now = nowTicks();
+	ready.add(now);
+	if (rate <= 0)
+	{
+		released.add(now);
+		return;
+	}
+
+	if (!m_anchored || rate != m_rate)
+	{
+		m_anchored = true;
+		m_rate = rate;
+		m_anchor = now;
+		m_pairs = 0.0;
+	}
+	int64_t due = m_anchor + (int64_t)(m_pairs * (double)m_freq / rate);
+	if (now - due > m_freq * PACER_MAX_LATE_MS / 1000)
+	{
+		// gap in the input: restart the clock instead of catching up in a burst
+		++m_reanchors;
+		m_anchor = due = now;
+		m_pairs = 0.0;
+	}
+	else if (hurry)
+		++m_hurried;		// buffer runs full: the source is faster than the clock
+	else if (due > now && due - now < m_freq * PACER_MAX_WAIT_MS / 1000)
+	{
+		sleepUntil(due);
+		now = nowTicks();
+	}
+	m_pairs += nPairs;
+	released.add(now);
+}
+
+void Pacer::passed()
+{
+	const int64_t now = nowTicks();
+	ready.add(now);
+	released.add(now);
+}
@@ -0,0 +1,92 @@
+/*
+ * paced callback delivery for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+
+// interval statistics of a sequence of events
+class CadenceStats
+{
+public:
+	CadenceStats() { reset(); }
+	void reset();
+	void add(int64_t ticks);
+
+	unsigned count() const { return m_count; }
+	// in ticks
+	double mean() const;
+	double deviation() const;	// standard deviation of the intervals
+	int64_t maximum() const { return m_max; }
+
+private:
+	int64_t m_last;
+	bool m_started;
+	unsigned m_count;
+	double m_sum;
+	double m_sumSq;
+	int64_t m_max;
+};
+
+
+/*
+ * releases callbacks on a clock derived from the output samplerate: each chunk
+ * is due when the pairs before it have played at the nominal rate. waits use a
+ * high resolution waitable timer, the last part spins. a chunk later than
+ * maxLate re-anchors the clock, so a gap is not followed by a burst.
+ * the cadence is measured before (ready) and after (released) pacing.
+ */
+class Pacer
+{
+public:
+	Pacer();
+	~Pacer();
+
+	// restart the clock with the next chunk
+	void reset() { m_anchored = false; }
+
+	// a chunk of nPairs at rate is ready: waits until it is due, unless 'hurry'
+	void wait(int nPairs, int rate, bool hurry);
+	// chunk ready without pacing: only measured
+	void passed();
+
+	int64_t tickFreq() const { return m_freq; }
+	unsigned reanchors() const { return m_reanchors; }
+	unsigned hurried() const { return m_hurried; }
+	void resetStatistics();
+
+	// waits until the tick count due: the timer, the last part spun
+	void sleepUntil(int64_t due);
+	// waits about ticks on the timer alone - for long waits in slices, without spinning
+	void timerWait(int64_t ticks);
+
+	CadenceStats ready;			// chunks ready - the cadence without pacing
+	CadenceStats released;		// chunks released to the callback
+
+private:
+	Pacer(const Pacer &);
+	Pacer & operator=(const Pacer &);
+
+	void * m_timer;
+	int64_t m_freq;
+	bool m_anchored;
+	int64_t m_anchor;			// ticks, where m_pairs are due
+	double m_pairs;				// pairs since anchor, in units of the rate
+	int m_rate;
+	unsigned m_reanchors;
+	unsigned m_hurried;
+};
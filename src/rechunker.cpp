@@ -0,0 +1,93 @@
+/*
+ * callback re-chunking for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "rechunker.h"
+
+#include <string.h>
+
+
+Rechunker::Rechunker()
+	: m_staging(0)
+	, m_stagingBytes(0)
+	, m_chunk(0)
+	, m_pairBytes(0)
+	, m_staged(0)
+	, m_direct(0)
+	, m_copied(0)
+{
+}
+
+void Rechunker::setStaging(void * staging, int bytes)
+{
+	// staged pairs stay while the chunk fits: the caller moved them along
+	m_staging = (uint8_t *)staging;
+	m_stagingBytes = bytes;
+	if (m_chunk * m_pairBytes > bytes)
+		m_chunk = m_pairBytes = m_staged = 0;
+}
+
+bool Rechunker::configure(int chunkPairs, int bytesPerPair)
+{
+	if (chunkPairs == m_chunk && bytesPerPair == m_pairBytes)
+		return true;
+	m_staged = 0;
+	if (chunkPairs < 1 || chunkPairs * bytesPerPair > m_stagingBytes)
+	{
+		m_chunk = m_pairBytes = 0;
+		return false;
+	}
+	m_chunk = chunkPairs;
+	m_pairBytes = bytesPerPair;
+	return true;
+}
+
+void Rechunker::push(const void * samples, int nPairs, chunk_deliver_fn deliver)
+{
+	if (!m_chunk)
+		return;
+	const uint8_t * in = (const uint8_t *)samples;
+
+	if (m_staged)
+	{
+		// complete the partial chunk first
+		int n = m_chunk - m_staged;
+		if (n > nPairs)
+			n = nPairs;
+		memcpy(m_staging + m_staged * m_pairBytes, in, n * m_pairBytes);
+		m_staged += n;
+		in += n * m_pairBytes;
+		nPairs -= n;
+		if (m_staged < m_chunk)
+			return;
+		deliver(m_chunk, m_staging);
+		m_staged = 0;
+		++m_copied;
+	}
+
+	while (nPairs >= m_chunk)
+	{
+		deliver(m_chunk, (void *)in);
+		in += m_chunk * m_pairBytes;
+		nPairs -= m_chunk;
+		++m_direct;
+	}
+
+	if (nPairs)
+	{
+		memcpy(m_staging, in, nPairs * m_pairBytes);
+		m_staged = nPairs;
+	}
+}
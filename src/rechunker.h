@@ -0,0 +1,62 @@
+/*
+ * callback re-chunking for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+
+// receives each complete chunk
+typedef void (*chunk_deliver_fn)(int nPairs, void * samples);
+
+
+/*
+ * cuts a stream of I/Q pairs into callbacks of a fixed number of pairs -
+ * independent of the network block and decimator output lengths.
+ * whole chunks are delivered straight from the input; only a partial chunk
+ * is copied into the staging buffer, to be completed by the next push().
+ * with matching sizes nothing is ever copied.
+ */
+class Rechunker
+{
+public:
+	Rechunker();
+
+	// staging memory for one chunk of the largest pair size - owned by the caller,
+	// who keeps its content when moving it. a chunk not fitting any more gets unconfigured
+	void setStaging(void * staging, int bytes);
+	// pair size in bytes: 2 (8 bit) .. 8 (32 bit/float). changes drop staged pairs
+	bool configure(int chunkPairs, int bytesPerPair);
+	void reset() { m_staged = 0; }
+
+	void push(const void * samples, int nPairs, chunk_deliver_fn deliver);
+
+	int chunk() const { return m_chunk; }
+	int staged() const { return m_staged; }
+
+	// statistics: chunks delivered without/with copy
+	unsigned directChunks() const { return m_direct; }
+	unsigned stagedChunks() const { return m_copied; }
+
+private:
+	uint8_t * m_staging;
+	int m_stagingBytes;
+	int m_chunk;
+	int m_pairBytes;
+	int m_staged;		// pairs in m_staging
+	unsigned m_direct;
+	unsigned m_copied;
+};
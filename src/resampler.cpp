@@ -0,0 +1,121 @@
+/*
+ * rational resampler for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resampler.h"
+#include "decimator.h"
+
+
+#define KAISER_BETA		7.0
+
+// taps per phase when interpolating. decimating ratios need M / L times more
+#define RESAMPLER_TAPS_PER_PHASE	16
+
+
+int resampler_gcd(int a, int b)
+{
+	while (b)
+	{
+		const int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+
+Resampler::Resampler()
+	: m_L(1)
+	, m_M(1)
+	, m_taps(2)
+	, m_pos(0)
+	, m_phase(0)
+{
+}
+
+bool Resampler::configure(int interpolation, int decimation)
+{
+	if (interpolation < 1 || decimation < 1)
+		return false;
+	const int g = resampler_gcd(interpolation, decimation);
+	const int L = interpolation / g;
+	const int M = decimation / g;
+	if (L > RESAMPLER_MAX_L)
+		return false;
+
+	// prototype lowpass runs at L times the input rate: cutoff at the lower of both nyquist rates
+	const int maxLM = (L > M) ? L : M;
+	int taps = (RESAMPLER_TAPS_PER_PHASE * maxLM + L - 1) / L;
+	taps = (taps + 1) & ~1;
+	const int protoTaps = taps * L;
+	std::vector<float> h(protoTaps);
+	fir_design_lowpass(&h[0], protoTaps, 0.5 / maxLM, KAISER_BETA);
+
+	// phase p uses h[p + k * L]; gain L compensates the zero stuffing
+	m_coef.resize(2 * (size_t)protoTaps);
+	for (int p = 0; p < L; ++p)
+	{
+		float * hh = &m_coef[2 * (size_t)p * taps];
+		for (int k = 0; k < taps; ++k)
+		{
+			const float c = (float)L * h[p + k * L];
+			hh[2 * (taps - 1 - k)] = hh[2 * (taps - 1 - k) + 1] = c;
+		}
+	}
+
+	m_L = L;
+	m_M = M;
+	m_taps = taps;
+	reset();
+	return true;
+}
+
+void Resampler::reset()
+{
+	m_buf.reset(m_taps - 1);
+	m_pos = 0;
+	m_phase = 0;
+}
+
+float * Resampler::inputPtr(int n)
+{
+	return m_buf.inputPtr(n);
+}
+
+int Resampler::run(int n, float * out)
+{
+	m_buf.commit(n);
+	const float * x = m_buf.data();
+	const int count = m_buf.count();
+	int nOut = 0;
+	while (m_pos + m_taps <= count)
+	{
+		fir_complex_dot(x + 2 * m_pos, &m_coef[2 * (size_t)m_phase * m_taps], m_taps, out);
+		out += 2;
+		++nOut;
+
+		m_phase += m_M;
+		m_pos += m_phase / m_L;
+		m_phase %= m_L;
+	}
+
+	// the unconsumed tail stays as history for the next block. the next window may start
+	// behind the buffered samples when decimating
+	const int consumed = (m_pos < count) ? m_pos : count;
+	m_buf.consume(consumed);
+	m_pos -= consumed;
+	return nOut;
+}
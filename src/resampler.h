@@ -0,0 +1,63 @@
+/*
+ * rational resampler for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "decimator.h"
+
+#include <vector>
+
+
+/*
+ * polyphase resampler by L / M on interleaved complex float samples.
+ * like DecimStage, new input is written behind the filter history with
+ * inputPtr() and processed with run(), on a FilterInput.
+ */
+class Resampler
+{
+public:
+	Resampler();
+
+	// L / M get reduced by their greatest common divisor
+	bool configure(int interpolation, int decimation);
+	int interpolation() const { return m_L; }
+	int decimation() const { return m_M; }
+	void reset();
+
+	// upper bound for the number of outputs from n inputs
+	int maxOutput(int n) const { return (int)(((long long)n * m_L) / m_M) + 2; }
+
+	float * inputPtr(int n);
+	// returns number of complex outputs
+	int run(int n, float * out);
+
+private:
+	int m_L;
+	int m_M;
+	int m_taps;					// taps per phase - even
+	std::vector<float> m_coef;	// m_L phases of m_taps coefficient pairs, reversed for the dot product
+	FilterInput m_buf;			// history + new input
+	int m_pos;					// window start of next output - from the first buffered sample
+	int m_phase;				// polyphase index of next output: 0 .. m_L - 1
+};
+
+
+// maximum interpolation factor after reduction. limits the coefficient memory
+#define RESAMPLER_MAX_L		1024
+
+// greatest common divisor
+int resampler_gcd(int a, int b);
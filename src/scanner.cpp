@@ -0,0 +1,298 @@
+/*
+ * frequency sweep / power scan for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scanner.h"
+
+#include <Windows.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static bool parse_number(const char * & p, double & v)
+{
+	char * end;
+	v = strtod(p, &end);
+	if (end == p)
+		return false;
+	p = end;
+	return true;
+}
+
+bool scan_parse_plan(const char * spec, std::vector<scan_step_t> & plan)
+{
+	plan.clear();
+	const char * p = spec;
+	while (*p)
+	{
+		double start, stop, step = 0.0, dwell = SCAN_DEFAULT_DWELL_MS;
+		if (!parse_number(p, start))
+			return false;
+		stop = start;
+		if (*p == '-')
+		{
+			++p;
+			if (!parse_number(p, stop) || *p != ':')
+				return false;
+			++p;
+			if (!parse_number(p, step) || step <= 0.0 || stop < start)
+				return false;
+		}
+		if (*p == '@')
+		{
+			++p;
+			if (!parse_number(p, dwell) || dwell < 1.0)
+				return false;
+		}
+		if (*p == ';')
+			++p;
+		else if (*p)
+			return false;
+
+		for (double f = start; f <= stop + 0.5; f += (step > 0.0) ? step : 1.0)
+		{
+			if ((int)plan.size() >= SCAN_MAX_STEPS || f < 0.0 || f > 4294967295.0)
+				return false;
+			scan_step_t s;
+			s.frequency = (uint32_t)(f + 0.5);
+			s.dwellMillis = (int)dwell;
+			plan.push_back(s);
+		}
+	}
+	return !plan.empty();
+}
+
+
+PowerScan::PowerScan()
+	: m_file(INVALID_HANDLE_VALUE)
+	, m_mapping(0)
+	, m_header(0)
+	, m_rows(0)
+	, m_numSteps(0)
+	, m_fftSize(0)
+	, m_step(-1)
+	, m_sweep(0)
+	, m_frames(0)
+	, m_frameFill(0)
+{
+}
+
+PowerScan::~PowerScan()
+{
+	close();
+}
+
+bool PowerScan::open(const char * fileName, const std::vector<scan_step_t> & plan, int fftSize, int samplerate)
+{
+	close();
+	if (plan.empty() || fftSize < SCAN_MIN_FFT || fftSize > SCAN_MAX_FFT || (fftSize & (fftSize - 1)))
+		return false;
+
+	const int numSteps = (int)plan.size();
+	const size_t fileSize = sizeof(scan_file_header_t) + numSteps * sizeof(uint32_t) + (size_t)numSteps * fftSize * sizeof(float);
+
+	m_file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return false;
+	m_mapping = CreateFileMapping((HANDLE)m_file, NULL, PAGE_READWRITE, 0, (DWORD)fileSize, NULL);
+	if (m_mapping)
+		m_header = (scan_file_header_t *)MapViewOfFile((HANDLE)m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, fileSize);
+	if (m_header == 0)
+	{
+		close();
+		return false;
+	}
+
+	uint32_t * freqs = (uint32_t *)(m_header + 1);
+	m_rows = (float *)(freqs + numSteps);
+	memcpy(m_header->magic, "RTLSCAN1", 8);
+	m_header->headerSize = sizeof(scan_file_header_t);
+	m_header->numSteps = numSteps;
+	m_header->fftSize = fftSize;
+	m_header->samplerate = samplerate;
+	m_header->sweeps = 0;
+	m_header->lastStep = 0;
+	for (int k = 0; k < numSteps; ++k)
+		freqs[k] = plan[k].frequency;
+	for (size_t k = 0; k < (size_t)numSteps * fftSize; ++k)
+		m_rows[k] = -200.0F;
+
+	// hann window, scaled to unit power gain and 8 bit full scale
+	const double PI = 3.14159265358979323846;
+	m_window.resize(fftSize);
+	double wsum = 0.0;
+	for (int n = 0; n < fftSize; ++n)
+	{
+		m_window[n] = (float)(0.5 - 0.5 * cos(2.0 * PI * n / fftSize));
+		wsum += (double)m_window[n] * m_window[n];
+	}
+	const float wscale = (float)(1.0 / (128.0 * sqrt(wsum)));
+	for (int n = 0; n < fftSize; ++n)
+		m_window[n] *= wscale;
+
+	m_twiddle.resize(fftSize);
+	for (int k = 0; k < fftSize / 2; ++k)
+	{
+		m_twiddle[2 * k] = (float)cos(-2.0 * PI * k / fftSize);
+		m_twiddle[2 * k + 1] = (float)sin(-2.0 * PI * k / fftSize);
+	}
+	int bits = 0;
+	while ((1 << bits) < fftSize)
+		++bits;
+	m_bitrev.resize(fftSize);
+	for (int n = 0; n < fftSize; ++n)
+	{
+		int r = 0;
+		for (int b = 0; b < bits; ++b)
+			r |= ((n >> b) & 1) << (bits - 1 - b);
+		m_bitrev[n] = r;
+	}
+
+	m_frame.resize(2 * (size_t)fftSize);
+	m_power.assign(fftSize, 0.0);
+	m_numSteps = numSteps;
+	m_fftSize = fftSize;
+	m_step = -1;
+	m_sweep = 0;
+	m_frames = 0;
+	m_frameFill = 0;
+	return true;
+}
+
+void PowerScan::close()
+{
+	finish();
+	if (m_header)
+	{
+		FlushViewOfFile(m_header, 0);
+		UnmapViewOfFile(m_header);
+		m_header = 0;
+		m_rows = 0;
+	}
+	if (m_mapping)
+	{
+		CloseHandle((HANDLE)m_mapping);
+		m_mapping = 0;
+	}
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle((HANDLE)m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+}
+
+void PowerScan::process(int step, int sweep, const uint8_t * iq, int nPairs)
+{
+	if (!m_header || step < 0 || step >= m_numSteps)
+		return;
+	if (step != m_step || sweep != m_sweep)
+	{
+		if (m_step >= 0)
+		{
+			finishStep();
+			if (sweep != m_sweep)
+				++m_header->sweeps;
+		}
+		m_step = step;
+		m_sweep = sweep;
+		m_frames = 0;
+		m_frameFill = 0;
+		m_power.assign(m_fftSize, 0.0);
+	}
+
+	while (nPairs > 0)
+	{
+		const int n = (m_fftSize - m_frameFill < nPairs) ? (m_fftSize - m_frameFill) : nPairs;
+		float * f = &m_frame[2 * (size_t)m_frameFill];
+		const float * w = &m_window[m_frameFill];
+		for (int k = 0; k < n; ++k)
+		{
+			f[2 * k] = ((int)iq[2 * k] - 128) * w[k];
+			f[2 * k + 1] = ((int)iq[2 * k + 1] - 128) * w[k];
+		}
+		iq += 2 * n;
+		nPairs -= n;
+		m_frameFill += n;
+		if (m_frameFill == m_fftSize)
+		{
+			transform();
+			for (int k = 0; k < m_fftSize; ++k)
+				m_power[k] += (double)m_frame[2 * k] * m_frame[2 * k] + (double)m_frame[2 * k + 1] * m_frame[2 * k + 1];
+			++m_frames;
+			m_frameFill = 0;
+		}
+	}
+}
+
+void PowerScan::finish()
+{
+	if (m_header && m_step >= 0)
+		finishStep();
+	m_step = -1;
+}
+
+void PowerScan::finishStep()
+{
+	if (!m_frames)
+		return;
+	float * row = &m_rows[(size_t)m_step * m_fftSize];
+	const int half = m_fftSize / 2;
+	for (int k = 0; k < m_fftSize; ++k)
+	{
+		const double p = m_power[k] / m_frames;
+		// fft shift: negative frequencies first
+		row[(k + half) & (m_fftSize - 1)] = (float)(10.0 * log10(p + 1E-20));
+	}
+	m_header->lastStep = m_step;
+}
+
+void PowerScan::transform()
+{
+	float * x = &m_frame[0];
+	for (int n = 0; n < m_fftSize; ++n)
+	{
+		const int r = m_bitrev[n];
+		if (r > n)
+		{
+			float t = x[2 * n];	x[2 * n] = x[2 * r];	x[2 * r] = t;
+			t = x[2 * n + 1];	x[2 * n + 1] = x[2 * r + 1];	x[2 * r + 1] = t;
+		}
+	}
+	// iterative radix 2
+	for (int len = 2; len <= m_fftSize; len *= 2)
+	{
+		const int half = len / 2;
+		const int tstep = m_fftSize / len;
+		for (int i = 0; i < m_fftSize; i += len)
+		{
+			for (int k = 0; k < half; ++k)
+			{
+				const float wr = m_twiddle[2 * k * tstep];
+				const float wi = m_twiddle[2 * k * tstep + 1];
+				float * a = &x[2 * (i + k)];
+				float * b = &x[2 * (i + k + half)];
+				const float tr = b[0] * wr - b[1] * wi;
+				const float ti = b[0] * wi + b[1] * wr;
+				b[0] = a[0] - tr;
+				b[1] = a[1] - ti;
+				a[0] += tr;
+				a[1] += ti;
+			}
+		}
+	}
+}
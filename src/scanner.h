@@ -0,0 +1,105 @@
+/*
+ * frequency sweep / power scan for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+
+#define SCAN_MAX_STEPS			4096
+#define SCAN_DEFAULT_DWELL_MS	50
+#define SCAN_MIN_FFT			64
+#define SCAN_MAX_FFT			16384
+
+
+typedef struct
+{
+	uint32_t frequency;		// in Hz
+	int dwellMillis;		// integration time after settling
+} scan_step_t;
+
+/*
+ * scan plan from text:  item { ';' item }
+ *   item := freq [ '@' dwell_ms ]
+ *        |  start '-' stop ':' step [ '@' dwell_ms ]
+ * frequencies in Hz, e.g. "88000000-108000000:2000000@20;162400000"
+ * returns false on syntax error or too many steps
+ */
+bool scan_parse_plan(const char * spec, std::vector<scan_step_t> & plan);
+
+
+/*
+ * output file: this header, followed by
+ *   uint32_t frequency[numSteps]
+ *   float    power_dB[numSteps][fftSize]	- fft shifted: lowest frequency first
+ * rows get updated after each step. sweeps counts completed sweeps
+ */
+typedef struct
+{
+	char magic[8];				// "RTLSCAN1"
+	uint32_t headerSize;
+	uint32_t numSteps;
+	uint32_t fftSize;
+	uint32_t samplerate;
+	volatile uint32_t sweeps;
+	volatile uint32_t lastStep;	// last updated row
+} scan_file_header_t;
+
+
+/*
+ * integrates FFT power of each step and writes the results
+ * into a memory mapped file. runs on the processing thread: the worker
+ * behind the receive ring, which delivers no callbacks while scanning.
+ */
+class PowerScan
+{
+public:
+	PowerScan();
+	~PowerScan();
+
+	bool open(const char * fileName, const std::vector<scan_step_t> & plan, int fftSize, int samplerate);
+	// writes the current step, then closes the file
+	void close();
+	bool isOpen() const { return m_header != 0; }
+
+	// raw unsigned 8 bit I/Q of the given step. sweep toggles between 0 and 1 with each sweep.
+	// a change of step or sweep finishes the previous step
+	void process(int step, int sweep, const uint8_t * iq, int nPairs);
+	// write the results of the current step
+	void finish();
+
+private:
+	void finishStep();
+	void transform();
+
+	void * m_file;
+	void * m_mapping;
+	scan_file_header_t * m_header;
+	float * m_rows;
+	int m_numSteps;
+	int m_fftSize;
+	int m_step;					// step being integrated, -1 for none
+	int m_sweep;
+	int m_frames;				// integrated frames of m_step
+	int m_frameFill;			// complex samples in m_frame
+	std::vector<float> m_frame;	// interleaved I/Q, then spectrum in place
+	std::vector<float> m_window;
+	std::vector<float> m_twiddle;	// cos, sin pairs
+	std::vector<int> m_bitrev;
+	std::vector<double> m_power;
+};
@@ -0,0 +1,45 @@
+/*
+ * Windows API subset of the kernel tests on other systems for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// only what the kernel sources use: the performance counter in nanoseconds
+
+#include <stdint.h>
+#include <time.h>
+
+typedef long long LONGLONG;
+typedef int BOOL;
+
+typedef union _LARGE_INTEGER
+{
+	LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER * freq)
+{
+	freq->QuadPart = 1000000000LL;
+	return 1;
+}
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER * count)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	count->QuadPart = (LONGLONG)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	return 1;
+}
@@ -0,0 +1,241 @@
+/*
+ * micro-benchmark of the sample kernels for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "convert.h"
+#include "decimator.h"
+#include "kernelbench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+
+// minimum time per measurement
+#define BENCH_MILLIS		200
+#define DEFAULT_PAIRS		32768		// the DLL's default buffer of 64 kB
+
+
+// runs op() - one block of nPairs - for at least BENCH_MILLIS: returns input Msps
+template <class OP>
+static double bench_msps(OP & op, int nPairs)
+{
+	typedef std::chrono::steady_clock clock;
+	op();		// warm up: caches and tables
+	long long pairs = 0;
+	const clock::time_point t0 = clock::now();
+	clock::time_point t1;
+	do
+	{
+		op();
+		pairs += nPairs;
+		t1 = clock::now();
+	} while (t1 - t0 < std::chrono::milliseconds(BENCH_MILLIS));
+	const double seconds = std::chrono::duration<double>(t1 - t0).count();
+	return (double)pairs / seconds * 1E-6;
+}
+
+
+// the loop of ThreadProc the u8 -> int16 kernels replaced
+static void legacy_u8_to_s16(const uint8_t * char_ptr, int16_t * short_ptr, int n)
+{
+	for (int i = 0; i < n; i++)
+		*short_ptr++ = ((short)(*char_ptr++)) - 128;
+}
+
+// the sum loops of ThreadProc the decimator replaced - with FULL_DECIMATION 1
+static void legacy_sum_decimation(const uint8_t * char_ptr, int16_t * short_ptr, int n_output_per_block, int decimation)
+{
+	int i;
+	switch (decimation)
+	{
+	case 2:
+		for (i = 0; i < n_output_per_block; i++)
+		{
+			*short_ptr++ = ((short)(char_ptr[0])) + ((short)(char_ptr[2])) - 2 * 128;
+			*short_ptr++ = ((short)(char_ptr[1])) + ((short)(char_ptr[3])) - 2 * 128;
+			char_ptr += 2 * 2;
+		}
+		break;
+	case 4:
+		for (i = 0; i < n_output_per_block; i++)
+		{
+			*short_ptr++ = ((short)(char_ptr[0])) + ((short)(char_ptr[2]))
+				+ ((short)(char_ptr[4])) + ((short)(char_ptr[6])) - 4 * 128;
+			*short_ptr++ = ((short)(char_ptr[1])) + ((short)(char_ptr[3]))
+				+ ((short)(char_ptr[5])) + ((short)(char_ptr[7])) - 4 * 128;
+			char_ptr += 2 * 4;
+		}
+		break;
+	case 6:
+		for (i = 0; i < n_output_per_block; i++)
+		{
+			*short_ptr++ = ((short)(char_ptr[0])) + ((short)(char_ptr[2])) + ((short)(char_ptr[4]))
+				+ ((short)(char_ptr[6])) + ((short)(char_ptr[8])) + ((short)(char_ptr[10])) - 6 * 128;
+			*short_ptr++ = ((short)(char_ptr[1])) + ((short)(char_ptr[3])) + ((short)(char_ptr[5]))
+				+ ((short)(char_ptr[7])) + ((short)(char_ptr[9])) + ((short)(char_ptr[11])) - 6 * 128;
+			char_ptr += 2 * 6;
+		}
+		break;
+	case 8:
+		for (i = 0; i < n_output_per_block; i++)
+		{
+			*short_ptr++ = ((short)(char_ptr[0])) + ((short)(char_ptr[2])) + ((short)(char_ptr[4])) + ((short)(char_ptr[6]))
+				+ ((short)(char_ptr[8])) + ((short)(char_ptr[10])) + ((short)(char_ptr[12])) + ((short)(char_ptr[14])) - 8 * 128;
+			*short_ptr++ = ((short)(char_ptr[1])) + ((short)(char_ptr[3])) + ((short)(char_ptr[5])) + ((short)(char_ptr[7]))
+				+ ((short)(char_ptr[9])) + ((short)(char_ptr[11])) + ((short)(char_ptr[13])) + ((short)(char_ptr[15])) - 8 * 128;
+			char_ptr += 2 * 8;
+		}
+		break;
+	}
+}
+
+struct legacy_sum_op
+{
+	const uint8_t * in;
+	int16_t * out;
+	int nPairs;
+	int decimation;
+	void operator()() { legacy_sum_decimation(in, out, nPairs / decimation, decimation); }
+};
+
+// the decimator with int16 output, as in the processing thread
+struct decimator_op
+{
+	Decimator * decim;
+	const uint8_t * in;
+	float * f32;
+	int16_t * out;
+	int nPairs;
+	void operator()()
+	{
+		const int n = decim->process(in, nPairs, f32);
+		conv_f32_to_s16(f32, out, 2 * n);
+	}
+};
+
+struct sum_decimator_op
+{
+	SumDecimator * sum;
+	const uint8_t * in;
+	int16_t * out;
+	int nPairs;
+	void operator()() { sum->process(in, nPairs, out); }
+};
+
+struct u8_s16_op
+{
+	conv_u8_to_s16_fn fn;
+	const uint8_t * in;
+	int16_t * out;
+	int nPairs;
+	void operator()() { fn(in, out, 2 * nPairs); }
+};
+
+
+static void bench_u8_s16(int nPairs)
+{
+	std::vector<uint8_t> iq(2 * nPairs);
+	std::vector<int16_t> s16(2 * nPairs);
+	srand(1);
+	for (size_t k = 0; k < iq.size(); ++k)
+		iq[k] = (uint8_t)(rand() & 0xFF);
+
+	u8_s16_op op = { legacy_u8_to_s16, &iq[0], &s16[0], nPairs };
+	const double legacy = bench_msps(op, nPairs);
+	printf("u8 -> int16, %d I/Q pairs per block\n", nPairs);
+	printf("  %-8s %9.1f Msps\n", "legacy", legacy);
+
+	const int features = conv_cpu_features();
+	for (int k = 0; conv_kernels_u8_s16[k].fn; ++k)
+	{
+		const conv_kernel_u8_s16 & e = conv_kernels_u8_s16[k];
+		if ((e.required_cpu & features) != e.required_cpu)
+		{
+			printf("  %-8s     (not supported)\n", e.name);
+			continue;
+		}
+		op.fn = e.fn;
+		const double rate = bench_msps(op, nPairs);
+		printf("  %-8s %9.1f Msps  %5.2fx legacy\n", e.name, rate, rate / legacy);
+	}
+}
+
+
+// decimation by the offered factors of the former sum loops
+static void bench_sum_decimation(int nPairs)
+{
+	std::vector<uint8_t> iq(2 * nPairs);
+	std::vector<float> f32(2 * nPairs + 1024);
+	std::vector<int16_t> s16(2 * nPairs + 1024);
+	srand(1);
+	for (size_t k = 0; k < iq.size(); ++k)
+		iq[k] = (uint8_t)(rand() & 0xFF);
+
+	printf("decimation to int16, %d I/Q pairs per block, input Msps\n", nPairs);
+	printf("         former loop      sum     sum (float, shift/corr)   halfband/FIR\n");
+	static const int factors[] = { 2, 4, 6, 8 };
+	for (int k = 0; k < 4; ++k)
+	{
+		legacy_sum_op legacyOp = { &iq[0], &s16[0], nPairs, factors[k] };
+		const double legacy = bench_msps(legacyOp, nPairs);
+
+		SumDecimator sum;
+		sum.configure(factors[k]);
+		sum_decimator_op sumOp = { &sum, &iq[0], &s16[0], nPairs };
+		const double sumRate = bench_msps(sumOp, nPairs);
+
+		double rate[2];
+		for (int filter = 0; filter < 2; ++filter)
+		{
+			Decimator decim;
+			decim.configure(factors[k], DECIM_INPUT_IQ, filter ? DECIM_FILTER_SUM : DECIM_FILTER_HALFBAND);
+			decim.setScale(filter ? 1.0F : (float)factors[k]);
+			decimator_op op = { &decim, &iq[0], &f32[0], &s16[0], nPairs };
+			rate[filter] = bench_msps(op, nPairs);
+		}
+		printf("  / %d  %12.1f %8.1f %5.2fx   %8.1f %5.2fx      %8.1f %5.2fx\n", factors[k], legacy
+			, sumRate, sumRate / legacy, rate[1], rate[1] / legacy, rate[0], rate[0] / legacy);
+	}
+}
+
+
+static void print_line(const char * line)
+{
+	printf("%s\n", line);
+}
+
+int main(int argc, char * argv[])
+{
+	const int nPairs = (argc > 1) ? atoi(argv[1]) : DEFAULT_PAIRS;
+	if (nPairs <= 0)
+	{
+		fprintf(stderr, "usage: %s [I/Q pairs per block]\n", argv[0]);
+		return 1;
+	}
+	printf("CPU: %s\n", conv_cpu_name());
+	conv_init();
+	bench_u8_s16(nPairs);
+	bench_sum_decimation(nPairs);
+	// as setting 30 logs it: all kernels, the factor x format matrix and the buffer footprint -
+	// with the DLL's receive ring of 16 blocks, at least 1 MByte
+	bench_conversion(nPairs, print_line);
+	bench_decimation(nPairs, print_line);
+	bench_footprint(256 * 1024, 16, 1024 * 1024, print_line);
+	return 0;
+}
@@ -0,0 +1,1071 @@
+/*
+ * bit exactness and frequency response tests of the sample kernels and the stream buffers for ExtIO_RTL_TCP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cic.h"
+#include "convert.h"
+#include "decimator.h"
+#include "jitter.h"
+#include "rechunker.h"
+#include "resampler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+
+/*
+ * each supported kernel of a table runs on the same input as the scalar kernel:
+ * all lengths up to a few vectors plus a long block, each from unaligned starts.
+ * outputs are compared bit for bit - including a guard area behind the output,
+ * which no kernel may touch. two kernels are approximations by design and get
+ * checked against their documented error bound instead:
+ *   mix (sse2): advances the oscillator by two pairs per step
+ *   iqcorr (sse2, avx2, lut): fixed point coefficients / tables with tolerances
+ */
+
+#define MAX_SHORT_LEN	80
+#define LONG_LEN		4103
+#define MAX_OFFSET		4
+#define GUARD			16
+#define GUARD_BYTE		0xCD
+
+static int failures = 0;
+static int checks = 0;
+
+static std::vector<uint8_t> in_u8;
+static std::vector<float> in_f32;
+static std::vector<float> in_f32_sat;
+static std::vector<float> in_f32_s8;		// in_f32_sat at the level of int8 and int32
+static std::vector<float> in_f32_s32;
+static std::vector<int32_t> in_s32;
+
+
+static void init_inputs()
+{
+	const size_t n = 2 * (LONG_LEN + MAX_OFFSET) + 64;
+	in_u8.resize(2 * 65536 + 64);
+	in_f32.resize(n);
+	in_s32.resize(n);
+	srand(1);
+	for (size_t k = 0; k < in_u8.size(); ++k)
+		in_u8[k] = (uint8_t)(rand() & 0xFF);
+	// extremes near the start: every short length sees them
+	const uint8_t edges[] = { 0, 255, 128, 127, 1, 254 };
+	memcpy(&in_u8[3], edges, sizeof(edges));
+
+	for (size_t k = 0; k < n; ++k)
+	{
+		const int r = (rand() << 16) ^ rand();
+		in_s32[k] = (int32_t)((unsigned)r * 2654435761u);
+		in_f32[k] = (float)((rand() & 0xFFFF) - 32768) * 0.73F;
+	}
+	const int32_t s32_edges[] = { 2147483647, (-2147483647 - 1), 32767 * 65536, -32768 * 65536, 0, -1, 1 << 15, -(1 << 15) };
+	memcpy(&in_s32[3], s32_edges, sizeof(s32_edges));
+	const float f32_edges[] = { 0.5F, -0.5F, 1.5F, -1.5F, 2.5F, -2.5F, 32767.4F, 32767.6F, -32768.4F, -32768.6F
+		, 40000.0F, -40000.0F, 1E9F, -1E9F, 0.49999997F, -0.49999997F };
+	memcpy(&in_f32[3], f32_edges, sizeof(f32_edges));
+	// saturation of NaN and infinity: only for the conversion to int16
+	in_f32_sat = in_f32;
+	const float f32_special[] = { -0.0F, (float)HUGE_VAL, -(float)HUGE_VAL, (float)(HUGE_VAL - HUGE_VAL) };
+	memcpy(&in_f32_sat[5], f32_special, sizeof(f32_special));
+
+	in_f32_s8.resize(n);
+	in_f32_s32.resize(n);
+	for (size_t k = 0; k < n; ++k)
+	{
+		in_f32_s8[k] = in_f32_sat[k] / 256.0F;
+		in_f32_s32[k] = in_f32_sat[k] * 98304.0F;
+	}
+	const float s8_edges[] = { 126.5F, -127.5F, 127.5F, -128.5F, 127.49999F, -128.49998F };
+	memcpy(&in_f32_s8[20], s8_edges, sizeof(s8_edges));
+	const float s32_f_edges[] = { 2147483520.0F, 2147483648.0F, -2147483648.0F, -2147483904.0F
+		, 8388606.5F, -8388606.5F, 8388607.5F, -8388607.5F, 16777215.0F, 16777218.0F };
+	memcpy(&in_f32_s32[20], s32_f_edges, sizeof(s32_f_edges));
+}
+
+// output buffer with guard area: all kernels start from the same content
+template <class T>
+static void prepare(std::vector<T> & out, int n)
+{
+	out.resize(n + GUARD);
+	memset(&out[0], GUARD_BYTE, out.size() * sizeof(T));
+}
+
+template <class T>
+static bool same_bits(const std::vector<T> & ref, const std::vector<T> & out, const char * what, const char * name, int n, int offset)
+{
+	++checks;
+	if (!memcmp(&ref[0], &out[0], ref.size() * sizeof(T)))
+		return true;
+	size_t k = 0;
+	while (!memcmp(&ref[k], &out[k], sizeof(T)))
+		++k;
+	printf("FAIL %s %s: n %d offset %d differs at %d%s\n", what, name, n, offset, (int)k, (k + GUARD >= ref.size()) ? " (guard)" : "");
+	++failures;
+	return false;
+}
+
+static bool within(const std::vector<float> & ref, const std::vector<float> & out, float tolerance, const char * what, const char * name, int n, int offset)
+{
+	++checks;
+	for (int k = 0; k < n; ++k)
+	{
+		if (!(fabs(ref[k] - out[k]) <= tolerance))
+		{
+			printf("FAIL %s %s: n %d offset %d at %d: %g instead of %g\n", what, name, n, offset, k, out[k], ref[k]);
+			++failures;
+			return false;
+		}
+	}
+	if (memcmp(&ref[n], &out[n], GUARD * sizeof(float)))
+	{
+		printf("FAIL %s %s: n %d offset %d wrote the guard\n", what, name, n, offset);
+		++failures;
+		return false;
+	}
+	return true;
+}
+
+
+/*
+ * one check per kernel family: run() compares fn with the scalar kernel for length n
+ * (values or I/Q pairs, as the kernel counts them) from input offset
+ */
+
+struct check_u8_s16
+{
+	conv_u8_to_s16_fn fn;
+	const char * name;
+	std::vector<int16_t> ref, out;
+	bool run(int n, int offset)
+	{
+		prepare(ref, n);
+		prepare(out, n);
+		conv_u8_to_s16_scalar(&in_u8[offset], &ref[0], n);
+		fn(&in_u8[offset], &out[0], n);
+		return same_bits(ref, out, "u8 -> int16", name, n, offset);
+	}
+};
+
+struct check_u8_f32
+{
+	conv_u8_to_f32_fn fn;
+	const char * name;
+	std::vector<float> ref, out;
+	bool run(int n, int offset)
+	{
+		bool ok = true;
+		const float scales[] = { 1.0F / 128.0F, 1.0F, 0.3F };
+		for (int s = 0; s < 3 && ok; ++s)
+		{
+			prepare(ref, n);
+			prepare(out, n);
+			conv_u8_to_f32_scalar(&in_u8[offset], &ref[0], n, scales[s]);
+			fn(&in_u8[offset], &out[0], n, scales[s]);
+			ok = same_bits(ref, out, "u8 -> float", name, n, offset);
+		}
+		return ok;
+	}
+};
+
+struct check_f32_s16
+{
+	conv_f32_to_s16_fn fn;
+	const char * name;
+	std::vector<int16_t> ref, out;
+	bool run(int n, int offset)
+	{
+		prepare(ref, n);
+		prepare(out, n);
+		conv_f32_to_s16_scalar(&in_f32_sat[offset], &ref[0], n);
+		fn(&in_f32_sat[offset], &out[0], n);
+		return same_bits(ref, out, "float -> int16", name, n, offset);
+	}
+};
+
+struct check_s32_s16
+{
+	conv_s32_to_s16_fn fn;
+	const char * name;
+	std::vector<int16_t> ref, out;
+	bool run(int n, int offset)
+	{
+		prepare(ref, n);
+		prepare(out, n);
+		conv_s32_to_s16_scalar(&in_s32[offset], &ref[0], n);
+		fn(&in_s32[offset], &out[0], n);
+		return same_bits(ref, out, "int32 -> int16", name, n, offset);
+	}
+};
+
+struct check_f32_s8
+{
+	conv_f32_to_s8_fn fn;
+	const char * name;
+	std::vector<int8_t> ref, out;
+	bool run(int n, int offset)
+	{
+		prepare(ref, n);
+		prepare(out, n);
+		conv_f32_to_s8_scalar(&in_f32_s8[offset], &ref[0], n);
+		fn(&in_f32_s8[offset], &out[0], n);
+		return same_bits(ref, out, "float -> int8", name, n, offset);
+	}
+};
+
+struct check_f32_s32
+{
+	conv_f32_to_s32_fn fn;
+	const char * name;
+	std::vector<int32_t> ref, out;
+	bool run(int n, int offset)
+	{
+		prepare(ref, n);
+		prepare(out, n);
+		conv_f32_to_s32_scalar(&in_f32_s32[offset], &ref[0], n);
+		fn(&in_f32_s32[offset], &out[0], n);
+		return same_bits(ref, out, "float -> int32", name, n, offset);
+	}
+};
+
+struct check_s32_s8
+{
+	conv_s32_to_s8_fn fn;
+	const char * name;
+	std::vector<int8_t> ref, out;
+	bool run(int n, int offset)
+	{
+		prepare(ref, n);
+		prepare(out, n);
+		conv_s32_to_s8_scalar(&in_s32[offset], &ref[0], n);
+		fn(&in_s32[offset], &out[0], n);
+		return same_bits(ref, out, "int32 -> int8", name, n, offset);
+	}
+};
+
+struct check_s32_f32
+{
+	conv_s32_to_f32_fn fn;
+	const char * name;
+	std::vector<float> ref, out;
+	bool run(int n, int offset)
+	{
+		prepare(ref, n);
+		prepare(out, n);
+		conv_s32_to_f32_scalar(&in_s32[offset], &ref[0], n, 1.0F / 2147483648.0F);
+		fn(&in_s32[offset], &out[0], n, 1.0F / 2147483648.0F);
+		return same_bits(ref, out, "int32 -> float", name, n, offset);
+	}
+};
+
+struct check_u8_rot4
+{
+	conv_u8_rot4_f32_fn fn;
+	const char * name;
+	std::vector<float> ref, out;
+	bool run(int n, int offset)
+	{
+		bool ok = true;
+		for (int q = 0; q < 8 && ok; ++q)
+		{
+			const int dir = (q & 4) ? -1 : 1;
+			prepare(ref, 2 * n);
+			prepare(out, 2 * n);
+			conv_u8_rot4_f32_scalar(&in_u8[offset], &ref[0], n, 1.0F / 128.0F, q & 3, dir);
+			fn(&in_u8[offset], &out[0], n, 1.0F / 128.0F, q & 3, dir);
+			ok = same_bits(ref, out, "u8 rot4", name, n, offset);
+		}
+		return ok;
+	}
+};
+
+struct check_f32_rot4
+{
+	conv_f32_rot4_f32_fn fn;
+	const char * name;
+	std::vector<float> ref, out;
+	bool run(int n, int offset)
+	{
+		bool ok = true;
+		for (int q = 0; q < 8 && ok; ++q)
+		{
+			const int dir = (q & 4) ? -1 : 1;
+			prepare(ref, 2 * n);
+			prepare(out, 2 * n);
+			conv_f32_rot4_f32_scalar(&in_f32[offset], &ref[0], n, q & 3, dir);
+			fn(&in_f32[offset], &out[0], n, q & 3, dir);
+			ok = same_bits(ref, out, "float rot4", name, n, offset);
+		}
+		return ok;
+	}
+};
+
+struct check_u8_real
+{
+	conv_u8_real_f32_fn fn;
+	const char * name;
+	std::vector<float> ref, out;
+	bool run(int n, int offset)
+	{
+		bool ok = true;
+		for (int q = 0; q < 8 && ok; ++q)
+		{
+			const int channel = q >> 2;
+			prepare(ref, n);
+			prepare(out, n);
+			conv_u8_real_f32_scalar(&in_u8[offset], &ref[0], n, channel, 2.0F / 128.0F, q & 3);
+			fn(&in_u8[offset], &out[0], n, channel, 2.0F / 128.0F, q & 3);
+			ok = same_bits(ref, out, "u8 real", name, n, offset);
+		}
+		return ok;
+	}
+};
+
+struct check_u8_iqstats
+{
+	conv_u8_iqstats_fn fn;
+	const char * name;
+	bool run(int n, int offset)
+	{
+		// sums accumulate: start from non zero
+		std::vector<int64_t> ref(5 + GUARD), out(5 + GUARD);
+		for (int k = 0; k < 5; ++k)
+			ref[k] = out[k] = 1000 * k - 1;
+		conv_u8_iqstats_scalar(&in_u8[offset], n, &ref[0]);
+		fn(&in_u8[offset], n, &out[0]);
+		return same_bits(ref, out, "u8 iqstats", name, n, offset);
+	}
+};
+
+struct check_u8_mix
+{
+	conv_u8_mix_f32_fn fn;
+	const char * name;
+	std::vector<float> ref, out;
+	bool run(int n, int offset)
+	{
+		const float w = 0.0123F * 6.2831853F;
+		const float step[2] = { cosf(w), sinf(w) };
+		float pRef[2] = { cosf(0.3F), sinf(0.3F) }, pOut[2] = { pRef[0], pRef[1] };
+		prepare(ref, 2 * n);
+		prepare(out, 2 * n);
+		conv_u8_mix_f32_scalar(&in_u8[offset], &ref[0], n, 1.0F / 128.0F, pRef, step);
+		fn(&in_u8[offset], &out[0], n, 1.0F / 128.0F, pOut, step);
+		// rounding of the oscillator drifts by a few ulp per step
+		const float tol = 1E-6F * (n + 16);
+		if (!within(ref, out, 2.0F * tol, "u8 mix", name, 2 * n, offset))
+			return false;
+		std::vector<float> phRef(pRef, pRef + 2), phOut(pOut, pOut + 2);
+		phRef.resize(2 + GUARD, 0.0F);
+		phOut.resize(2 + GUARD, 0.0F);
+		return within(phRef, phOut, tol, "u8 mix phasor", name, 2, offset);
+	}
+};
+
+struct check_f32_mix
+{
+	conv_f32_mix_f32_fn fn;
+	const char * name;
+	std::vector<float> ref, out;
+	bool run(int n, int offset)
+	{
+		const float w = -0.0377F * 6.2831853F;
+		const float step[2] = { cosf(w), sinf(w) };
+		float pRef[2] = { 1.0F, 0.0F }, pOut[2] = { 1.0F, 0.0F };
+		prepare(ref, 2 * n);
+		prepare(out, 2 * n);
+		conv_f32_mix_f32_scalar(&in_f32[offset], &ref[0], n, pRef, step);
+		fn(&in_f32[offset], &out[0], n, pOut, step);
+		// relative drift of the oscillator, on the largest input
+		float peak = 1.0F;
+		for (int k = 0; k < 2 * n; ++k)
+			peak = (fabs(in_f32[offset + k]) > peak) ? (float)fabs(in_f32[offset + k]) : peak;
+		const float tol = 1E-6F * (n + 16);
+		return within(ref, out, peak * 2.0F * tol, "float mix", name, 2 * n, offset);
+	}
+};
+
+struct check_u8_iqcorr
+{
+	conv_u8_iqcorr_f32_fn fn;
+	const char * name;
+	std::vector<float> ref, out;
+	bool run(int n, int offset)
+	{
+		// a typical RTL2832 imbalance - and a larger one
+		static const float coefs[2][4] = { { 1.5F, -0.75F, 1.02F, -0.03F }, { -37.3F, 12.9F, 0.71F, 0.4F } };
+		bool ok = true;
+		for (int c = 0; c < 2 && ok; ++c)
+		{
+			prepare(ref, 2 * n);
+			prepare(out, 2 * n);
+			conv_u8_iqcorr_f32_scalar(&in_u8[offset], &ref[0], n, 1.0F / 128.0F, coefs[c]);
+			fn(&in_u8[offset], &out[0], n, 1.0F / 128.0F, coefs[c]);
+			// fixed point: dc in 2^-7, a and b in 2^-14 raw units - some 0.02 raw units for Q
+			ok = within(ref, out, 0.025F / 128.0F, "u8 iqcorr", name, 2 * n, offset);
+		}
+		return ok;
+	}
+};
+
+
+// all lengths up to MAX_SHORT_LEN and a long block, from each offset
+template <class CHECK>
+static bool run_lengths(CHECK & check, int maxLen)
+{
+	for (int offset = 0; offset < MAX_OFFSET; ++offset)
+	{
+		for (int n = 0; n <= MAX_SHORT_LEN; ++n)
+			if (!check.run(n, offset))
+				return false;
+		if (!check.run(maxLen, offset))
+			return false;
+	}
+	return true;
+}
+
+template <class FN, class CHECK>
+static void test_table(const conv_kernel<FN> * table, CHECK check, const char * what, int maxLen = LONG_LEN)
+{
+	const int features = conv_cpu_features();
+	for (int k = 0; table[k].fn; ++k)
+	{
+		if ((table[k].required_cpu & features) != table[k].required_cpu)
+		{
+			printf("skip %-16s %s: not supported by the CPU\n", what, table[k].name);
+			continue;
+		}
+		check.fn = table[k].fn;
+		check.name = table[k].name;
+		if (run_lengths(check, maxLen))
+			printf("ok   %-16s %s\n", what, table[k].name);
+	}
+}
+
+
+// the loop of ThreadProc these kernels replaced
+static void legacy_u8_to_s16(const uint8_t * char_ptr, int16_t * short_ptr, int n)
+{
+	for (int i = 0; i < n; i++)
+		*short_ptr++ = ((short)(*char_ptr++)) - 128;
+}
+
+static void test_legacy()
+{
+	std::vector<int16_t> ref, out;
+	for (int n = 0; n <= MAX_SHORT_LEN; ++n)
+	{
+		prepare(ref, n);
+		prepare(out, n);
+		legacy_u8_to_s16(&in_u8[1], &ref[0], n);
+		conv_u8_to_s16_scalar(&in_u8[1], &out[0], n);
+		if (!same_bits(ref, out, "u8 -> int16", "scalar / legacy loop", n, 1))
+			return;
+	}
+	printf("ok   %-16s scalar = legacy loop\n", "u8 -> int16");
+}
+
+
+/*
+ * the integer sum decimator against the Decimator with the sum filter at scale 1:
+ * float sums of small integers are exact, so both have to agree bit for bit - over
+ * blocks of any length, also shorter than the factor. the full decimation also
+ * against plain sums of the stream: the first sum ends with the first pair
+ */
+static void test_sum_decimation()
+{
+	static const int factors[] = { 2, 3, 4, 5, 6, 8, 10, 12, 16, 256 };
+	static const int blockLens[] = { 1, 7, 1000, 2, 3, 4096, 255, 5, 511, 8192 };
+	const int nFactors = sizeof(factors) / sizeof(factors[0]);
+	const int nBlocks = sizeof(blockLens) / sizeof(blockLens[0]);
+	int total = 0;
+	for (int b = 0; b < nBlocks; ++b)
+		total += blockLens[b];
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		const bool moving = (mode == 1);
+		const char * what = moving ? "moving sum" : "sum decimation";
+		bool ok = true;
+		for (int k = 0; k < nFactors && ok; ++k)
+		{
+			const int f = factors[k];
+			SumDecimator sum;
+			Decimator decim;
+			sum.configure(f, moving);
+			decim.configure(f, DECIM_INPUT_IQ, moving ? DECIM_FILTER_MOVING_SUM : DECIM_FILTER_SUM);
+			decim.setScale(1.0F);
+
+			std::vector<int16_t> ref(2 * total + GUARD), out(2 * total + GUARD);
+			std::vector<float> f32(2 * 8192 + 64);
+			int nRef = 0, nOut = 0, pos = 0;
+			for (int b = 0; b < nBlocks; ++b)
+			{
+				const uint8_t * in = &in_u8[2 * pos];
+				nOut += sum.process(in, blockLens[b], &out[2 * nOut]);
+				const int n = decim.process(in, blockLens[b], &f32[0]);
+				conv_f32_to_s16_scalar(&f32[0], &ref[2 * nRef], 2 * n);
+				nRef += n;
+				pos += blockLens[b];
+			}
+			++checks;
+			const int expected = moving ? total : total / f + ((total % f) ? 1 : 0);
+			if (nOut != nRef || nOut != expected)
+			{
+				printf("FAIL %s %d: %d outputs, %d of the FIR, %d expected\n", what, f, nOut, nRef, expected);
+				++failures;
+				ok = false;
+			}
+			else
+				ok = same_bits(ref, out, what, "integer / FIR", f, 0);
+
+			// plain sums starting at pair 1 + m * step: they end with output o
+			const int step = moving ? 1 : f;
+			for (int m = 0; ok && m * step + f < total; ++m)
+			{
+				const int o = m + f / step;
+				int sI = 0, sQ = 0;
+				for (int j = 0; j < f; ++j)
+				{
+					sI += in_u8[2 * (1 + m * step + j)] - 128;
+					sQ += in_u8[2 * (1 + m * step + j) + 1] - 128;
+				}
+				if (out[2 * o] != sI || out[2 * o + 1] != sQ)
+				{
+					printf("FAIL %s %d: output %d is no sum of the input\n", what, f, o);
+					++failures;
+					ok = false;
+				}
+			}
+		}
+		if (ok)
+			printf("ok   %-16s integer = FIR = plain sums\n", what);
+	}
+}
+
+
+/*
+ * frequency response of the filters from complex tones: the level of a tone at the
+ * output is the magnitude of one DFT bin over the settled outputs - which keeps the
+ * 8 bit quantization noise of the input out of the stopband measurement.
+ * frequencies in cycles per sample. a tone at output frequency fo is wanted within
+ * the passband |fo| <= TONE_PASS, any other input component is an alias or image,
+ * attenuated as soon as it is TONE_STOP away from the band edge at 0.5
+ */
+#define TONE_AMPLITUDE		100.0
+#define TONE_SETTLE			256		// outputs left out: the filters' step response
+#define TONE_PASS			0.35
+#define TONE_RIPPLE_DB		0.05
+
+static const double TONE_PI = 3.14159265358979323846;
+
+static void u8_tone(std::vector<uint8_t> & iq, int nPairs, double f)
+{
+	iq.resize(2 * nPairs);
+	for (int k = 0; k < nPairs; ++k)
+	{
+		iq[2 * k] = (uint8_t)(128.0 + floor(TONE_AMPLITUDE * cos(2.0 * TONE_PI * f * k) + 0.5));
+		iq[2 * k + 1] = (uint8_t)(128.0 + floor(TONE_AMPLITUDE * sin(2.0 * TONE_PI * f * k) + 0.5));
+	}
+}
+
+// level of the tone at f in the outputs behind TONE_SETTLE, in dB relative to amplitude
+template <class T>
+static double tone_db(const T * y, int n, double f, double amplitude)
+{
+	double re = 0.0, im = 0.0;
+	for (int k = TONE_SETTLE; k < n; ++k)
+	{
+		const double c = cos(2.0 * TONE_PI * f * k), s = sin(2.0 * TONE_PI * f * k);
+		re += y[2 * k] * c + y[2 * k + 1] * s;
+		im += y[2 * k + 1] * c - y[2 * k] * s;
+	}
+	const double level = sqrt(re * re + im * im) / (n - TONE_SETTLE);
+	return 20.0 * log10(level / amplitude + 1E-15);
+}
+
+// f folded into -0.5 .. 0.5
+static double tone_wrap(double f)
+{
+	return f - floor(f + 0.5);
+}
+
+static bool tone_check(bool ok, const char * what, int factor, const char * band, double f, double db)
+{
+	++checks;
+	if (ok)
+		return true;
+	printf("FAIL %s %d: %s tone %.4f at %.2f dB\n", what, factor, band, f, db);
+	++failures;
+	return false;
+}
+
+/*
+ * the halfband/FIR cascade of the Decimator: flat passband, and the input around each
+ * multiple of the output rate that folds into the passband at least 50 dB down. the
+ * transition 0.5 .. 0.65 of the output rate folds above TONE_PASS
+ */
+static void test_decimator_tones()
+{
+	static const int factors[] = { 2, 3, 4, 6, 8, 12, 16 };
+	static const double pass[] = { 0.02, 0.17, TONE_PASS };
+	static const double alias[] = { -TONE_PASS, -0.13, 0.08, 0.31 };
+	const double stopDb = -50.0;
+	const int nOut = 2048;
+	bool ok = true;
+	for (size_t d = 0; d < sizeof(factors) / sizeof(factors[0]); ++d)
+	{
+		const int D = factors[d];
+		Decimator decim;
+		decim.configure(D);
+		decim.setScale(1.0F / 128.0F);
+		const int nIn = nOut * D;
+		std::vector<uint8_t> iq;
+		std::vector<float> out(2 * (nOut + 16));
+		const double amplitude = TONE_AMPLITUDE / 128.0;
+
+		for (size_t k = 0; k < sizeof(pass) / sizeof(pass[0]); ++k)
+		{
+			u8_tone(iq, nIn, pass[k] / D);
+			decim.reset();
+			const int n = decim.process(&iq[0], nIn, &out[0]);
+			const double db = tone_db(&out[0], n, pass[k], amplitude);
+			ok &= tone_check(fabs(db) <= TONE_RIPPLE_DB, "decimation", D, "passband", pass[k], db);
+		}
+		for (int m = 1; m < D; ++m)
+		{
+			for (size_t k = 0; k < sizeof(alias) / sizeof(alias[0]); ++k)
+			{
+				const double f = tone_wrap((m + alias[k]) / D);
+				u8_tone(iq, nIn, f);
+				decim.reset();
+				const int n = decim.process(&iq[0], nIn, &out[0]);
+				const double db = tone_db(&out[0], n, alias[k], amplitude);
+				ok &= tone_check(db <= stopDb, "decimation", D, "alias of", f, db);
+			}
+		}
+	}
+	if (ok)
+		printf("ok   %-16s halfband/FIR: passband within %.2f dB, aliases below %.0f dB\n", "decimation", TONE_RIPPLE_DB, stopDb);
+}
+
+/*
+ * the CIC with its compensating FIR: the droop compensated within the passband, the
+ * aliases 40 dB down. the FIR decimating by 2 has the transition - the CIC nulls are
+ * around the even multiples of the output rate. of the D / 2 - 1 odd ones the first
+ * few and the last, next to the input nyquist rate
+ */
+static void test_cic_tones()
+{
+	static const int factors[] = { 16, 64, 256 };
+	static const double pass[] = { 0.02, 0.17, TONE_PASS };
+	static const double alias[] = { -0.3, -0.1, 0.15, 0.3 };
+	const double stopDb = -40.0;
+	const int nOut = 1024;
+	bool ok = true;
+	for (size_t d = 0; d < sizeof(factors) / sizeof(factors[0]); ++d)
+	{
+		const int D = factors[d];
+		CicDecimator cic;
+		cic.configure(D);
+		const int nIn = nOut * D;
+		std::vector<uint8_t> iq;
+		std::vector<int32_t> out(2 * (nOut + 16));
+		const double amplitude = 2147483648.0 * TONE_AMPLITUDE / 128.0;
+
+		for (size_t k = 0; k < sizeof(pass) / sizeof(pass[0]); ++k)
+		{
+			u8_tone(iq, nIn, pass[k] / D);
+			cic.reset();
+			const int n = cic.process(&iq[0], nIn, &out[0]);
+			const double db = tone_db(&out[0], n, pass[k], amplitude);
+			ok &= tone_check(fabs(db) <= TONE_RIPPLE_DB, "CIC", D, "passband", pass[k], db);
+		}
+		for (int m = 1; m < D; ++m)
+		{
+			if (m > 4 && m < D - 1)
+				continue;
+			for (size_t k = 0; k < sizeof(alias) / sizeof(alias[0]); ++k)
+			{
+				const double f = tone_wrap((m + alias[k]) / D);
+				u8_tone(iq, nIn, f);
+				cic.reset();
+				const int n = cic.process(&iq[0], nIn, &out[0]);
+				const double db = tone_db(&out[0], n, alias[k], amplitude);
+				ok &= tone_check(db <= stopDb, "CIC", D, "alias of", f, db);
+			}
+		}
+	}
+	if (ok)
+		printf("ok   %-16s passband within %.2f dB, aliases below %.0f dB\n", "CIC", TONE_RIPPLE_DB, stopDb);
+}
+
+/*
+ * the resampler by L / M: its prototype lowpass at L times the input rate passes up to
+ * the lower of both nyquist rates, edge. input components c = f + k beyond 1.3 * edge
+ * - images at interpolation, aliases at decimation - come out at (f + k) * M / L, at
+ * least 40 dB down. the large ratios have the fewest taps per phase
+ */
+static void test_resampler_tones()
+{
+	static const int ratios[][2] = { { 2, 3 }, { 3, 2 }, { 1, 3 }, { 3, 1 }, { 96, 125 }, { 125, 96 } };
+	const double stopDb = -40.0;
+	const int nIn = 4096;
+	bool ok = true;
+	for (size_t r = 0; r < sizeof(ratios) / sizeof(ratios[0]); ++r)
+	{
+		const int L = ratios[r][0], M = ratios[r][1];
+		Resampler rs;
+		rs.configure(L, M);
+		const double edge = (L < M) ? 0.5 * L / M : 0.5;
+		std::vector<float> out(2 * rs.maxOutput(nIn));
+		const int factor = 1000 * L + M;		// both in the failure message
+
+		for (int t = 0; t < 15; ++t)
+		{
+			const double f = -0.5 + (t + 0.37) / 15.0;
+			rs.reset();
+			float * x = rs.inputPtr(nIn);
+			for (int k = 0; k < nIn; ++k)
+			{
+				x[2 * k] = (float)cos(2.0 * TONE_PI * f * k);
+				x[2 * k + 1] = (float)sin(2.0 * TONE_PI * f * k);
+			}
+			const int n = rs.run(nIn, &out[0]);
+			if (fabs(f) <= 0.7 * edge)
+			{
+				const double db = tone_db(&out[0], n, f * M / L, 1.0);
+				ok &= tone_check(fabs(db) <= TONE_RIPPLE_DB, "resampler", factor, "passband", f, db);
+			}
+			for (int k = -L; k <= L; ++k)
+			{
+				const double c = f + k;
+				if (fabs(c) > 0.5 * L || fabs(c) < 1.3 * edge)
+					continue;
+				const double db = tone_db(&out[0], n, tone_wrap(c * M / L), 1.0);
+				ok &= tone_check(db <= stopDb, "resampler", factor, "image/alias of", c, db);
+			}
+		}
+	}
+	if (ok)
+		printf("ok   %-16s passband within %.2f dB, images and aliases below %.0f dB\n", "resampler", TONE_RIPPLE_DB, stopDb);
+}
+
+
+/*
+ * output stage of the decimators: the int16 templates against the kernels above,
+ * int8 and int32 against plain references - saturated, rounded half away from zero
+ * with the +-0.5 added in R: float up to 16 bit as the kernels, double for 32 bit
+ */
+template <class T, class R>
+static T round_ref(R v, R lo, R hi)
+{
+	if (!(v > lo))
+		return (T)lo;
+	if (v >= hi)
+		return (T)hi;
+	const R r = v + ((v >= 0) ? (R)0.5 : (R)-0.5);
+	return (T)((r >= 0) ? floor(r) : ceil(r));
+}
+
+template <class T, class R>
+static void test_output_format(R lo, R hi, double level, const char * what)
+{
+	const int n = LONG_LEN;
+	std::vector<float> in(n);
+	std::vector<T> ref, out;
+	prepare(ref, n);
+	prepare(out, n);
+	for (int k = 0; k < n; ++k)
+	{
+		in[k] = (float)(in_f32_sat[k] * level);
+		ref[k] = round_ref<T, R>(in[k], lo, hi);
+	}
+	conv_f32_to_int(&in[0], &out[0], n);
+	same_bits(ref, out, what, "float", n, 0);
+
+	// full scale 32 bit: one bit more than T, +1, dropped
+	const int shift = 32 - 8 * (int)sizeof(T);
+	prepare(ref, n);
+	prepare(out, n);
+	for (int k = 0; k < n; ++k)
+	{
+		const int64_t r = shift ? (((int64_t)in_s32[k] >> (shift - 1)) + 1) >> 1 : in_s32[k];
+		ref[k] = (T)((r > (int64_t)hi) ? (int64_t)hi : r);
+	}
+	conv_s32_to_int(&in_s32[0], &out[0], n);
+	same_bits(ref, out, what, "int32", n, 0);
+}
+
+static void test_output_formats()
+{
+	std::vector<int16_t> ref, out;
+	for (int n = 0; n <= MAX_SHORT_LEN + 1; ++n)
+	{
+		const int len = (n > MAX_SHORT_LEN) ? LONG_LEN : n;
+		prepare(ref, len);
+		prepare(out, len);
+		conv_f32_to_s16_scalar(&in_f32_sat[0], &ref[0], len);
+		conv_f32_to_int(&in_f32_sat[0], &out[0], len);
+		same_bits(ref, out, "float -> int16", "template", len, 0);
+		prepare(ref, len);
+		prepare(out, len);
+		conv_s32_to_s16_scalar(&in_s32[0], &ref[0], len);
+		conv_s32_to_int(&in_s32[0], &out[0], len);
+		same_bits(ref, out, "int32 -> int16", "template", len, 0);
+	}
+	// int8 level: input / 256 - int32 level: input * 65536, also beyond the range
+	test_output_format<int8_t, float>(-128.0F, 127.0F, 1.0 / 256.0, "-> int8");
+	test_output_format<int32_t, double>(-2147483648.0, 2147483647.0, 65536.0 * 1.5, "-> int32");
+}
+
+
+/*
+ * re-chunking: whatever the chunk and block lengths, the delivered chunks have the
+ * configured size and concatenate to the pushed stream - the rest stays staged.
+ * chunks dividing the block are delivered without copy. moving the staging buffer
+ * with its content keeps the staged pairs
+ */
+#define RECHUNK_BLOCK		1024
+
+static std::vector<uint8_t> rechunk_out;
+static int rechunk_pair_bytes = 0;
+static bool rechunk_sizes_ok = true;
+static int rechunk_size = 0;
+
+static void rechunk_deliver(int nPairs, void * samples)
+{
+	if (nPairs != rechunk_size)
+		rechunk_sizes_ok = false;
+	const uint8_t * p = (const uint8_t *)samples;
+	rechunk_out.insert(rechunk_out.end(), p, p + nPairs * rechunk_pair_bytes);
+}
+
+static bool rechunk_check(const Rechunker & rc, int total, const char * what, int chunk, int pairBytes)
+{
+	++checks;
+	const int expected = (total / chunk) * chunk;
+	if (!rechunk_sizes_ok || (int)rechunk_out.size() != expected * pairBytes || rc.staged() != total - expected
+		|| (expected && memcmp(&rechunk_out[0], &in_u8[0], expected * pairBytes)))
+	{
+		printf("FAIL rechunk %s: chunk %d, %d bytes per pair: %d pairs delivered, %d staged of %d\n"
+			, what, chunk, pairBytes, (int)rechunk_out.size() / pairBytes, rc.staged(), total);
+		++failures;
+		return false;
+	}
+	return true;
+}
+
+static void test_rechunker()
+{
+	static const int chunks[] = { 256, 512, 1024, 1, 7, 300, 1000, 1500, 2048, 4000 };
+	static const int blockLens[] = { 1, 7, 1000, 2, 3, 4096, 255, 5, 511, 1024 };
+	static const int pairBytes[] = { 2, 4, 8 };
+	const int nChunks = sizeof(chunks) / sizeof(chunks[0]);
+	const int nBlocks = sizeof(blockLens) / sizeof(blockLens[0]);
+	const int maxChunk = 4096;
+	std::vector<uint8_t> staging(maxChunk * 8), moved(maxChunk * 8);
+	bool ok = true;
+
+	for (int b = 0; b < 3; ++b)
+	{
+		const int pb = pairBytes[b];
+		for (int c = 0; c < nChunks; ++c)
+		{
+			const int chunk = chunks[c];
+			Rechunker rc;
+			rc.setStaging(&staging[0], chunk * pb);
+			++checks;
+			if (!rc.configure(chunk, pb) || rc.configure(chunk + 1, pb) || rc.chunk() != 0 || !rc.configure(chunk, pb))
+			{
+				printf("FAIL rechunk: chunk %d, %d bytes per pair with %d bytes of staging\n", chunk, pb, chunk * pb);
+				++failures;
+				ok = false;
+				continue;
+			}
+			rechunk_pair_bytes = pb;
+			rechunk_size = chunk;
+
+			// network blocks of equal length
+			rechunk_out.clear();
+			rechunk_sizes_ok = true;
+			int total = 0;
+			for (int k = 0; k < 8; ++k)
+			{
+				rc.push(&in_u8[total * pb], RECHUNK_BLOCK, rechunk_deliver);
+				total += RECHUNK_BLOCK;
+			}
+			ok = rechunk_check(rc, total, "equal blocks", chunk, pb) && ok;
+			++checks;
+			if (RECHUNK_BLOCK % chunk == 0 && (rc.stagedChunks() != 0 || rc.directChunks() != (unsigned)(total / chunk)))
+			{
+				printf("FAIL rechunk equal blocks: chunk %d divides the block, %u of %u chunks copied\n"
+					, chunk, rc.stagedChunks(), rc.stagedChunks() + rc.directChunks());
+				++failures;
+				ok = false;
+			}
+
+			// irregular blocks - the staging buffer moves in the middle
+			rc.reset();
+			rechunk_out.clear();
+			rechunk_sizes_ok = true;
+			total = 0;
+			for (int k = 0; k < nBlocks; ++k)
+			{
+				if (k == nBlocks / 2)
+				{
+					memcpy(&moved[0], &staging[0], chunk * pb);
+					memset(&staging[0], GUARD_BYTE, staging.size());
+					rc.setStaging(&moved[0], (int)moved.size());
+				}
+				rc.push(&in_u8[total * pb], blockLens[k], rechunk_deliver);
+				total += blockLens[k];
+			}
+			ok = rechunk_check(rc, total, "irregular", chunk, pb) && ok;
+
+			// staging too small: unconfigured, nothing delivered
+			rc.setStaging(&staging[0], chunk * pb - 1);
+			rechunk_out.clear();
+			rc.push(&in_u8[0], maxChunk, rechunk_deliver);
+			++checks;
+			if (rc.chunk() != 0 || rc.staged() != 0 || !rechunk_out.empty())
+			{
+				printf("FAIL rechunk: chunk %d still configured with %d bytes of staging\n", chunk, chunk * pb - 1);
+				++failures;
+				ok = false;
+			}
+		}
+	}
+	if (ok)
+		printf("ok   %-16s chunks = stream, staging kept when moved\n", "rechunk");
+}
+
+
+/*
+ * jitter buffer on synthetic arrivals: one tick per byte, blocks of JITTER_BLOCK bytes.
+ * each block arrives 0..99 ticks late, outliers JITTER_OUTLIER more. with 2 % outliers
+ * and a drop target of 1 % the delay covers them, without outliers it is the 99 %
+ * quantile of 0..99. it grows at once and shrinks by an eighth per estimate
+ */
+#define JITTER_BLOCK		1000
+#define JITTER_OUTLIER		5000
+#define JITTER_T0			123456789
+
+static unsigned jitter_block = 0;
+
+static void jitter_feed(JitterBuffer & jb, int nBlocks, bool outliers)
+{
+	for (int k = 0; k < nBlocks; ++k, ++jitter_block)
+	{
+		const uint64_t pos = (uint64_t)(jitter_block + 1) * JITTER_BLOCK;
+		int64_t late = (jitter_block * 37) % 100;
+		if (outliers && jitter_block % 50 == 25)
+			late += JITTER_OUTLIER;
+		jb.arrival(JITTER_T0 + (int64_t)pos + late, pos);
+	}
+}
+
+static bool jitter_check(bool ok, const char * what, int64_t delay, int64_t lo, int64_t hi)
+{
+	++checks;
+	if (ok && delay >= lo && delay <= hi)
+		return true;
+	printf("FAIL jitter %s: delay %d, expected %d .. %d\n", what, (int)delay, (int)lo, (int)hi);
+	++failures;
+	return false;
+}
+
+static void test_jitter()
+{
+	JitterBuffer jb;
+	jb.reset(JITTER_BLOCK, JITTER_BLOCK);
+	jb.setDropTarget(0.01);
+	jitter_block = 0;
+	bool ok = jitter_check(jb.due(JITTER_BLOCK, JITTER_OUTLIER) == 0, "due before the first arrival", 0, 0, 0);
+
+	// no outliers: the start delay shrinks down to the 99 % quantile
+	jitter_feed(jb, 16 * JITTER_WINDOW, false);
+	ok = jitter_check(jb.lateBlocks() == 0, "quantile", jb.delay(), 98, 99 + 7) && ok;
+	const uint64_t pos = (uint64_t)jitter_block * JITTER_BLOCK;
+	ok = jitter_check(jb.due(pos, JITTER_OUTLIER) == JITTER_T0 + (int64_t)pos + jb.delay(), "due", jb.delay(), 0, 99 + 7) && ok;
+	ok = jitter_check(jb.due(pos, 10) == JITTER_T0 + (int64_t)pos + 10, "due limited", jb.delay(), 0, 99 + 7) && ok;
+
+	// 2 % outliers: the delay jumps to them within one window
+	jitter_feed(jb, JITTER_WINDOW, true);
+	ok = jitter_check(true, "growth", jb.delay(), JITTER_OUTLIER, JITTER_OUTLIER + 99) && ok;
+	// late until more outliers than the drop target are in the window
+	const unsigned late = jb.lateBlocks();
+	ok = jitter_check(late > JITTER_WINDOW / 100 && late <= JITTER_WINDOW / 50, "late blocks", jb.delay(), JITTER_OUTLIER, JITTER_OUTLIER + 99) && ok;
+	const int64_t high = jb.delay();
+
+	// outliers gone: once too few are left in the window, one eighth per estimate
+	int64_t prev = high, delay = high;
+	for (int k = 0; k < JITTER_WINDOW && delay >= JITTER_OUTLIER; ++k)
+	{
+		prev = delay;
+		jitter_feed(jb, 1, false);
+		delay = jb.delay();
+	}
+	ok = jitter_check(true, "slow shrink", delay, prev - prev / 8, prev - (prev - 99) / 8) && ok;
+	jitter_feed(jb, 16 * JITTER_WINDOW, false);
+	ok = jitter_check(jb.lateBlocks() == late, "shrink", jb.delay(), 98, 99 + 7) && ok;
+
+	// drop target 5 %: the outliers are dropped instead
+	jitter_feed(jb, 4 * JITTER_WINDOW, true);
+	jb.setDropTarget(0.05);
+	jitter_feed(jb, 16 * JITTER_WINDOW, true);
+	ok = jitter_check(true, "drop target", jb.delay(), 90, 99 + 7) && ok;
+	if (ok)
+		printf("ok   %-16s quantile delay, grows at once, shrinks slowly\n", "jitter buffer");
+}
+
+int main()
+{
+	init_inputs();
+	conv_init();
+	printf("CPU: %s, features%s%s\n", conv_cpu_name()
+		, (conv_cpu_features() & CONV_CPU_SSE2) ? " sse2" : "", (conv_cpu_features() & CONV_CPU_AVX2) ? " avx2" : "");
+
+	test_legacy();
+	test_table(conv_kernels_u8_s16, check_u8_s16(), "u8 -> int16");
+	test_table(conv_kernels_u8_f32, check_u8_f32(), "u8 -> float");
+	test_table(conv_kernels_f32_s16, check_f32_s16(), "float -> int16");
+	test_table(conv_kernels_s32_s16, check_s32_s16(), "int32 -> int16");
+	test_table(conv_kernels_f32_s8, check_f32_s8(), "float -> int8");
+	test_table(conv_kernels_f32_s32, check_f32_s32(), "float -> int32");
+	test_table(conv_kernels_s32_s8, check_s32_s8(), "int32 -> int8");
+	test_table(conv_kernels_s32_f32, check_s32_f32(), "int32 -> float");
+	test_table(conv_kernels_u8_rot4_f32, check_u8_rot4(), "u8 rot4");
+	test_table(conv_kernels_f32_rot4_f32, check_f32_rot4(), "float rot4");
+	test_table(conv_kernels_u8_real_f32, check_u8_real(), "u8 real");
+	test_table(conv_kernels_u8_iqstats, check_u8_iqstats(), "u8 iqstats", 65536);
+	test_table(conv_kernels_u8_mix_f32, check_u8_mix(), "u8 mix");
+	test_table(conv_kernels_f32_mix_f32, check_f32_mix(), "float mix");
+	test_table(conv_kernels_u8_iqcorr_f32, check_u8_iqcorr(), "u8 iqcorr");
+	test_sum_decimation();
+	test_decimator_tones();
+	test_cic_tones();
+	test_resampler_tones();
+	test_output_formats();
+	test_rechunker();
+	test_jitter();
+
+	printf("%d checks, %d failed\n", checks, failures);
+	return failures ? 1 : 0;
+}